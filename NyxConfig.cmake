@@ -39,6 +39,9 @@ list( APPEND CMAKE_MODULE_PATH
 find_package( OpenGL REQUIRED )
 find_package( GLEW REQUIRED )
 
+# the resource registry locks its deletion queue
+find_package( Threads REQUIRED )
+
 # set the include dir
 set( Nyx_INCLUDE_DIR "${Nyx_DIR}/include")
 
@@ -63,16 +66,17 @@ set( Nyx_INCLUDE_DIRS
 # link libraries
 set( Nyx_LINK_LIBRARIES 
     ${OPENGL_LIBRARIES}
-    ${GLEW_LIBRARY} CACHE INTERNAL "all libs nyx needs" )
+    ${GLEW_LIBRARY}
+    ${CMAKE_THREAD_LIBS_INIT} CACHE INTERNAL "all libs nyx needs" )
 
 # enable C++11 support
-#if( NOT WIN32 )
-#    if( CMAKE_COMPILER_IS_GNUCXX )
-#        set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} --std=c++0x")
-#    else( CMAKE_COMPILER_IS_GNUCXX )
-#        set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++11 -Qunused-arguments")
-#    endif()
-#endif()
+if( NOT WIN32 )
+    if( CMAKE_COMPILER_IS_GNUCXX )
+        set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++11")
+    else( CMAKE_COMPILER_IS_GNUCXX )
+        set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -std=c++11 -Qunused-arguments")
+    endif()
+endif()
 
 
 
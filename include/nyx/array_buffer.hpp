@@ -32,23 +32,100 @@ namespace nyx
  *  Created on: May 4, 2010
  *      Author: alex
  *
+ *      With generic attributes selected in the state (always in a core profile)
+ *      the array is bound to its attribute location with glVertexAttribPointer
+ *      instead of the fixed function pointer of its kind. The locations default
+ *      to 0 vertex, 1 normal, 2 color and 3 texture coordinates.
  */
 
 
-template <typename T>
-class array_buffer : public buffer<T>
+template <typename T, typename D>
+class array_buffer : public buffer<T, D>
 {
 public:
     array_buffer();
 
+    void set_location( unsigned int location );
+    unsigned int location() const;
+
+    void bind() const;
+    void unbind() const;
+
+protected:
+    void attribute_pointer( bool normalized ) const;
+    bool is_integer_storage() const;
+
+protected:
+    unsigned int m_location;
 };
 
 
-template <typename T>
-inline array_buffer<T>::array_buffer() :
-    buffer<T>::buffer(),
-    array_buffer<T>::m_target(GL_ARRAY_BUFFER)
+template <typename T, typename D>
+inline array_buffer<T, D>::array_buffer() :
+    buffer<T, D>(),
+    m_location(0)
+{
+    array_buffer<T, D>::m_target = GL_ARRAY_BUFFER;
+}
+
+
+template <typename T, typename D>
+inline void array_buffer<T, D>::set_location( unsigned int location )
+{
+    m_location = location;
+}
+
+
+template <typename T, typename D>
+inline unsigned int array_buffer<T, D>::location() const
+{
+    return m_location;
+}
+
+
+template <typename T, typename D>
+inline void array_buffer<T, D>::bind() const
+{
+    array_buffer<T, D>::flush();
+
+    if( state::current().generic_attributes() )
+        state::current().enable_vertex_attrib_array( m_location );
+    else if( array_buffer<T, D>::m_state != 0 )
+        state::current().enable_client_state( array_buffer<T, D>::m_state );
+
+    state::current().bind_buffer( array_buffer<T, D>::m_target, array_buffer<T, D>::m_identifier );
+}
+
+
+template <typename T, typename D>
+inline void array_buffer<T, D>::unbind() const
+{
+    state::current().bind_buffer( array_buffer<T, D>::m_target, 0 );
+
+    if( state::current().generic_attributes() )
+        state::current().disable_vertex_attrib_array( m_location );
+    else if( array_buffer<T, D>::m_state != 0 )
+        state::current().disable_client_state( array_buffer<T, D>::m_state );
+}
+
+
+template <typename T, typename D>
+inline void array_buffer<T, D>::attribute_pointer( bool normalized ) const
+{
+    glVertexAttribPointer( m_location,
+                           array_buffer<T, D>::gl_components(),
+                           array_buffer<T, D>::gl_type(),
+                           normalized ? GL_TRUE : GL_FALSE,
+                           0,
+                           reinterpret_cast<const GLvoid*>( array_buffer<T, D>::offset() ) );
+}
+
+
+template <typename T, typename D>
+inline bool array_buffer<T, D>::is_integer_storage() const
 {
+    unsigned int type = array_buffer<T, D>::gl_type();
+    return type != GL_FLOAT && type != GL_DOUBLE && type != GL_HALF_FLOAT;
 }
 
 
@@ -0,0 +1,419 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <nyx/texture.hpp>
+
+namespace nyx
+{
+
+/*
+ * atlas.hpp
+ *
+ *      Packs many small images into the layers of one GL_TEXTURE_2D_ARRAY, so
+ *      materials which used to have a texture each are drawn with a single
+ *      binding.
+ *
+ *      atlas_packer only places rectangles, with the skyline bottom-left
+ *      heuristic: every layer keeps the outline of its filled part and an image
+ *      goes where its top edge ends up lowest. insert places one image online,
+ *      pack places a whole set sorted by height, which wastes less space. When
+ *      no layer has room a new one is started, up to "maxLayers" (0 for no
+ *      limit).
+ *
+ *      Each placement carries the transform from the texture coordinates of the
+ *      image to those of the array, (u,v) -> (u*scale[0] + offset[0],
+ *      v*scale[1] + offset[1], layer). "padding" texels around every image
+ *      keep filtering from reaching the neighbours, texture_atlas fills them
+ *      with the edge of the image. Lower mip levels need padding of 2^(levels-1)
+ *      texels to stay apart.
+ *
+ *      texture_atlas is a texture array with a packer, add uploads images as
+ *      they are placed. Adding a set at once packs tighter and regenerates the
+ *      mip levels only once.
+ */
+
+
+class atlas_packer
+{
+public:
+    static const unsigned int none = 0xFFFFFFFFu;
+
+    struct placement
+    {
+        unsigned int x;         // first texel of the image
+        unsigned int y;
+        unsigned int layer;     // none if it didn't fit
+        unsigned int width;
+        unsigned int height;
+        float scale[2];
+        float offset[2];
+    };
+
+    atlas_packer();
+
+    void reset( unsigned int width, unsigned int height, unsigned int padding=1, unsigned int maxLayers=0 );
+
+    bool insert( unsigned int width, unsigned int height, placement &p );
+    std::size_t pack( const unsigned int *sizes, std::size_t count, std::vector<placement> &placements );
+
+    unsigned int width() const;
+    unsigned int height() const;
+    unsigned int padding() const;
+    unsigned int layers() const;
+    float occupancy() const;
+
+protected:
+    struct segment
+    {
+        unsigned int x;
+        unsigned int y;         // height of the skyline
+        unsigned int width;
+    };
+
+    bool fit( const std::vector<segment> &skyline, std::size_t i, unsigned int width, unsigned int height, unsigned int &y ) const;
+    bool find( const std::vector<segment> &skyline, unsigned int width, unsigned int height, std::size_t &index, unsigned int &y ) const;
+    void place( std::vector<segment> &skyline, std::size_t index, unsigned int y, unsigned int width, unsigned int height );
+
+protected:
+    std::vector< std::vector<segment> > m_skylines;
+
+    unsigned int m_size[2];
+    unsigned int m_padding;
+    unsigned int m_maxLayers;
+    double m_used;
+};
+
+
+template <typename T>
+class texture_atlas : public texture<T>
+{
+public:
+    typedef atlas_packer::placement placement;
+
+    texture_atlas();
+
+    void configure( unsigned int width, unsigned int height, unsigned int layers, unsigned int padding=1 );
+
+    bool add( const T *pixels, unsigned int width, unsigned int height, placement &p );
+    std::size_t add( const T * const *pixels, const unsigned int *sizes, std::size_t count, std::vector<placement> &placements );
+
+    const atlas_packer& packer() const;
+
+protected:
+    void upload( const T *pixels, const placement &p );
+
+protected:
+    atlas_packer m_packer;
+    std::vector<T> m_padded;
+};
+
+
+/////
+// Implementation
+///
+inline atlas_packer::atlas_packer()
+{
+    reset( 0, 0 );
+}
+
+
+inline void atlas_packer::reset( unsigned int width, unsigned int height, unsigned int padding, unsigned int maxLayers )
+{
+    m_skylines.clear();
+    m_size[0] = width;
+    m_size[1] = height;
+    m_padding = padding;
+    m_maxLayers = maxLayers;
+    m_used = 0.0;
+}
+
+
+inline bool atlas_packer::insert( unsigned int width, unsigned int height, placement &p )
+{
+    p.x = p.y = 0;
+    p.layer = none;
+    p.width = width;
+    p.height = height;
+    p.scale[0] = p.scale[1] = p.offset[0] = p.offset[1] = 0.0f;
+
+    // the padding goes around the image
+    unsigned int w = width + 2*m_padding;
+    unsigned int h = height + 2*m_padding;
+    if( w > m_size[0] || h > m_size[1] )
+        throw std::runtime_error("nyx::atlas_packer::insert: the image is larger than a layer.");
+
+    // the first layer with room, a new one if there is none
+    std::size_t index = 0;
+    unsigned int y = 0;
+    unsigned int layer = 0;
+    while( layer < m_skylines.size() && !find( m_skylines[layer], w, h, index, y ) )
+        layer++;
+
+    if( layer == m_skylines.size() )
+    {
+        if( m_maxLayers != 0 && layer >= m_maxLayers )
+            return false;
+
+        segment ground = { 0, 0, m_size[0] };
+        m_skylines.push_back( std::vector<segment>( 1, ground ) );
+        index = 0;
+        y = 0;
+    }
+
+    p.x = m_skylines[layer][index].x + m_padding;
+    p.y = y + m_padding;
+    p.layer = layer;
+    p.scale[0] = float(width) / float(m_size[0]);
+    p.scale[1] = float(height) / float(m_size[1]);
+    p.offset[0] = float(p.x) / float(m_size[0]);
+    p.offset[1] = float(p.y) / float(m_size[1]);
+
+    place( m_skylines[layer], index, y, w, h );
+    m_used += double(w) * h;
+    return true;
+}
+
+
+inline std::size_t atlas_packer::pack( const unsigned int *sizes, std::size_t count, std::vector<placement> &placements )
+{
+    // tall images first, the short ones fill the gaps, sizes are pairs of width and height
+    std::vector<std::size_t> order( count );
+    for( std::size_t i=0; i<count; i++ )
+        order[i] = i;
+
+    std::stable_sort( order.begin(), order.end(), [sizes]( std::size_t a, std::size_t b )
+    {
+        return sizes[a*2+1] != sizes[b*2+1] ? sizes[a*2+1] > sizes[b*2+1] : sizes[a*2] > sizes[b*2];
+    } );
+
+    placements.resize( count );
+    std::size_t placed = 0;
+    for( std::size_t i=0; i<count; i++ )
+        if( insert( sizes[order[i]*2], sizes[order[i]*2+1], placements[order[i]] ) )
+            placed++;
+
+    return placed;
+}
+
+
+inline bool atlas_packer::fit( const std::vector<segment> &skyline, std::size_t i, unsigned int width, unsigned int height, unsigned int &y ) const
+{
+    if( skyline[i].x + width > m_size[0] )
+        return false;
+
+    // the image rests on the highest segment below it
+    y = 0;
+    for( unsigned int covered = 0; covered < width; i++ )
+    {
+        y = std::max( y, skyline[i].y );
+        if( y + height > m_size[1] )
+            return false;
+        covered += skyline[i].width;
+    }
+
+    return true;
+}
+
+
+inline bool atlas_packer::find( const std::vector<segment> &skyline, unsigned int width, unsigned int height, std::size_t &index, unsigned int &y ) const
+{
+    // lowest top edge, the leftmost one on ties
+    bool found = false;
+    unsigned int bestTop = none;
+    for( std::size_t i=0; i<skyline.size(); i++ )
+    {
+        unsigned int top = 0;
+        if( fit( skyline, i, width, height, top ) && top + height < bestTop )
+        {
+            bestTop = top + height;
+            index = i;
+            y = top;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+
+inline void atlas_packer::place( std::vector<segment> &skyline, std::size_t index, unsigned int y, unsigned int width, unsigned int height )
+{
+    segment top = { skyline[index].x, y + height, width };
+    skyline.insert( skyline.begin() + index, top );
+
+    // cut away what the image covers of the following segments
+    unsigned int end = top.x + top.width;
+    std::size_t i = index + 1;
+    while( i < skyline.size() && skyline[i].x < end )
+    {
+        unsigned int shrink = end - skyline[i].x;
+        if( skyline[i].width <= shrink )
+            skyline.erase( skyline.begin() + i );
+        else
+        {
+            skyline[i].x += shrink;
+            skyline[i].width -= shrink;
+            break;
+        }
+    }
+
+    // merge neighbours of the same height
+    for( i=1; i<skyline.size(); )
+    {
+        if( skyline[i-1].y == skyline[i].y )
+        {
+            skyline[i-1].width += skyline[i].width;
+            skyline.erase( skyline.begin() + i );
+        }
+        else
+            i++;
+    }
+}
+
+
+inline unsigned int atlas_packer::width() const
+{
+    return m_size[0];
+}
+
+
+inline unsigned int atlas_packer::height() const
+{
+    return m_size[1];
+}
+
+
+inline unsigned int atlas_packer::padding() const
+{
+    return m_padding;
+}
+
+
+inline unsigned int atlas_packer::layers() const
+{
+    return static_cast<unsigned int>( m_skylines.size() );
+}
+
+
+inline float atlas_packer::occupancy() const
+{
+    // share of the started layers covered by images and their padding
+    double area = double(m_size[0]) * m_size[1] * m_skylines.size();
+    return area > 0.0 ? static_cast<float>( m_used / area ) : 0.0f;
+}
+
+
+template <typename T>
+inline texture_atlas<T>::texture_atlas() : texture<T>()
+{
+}
+
+
+template <typename T>
+inline void texture_atlas<T>::configure( unsigned int width, unsigned int height, unsigned int layers, unsigned int padding )
+{
+    m_packer.reset( width, height, padding, layers );
+
+    // starts out cleared
+    texture<T>::set_layers( width, height, layers, 0 );
+}
+
+
+template <typename T>
+inline bool texture_atlas<T>::add( const T *pixels, unsigned int width, unsigned int height, placement &p )
+{
+    if( !texture<T>::m_allocated )
+        throw std::runtime_error("nyx::texture_atlas::add: the atlas has no storage, call configure first.");
+
+    if( !m_packer.insert( width, height, p ) )
+        return false;
+
+    upload( pixels, p );
+    texture<T>::generate_mipmaps( 0 );
+    return true;
+}
+
+
+template <typename T>
+inline std::size_t texture_atlas<T>::add( const T * const *pixels, const unsigned int *sizes, std::size_t count, std::vector<placement> &placements )
+{
+    if( !texture<T>::m_allocated )
+        throw std::runtime_error("nyx::texture_atlas::add: the atlas has no storage, call configure first.");
+
+    std::size_t placed = m_packer.pack( sizes, count, placements );
+    for( std::size_t i=0; i<count; i++ )
+        if( placements[i].layer != atlas_packer::none )
+            upload( pixels[i], placements[i] );
+
+    if( placed > 0 )
+        texture<T>::generate_mipmaps( 0 );
+
+    return placed;
+}
+
+
+template <typename T>
+inline const atlas_packer& texture_atlas<T>::packer() const
+{
+    return m_packer;
+}
+
+
+template <typename T>
+inline void texture_atlas<T>::upload( const T *pixels, const placement &p )
+{
+    if( p.width == 0 || p.height == 0 )
+        return;
+
+    // repeat the edge texels of the tightly packed image into the padding
+    std::size_t channels = util::channels( texture<T>::m_externalFormat );
+    unsigned int padding = m_packer.padding();
+    unsigned int w = p.width + 2*padding;
+    unsigned int h = p.height + 2*padding;
+    m_padded.resize( std::size_t(w) * h * channels );
+
+    for( unsigned int r=0; r<h; r++ )
+    {
+        unsigned int sr = std::min( std::max( r, padding ) - padding, p.height-1 );
+        const T *source = pixels + std::size_t(sr) * p.width * channels;
+        T *destination = &m_padded[ std::size_t(r) * w * channels ];
+
+        for( unsigned int c=0; c<padding; c++ )
+            std::copy( source, source + channels, destination + c*channels );
+        std::copy( source, source + p.width*channels, destination + padding*channels );
+        for( unsigned int c=padding+p.width; c<w; c++ )
+            std::copy( source + (p.width-1)*channels, source + p.width*channels, destination + c*channels );
+    }
+
+    unsigned int stride = texture<T>::m_stride;
+    texture<T>::m_stride = 0;
+    texture<T>::sub_image( &m_padded[0], 0, p.x-padding, p.y-padding, p.layer, w, h, 1 );
+    texture<T>::m_stride = stride;
+}
+
+
+} // end namespace nyx
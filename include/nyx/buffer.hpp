@@ -21,8 +21,18 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
 
 #include <nyx/util.hpp>
+#include <nyx/state.hpp>
+#include <nyx/resources.hpp>
+#include <nyx/quantize.hpp>
+#include <nyx/dirty_ranges.hpp>
+#include <nyx/mapped_range.hpp>
+#include <nyx/readback.hpp>
 
 
 namespace nyx
@@ -35,6 +45,7 @@ namespace nyx
  *      Author: alex
  *
  *      T - defines the type of the data used (float, double...)
+ *      D - the derived buffer class, see below
  *      target - target to map the buffer (GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER)
  *      state - defines the usage of the usage of the buffer (GL_VERTEX_ARRAY, GL_NORMAL_ARRAY, GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY, ...)
  *      size - how many components does the buffer have per element
@@ -43,17 +54,54 @@ namespace nyx
  *              (GL_STREAM_DRAW, GL_STREAM_READ, GL_STREAM_COPY)
  *              (GL_STATIC_DRAW, GL_STATIC_READ, GL_STATIC_COPY)
  *              (GL_DYNAMIC_DRAW, GL_DYNAMIC_READ, GL_DYNAMIC_COPY)
+ *      regions - number of frame sized regions used when streaming
+ *
+ *      With GL_STREAM_DRAW and buffer storage support (GL 4.4 / ARB_buffer_storage)
+ *      the buffer is allocated as immutable, persistently mapped storage split into
+ *      "regions" frame sized slices. Each update writes the next slice while the GPU
+ *      is still reading the previous ones, a fence guards every slice against reuse.
+ *      The slice currently in use is exposed through offset(). An update from the
+ *      client buffer rewrites the whole slice, any other update first carries the
+ *      previous slice over, so the storage is mapped for reading as well.
+ *
+ *      Offsets and counts are given in elements (vertices, primitives), not bytes.
+ *      Ranges of the client buffer marked with mark_dirty are uploaded lazily on the
+ *      next bind or flush, ranges closer than the merge distance are coalesced into a
+ *      single glBufferSubData call (see dirty_ranges.hpp).
+ *
+ *      resize and copy work on the GPU side only (glCopyBufferSubData), after a
+ *      resize the buffer no longer refers to a client buffer.
+ *
+ *      map_range maps elements for writing in place (GL_MAP_WRITE_BIT is implied,
+ *      GL_MAP_INVALIDATE_RANGE_BIT, GL_MAP_UNSYNCHRONIZED_BIT, ... may be added).
+ *      The buffer must not be drawn while the view is alive. A streaming buffer
+ *      instead moves on to the next region and hands out a view into it, the
+ *      region starts out as a copy of the previous one. Writes through a view
+ *      bypass the client buffer, don't mix them with mark_dirty.
+ *
+ *      read_async copies elements into the staging buffer of a readback handle
+ *      without waiting for the GPU, see readback.hpp.
+ *
+ *      set_encoding selects a compact storage format (see quantize.hpp), the client
+ *      data is encoded on every upload. Which encodings are available depends on the
+ *      kind of buffer. Encoded buffers can't be mapped or read back as T. A buffer
+ *      may also pick its encoding itself from the data of each upload (fit_encoding).
+ *
+ *      The buffer kinds derive with themselves as D (CRTP) and are dispatched
+ *      statically: D has to provide set_components and may hide bind, unbind,
+ *      is_encoding_supported and fit_encoding. Nothing is virtual, so a buffer
+ *      can't be used through a pointer to its base. The type constraints of the
+ *      kinds are checked at compile time.
  */
 
 
-template <typename T>
+template <typename T, typename D>
 class buffer
 {
 public:
     buffer();
-    virtual ~buffer();
 
-    void configure( unsigned int components, unsigned int usage=GL_STATIC_DRAW );
+    void configure( unsigned int components, unsigned int usage=GL_STATIC_DRAW, unsigned int regions=3 );
 
     void init( const T *buf, unsigned int count );
 
@@ -61,17 +109,56 @@ public:
     void update( const T *buf );
     void update();
 
-    virtual void bind() const;
-    virtual void unbind() const;
+    void resize( unsigned int count );
+    void copy( unsigned int srcOffset, unsigned int dstOffset, unsigned int count );
+
+    mapped_range<T> map_range( unsigned int offset, unsigned int count, unsigned int flags=GL_MAP_INVALIDATE_RANGE_BIT );
+
+    void read_async( readback<T> &result, unsigned int offset, unsigned int count ) const;
+    void read_async( readback<T> &result ) const;
+
+    void set_encoding( unsigned int encoding );
+    unsigned int encoding() const;
+
+    void mark_dirty( unsigned int offset, unsigned int count );
+    void set_merge_distance( unsigned int distance );
+    void flush() const;
+
+    void bind() const;
+    void unbind() const;
 
     unsigned int id() const;
     unsigned int count() const;
     unsigned int size() const;
+    std::size_t offset() const;
     bool is_valid() const;
+    bool is_streaming() const;
+
+    std::size_t bytes_uploaded() const;
+    std::size_t bytes_saved() const;
+    void reset_statistics();
 
 protected:
-    virtual void set_components( unsigned int components ) = 0;
+    ~buffer();
+
+    D& derived();
+    const D& derived() const;
+
+    bool is_encoding_supported( unsigned int encoding ) const;
+    bool fit_encoding( const T *buf, unsigned int count, bool whole ) const;
     void set_usage( unsigned int usage );
+    void set_regions( unsigned int regions );
+
+    std::size_t element_size() const;
+    unsigned int gl_type() const;
+    int gl_components() const;
+    const GLvoid* encode( const T *buf, unsigned int count ) const;
+
+    void allocate() const;
+    void init_stream();
+    void stream( const T *buf, unsigned int count, unsigned int offset ) const;
+    void wait_region( unsigned int region ) const;
+    void release();
 
     void set_size( unsigned int size );
     void set_target( unsigned int target );
@@ -88,14 +175,36 @@ protected:
     unsigned int m_state;
     unsigned int m_usage;
 
+    // registry the name came from
+    resources *m_resources;
+
     bool m_configured;
     bool m_initialized;
     bool m_valid;
+
+    // persistent mapped ring
+    bool m_streaming;
+    unsigned int m_regions;
+    mutable unsigned int m_region;
+    unsigned char *m_mapped;
+    mutable std::vector<GLsync> m_fences;
+
+    // storage format and the scratch space to encode into
+    mutable unsigned int m_encoding;
+    mutable std::vector<unsigned char> m_encoded;
+
+    // pending partial uploads, as [begin, end) element ranges
+    mutable dirty_ranges m_dirty;
+    unsigned int m_mergeDistance;
+
+    // statistics
+    mutable std::size_t m_bytesUploaded;
+    mutable std::size_t m_bytesSaved;
 };
 
 
-template <typename T>
-inline buffer<T>::buffer() :
+template <typename T, typename D>
+inline buffer<T, D>::buffer() :
     m_buffer(0),
     m_count(0),
     m_size(0),
@@ -103,30 +212,54 @@ inline buffer<T>::buffer() :
     m_target(0),
     m_state(0),
     m_usage(0),
+    m_resources(0),
     m_configured(false),
-    m_valid(false)
+    m_initialized(false),
+    m_valid(false),
+    m_streaming(false),
+    m_regions(0),
+    m_region(0),
+    m_mapped(0),
+    m_encoding(encode_none),
+    m_mergeDistance(64),
+    m_bytesUploaded(0),
+    m_bytesSaved(0)
+{
+}
+
+
+template <typename T, typename D>
+inline buffer<T, D>::~buffer()
+{
+    release();
+}
+
+template <typename T, typename D>
+inline D& buffer<T, D>::derived()
 {
+    return static_cast<D&>( *this );
 }
 
 
-template <typename T>
-inline buffer<T>::~buffer()
+template <typename T, typename D>
+inline const D& buffer<T, D>::derived() const
 {
-    if( m_valid )
-        glDeleteBuffers( 1, &m_identifier);
+    return static_cast<const D&>( *this );
 }
 
-template <typename T>
-inline void buffer<T>::configure( unsigned int components, unsigned int usage )
+
+template <typename T, typename D>
+inline void buffer<T, D>::configure( unsigned int components, unsigned int usage, unsigned int regions )
 {
-    set_components(components);
+    derived().set_components(components);
     set_usage(usage);
+    set_regions(regions);
     m_configured = true;
 }
 
 
-template <typename T>
-inline void buffer<T>::init( const T *buf, unsigned int count )
+template <typename T, typename D>
+inline void buffer<T, D>::init( const T *buf, unsigned int count )
 {
     if( m_configured )
     {
@@ -134,102 +267,369 @@ inline void buffer<T>::init( const T *buf, unsigned int count )
         m_count = count;
 
         // delete old content if present
-        if( m_valid )
-        {
-            glDeleteBuffers( 1, &m_identifier);
-            m_valid = false;
-        }
+        release();
 
         // generate new buffer
-        glGenBuffers( 1, &m_identifier);
+        m_resources = &resources::current();
+        m_identifier = m_resources->create_buffer();
+        m_initialized = true;
 
         // update contents
-        update();
+        if( m_streaming )
+            init_stream();
+        else
+            update();
     }
 }
 
 
-template <typename T>
-inline void buffer<T>::update( const T *buf, unsigned int count, unsigned int offset)
+template <typename T, typename D>
+inline void buffer<T, D>::update( const T *buf, unsigned int count, unsigned int offset)
 {
-    if( m_valid )
+    if( m_valid && m_streaming )
+        stream( buf, count, offset );
+    else if( m_valid )
     {
-        m_buffer = buf;
-        glBindBuffer( m_target, m_identifier);
-        glBufferSubData( m_target, offset, count*sizeof(T)*m_size, m_buffer);
-        glBindBuffer( m_target, 0);
+        // a wider storage format needs everything uploaded again
+        if( derived().fit_encoding( buf, count, false ) )
+        {
+            if( m_buffer == 0 )
+                throw std::runtime_error("nyx::buffer::update: the storage format changed and there is no client buffer to upload again.");
+            allocate();
+        }
+
+        if( state::current().direct_state_access() )
+            glNamedBufferSubData( m_identifier, offset*element_size(), count*element_size(), encode( buf, count ) );
+        else
+        {
+            state::current().bind_buffer( m_target, m_identifier );
+            glBufferSubData( m_target, offset*element_size(), count*element_size(), encode( buf, count ) );
+            state::current().bind_buffer( m_target, 0 );
+        }
+        m_bytesUploaded += count*element_size();
     }
 }
 
 
-template <typename T>
-inline void buffer<T>::update( const T *buf )
+template <typename T, typename D>
+inline void buffer<T, D>::update( const T *buf )
 {
     m_buffer = buf;
     update();
 }
 
 
-template <typename T>
-inline void buffer<T>::update()
+template <typename T, typename D>
+inline void buffer<T, D>::update()
 {
-    if( m_identifier != 0 )
+    if( m_valid && m_streaming )
+        stream( m_buffer, m_count, 0 );
+    else if( m_identifier != 0 )
     {
-        glBindBuffer( m_target, m_identifier);
-        glBufferData( m_target, m_count*sizeof(T)*m_size, m_buffer, m_usage);
-        glBindBuffer( m_target, 0);
+        derived().fit_encoding( m_buffer, m_count, true );
+        allocate();
         m_valid = true;
     }
+
+    // everything is up to date now
+    m_dirty.clear();
 }
 
 
-template <typename T>
-inline void buffer<T>::bind() const
+template <typename T, typename D>
+inline void buffer<T, D>::resize( unsigned int count )
 {
-    glEnableClientState( m_state );
-    glBindBuffer( m_target, m_identifier);
+    if( !m_valid || m_streaming )
+        throw std::runtime_error("nyx::buffer::resize: only initialized, non streaming buffers can be resized.");
+
+    // allocate the new storage
+    unsigned int identifier = m_resources->create_buffer();
+    if( state::current().direct_state_access() )
+    {
+        glNamedBufferData( identifier, count*element_size(), 0, m_usage );
+        glCopyNamedBufferSubData( m_identifier, identifier, 0, 0, std::min( count, m_count )*element_size() );
+    }
+    else
+    {
+        state::current().bind_buffer( GL_COPY_WRITE_BUFFER, identifier );
+        glBufferData( GL_COPY_WRITE_BUFFER, count*element_size(), 0, m_usage );
+
+        // keep what fits
+        state::current().bind_buffer( GL_COPY_READ_BUFFER, m_identifier );
+        glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, std::min( count, m_count )*element_size() );
+    }
+
+    m_resources->release_buffer( m_identifier );
+
+    m_identifier = identifier;
+    m_count = count;
+    m_buffer = 0;
+    m_dirty.clear();
 }
 
 
-template <typename T>
-inline void buffer<T>::unbind() const
+template <typename T, typename D>
+inline void buffer<T, D>::copy( unsigned int srcOffset, unsigned int dstOffset, unsigned int count )
 {
-    glEnableClientState( m_state );
-    glBindBuffer( m_target, 0);
-    glDisableClientState( m_state );
+    if( !m_valid || count == 0 || srcOffset == dstOffset )
+        return;
+
+    std::size_t src = srcOffset*element_size();
+    std::size_t dst = dstOffset*element_size();
+    std::size_t length = count*element_size();
+
+    if( state::current().direct_state_access() )
+    {
+        if( src+length <= dst || dst+length <= src )
+        {
+            glCopyNamedBufferSubData( m_identifier, m_identifier, src, dst, length );
+            return;
+        }
+
+        unsigned int temporary = m_resources->create_buffer();
+        glNamedBufferData( temporary, length, 0, GL_STREAM_COPY );
+        glCopyNamedBufferSubData( m_identifier, temporary, src, 0, length );
+        glCopyNamedBufferSubData( temporary, m_identifier, 0, dst, length );
+        m_resources->release_buffer( temporary );
+        return;
+    }
+
+    state::current().bind_buffer( GL_COPY_READ_BUFFER, m_identifier );
+    state::current().bind_buffer( GL_COPY_WRITE_BUFFER, m_identifier );
+
+    if( src+length <= dst || dst+length <= src )
+    {
+        glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, src, dst, length );
+        return;
+    }
+
+    // overlapping ranges have to go through a temporary buffer
+    unsigned int temporary = m_resources->create_buffer();
+    state::current().bind_buffer( GL_COPY_WRITE_BUFFER, temporary );
+    glBufferData( GL_COPY_WRITE_BUFFER, length, 0, GL_STREAM_COPY );
+    glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, src, 0, length );
+
+    state::current().bind_buffer( GL_COPY_READ_BUFFER, temporary );
+    state::current().bind_buffer( GL_COPY_WRITE_BUFFER, m_identifier );
+    glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, dst, length );
+
+    m_resources->release_buffer( temporary );
+}
+
+
+template <typename T, typename D>
+inline mapped_range<T> buffer<T, D>::map_range( unsigned int offset, unsigned int count, unsigned int flags )
+{
+    if( !m_valid )
+        throw std::runtime_error("nyx::buffer::map_range: the buffer is not initialized.");
+    if( m_encoding != encode_none )
+        throw std::runtime_error("nyx::buffer::map_range: encoded buffers can not be mapped.");
+    if( offset+count > m_count || offset+count < offset )
+        throw std::out_of_range("nyx::buffer::map_range: range exceeds the buffer.");
+
+    // the ring is mapped already, write into the next region
+    if( m_streaming )
+    {
+        stream( 0, 0, 0 );
+        m_bytesUploaded += count*element_size();
+        T *data = reinterpret_cast<T*>( m_mapped + this->offset() + offset*element_size() );
+        return mapped_range<T>( data, count, m_size, m_target, m_identifier, flags, true );
+    }
+
+    flags = (flags | GL_MAP_WRITE_BIT) & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                          GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_FLUSH_EXPLICIT_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+    T *data = 0;
+    if( state::current().direct_state_access() )
+        data = static_cast<T*>( glMapNamedBufferRange( m_identifier, offset*element_size(), count*element_size(), flags ) );
+    else
+    {
+        state::current().bind_buffer( m_target, m_identifier );
+        data = static_cast<T*>( glMapBufferRange( m_target, offset*element_size(), count*element_size(), flags ) );
+        state::current().bind_buffer( m_target, 0 );
+    }
+
+    if( data == 0 )
+        throw std::runtime_error("nyx::buffer::map_range: unable to map the buffer.");
+
+    m_bytesUploaded += count*element_size();
+    return mapped_range<T>( data, count, m_size, m_target, m_identifier, flags, false );
 }
 
 
-template <typename T>
-inline unsigned int buffer<T>::id() const
+template <typename T, typename D>
+inline void buffer<T, D>::read_async( readback<T> &result, unsigned int offset, unsigned int count ) const
+{
+    if( !m_valid )
+        throw std::runtime_error("nyx::buffer::read_async: the buffer is not initialized.");
+    if( m_encoding != encode_none )
+        throw std::runtime_error("nyx::buffer::read_async: encoded buffers can not be read back.");
+    if( offset+count > m_count || offset+count < offset )
+        throw std::out_of_range("nyx::buffer::read_async: range exceeds the buffer.");
+
+    // pending uploads belong to the contents
+    flush();
+    result.request( m_identifier, this->offset() + offset*element_size(), count*element_size() );
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::read_async( readback<T> &result ) const
+{
+    read_async( result, 0, m_count );
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::set_encoding( unsigned int encoding )
+{
+    if( !m_configured || m_initialized )
+        throw std::runtime_error("nyx::buffer::set_encoding: the encoding has to be set between configure and init.");
+    if( encoding != encode_none && util::type<T>::is_integer() )
+        throw std::runtime_error("nyx::buffer::set_encoding: only floating point data can be encoded.");
+    if( !derived().is_encoding_supported( encoding ) )
+        throw std::runtime_error("nyx::buffer::set_encoding: encoding not supported by this buffer.");
+    if( (encoding == encode_2_10_10_10 && m_size < 3) || (encoding == encode_octahedral && m_size != 3) )
+        throw std::runtime_error("nyx::buffer::set_encoding: encoding does not fit the number of components.");
+
+    m_encoding = encoding;
+}
+
+
+template <typename T, typename D>
+inline unsigned int buffer<T, D>::encoding() const
+{
+    return m_encoding;
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::mark_dirty( unsigned int offset, unsigned int count )
+{
+    m_dirty.mark( offset, count, m_count );
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::set_merge_distance( unsigned int distance )
+{
+    m_mergeDistance = distance;
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::flush() const
+{
+    if( m_dirty.empty() || !m_valid || m_buffer == 0 )
+        return;
+
+    // the next ring region has to be filled completely anyway
+    if( m_streaming )
+    {
+        stream( m_buffer, m_count, 0 );
+        m_dirty.clear();
+        return;
+    }
+
+    // if the dirty data doesn't fit the storage format anymore everything goes up again
+    bool refit = false;
+    for( size_t i=0; i<m_dirty.size(); i++ )
+        refit = derived().fit_encoding( m_buffer + m_dirty[i].first*m_size, m_dirty[i].second-m_dirty[i].first, false ) || refit;
+
+    if( refit )
+    {
+        allocate();
+        return;
+    }
+
+    // coalesce overlapping and nearby ranges, upload each merged range once
+    std::size_t uploaded = m_dirty.merge( m_mergeDistance ) * element_size();
+
+    bool direct = state::current().direct_state_access();
+    if( !direct )
+        state::current().bind_buffer( m_target, m_identifier );
+
+    for( size_t i=0; i<m_dirty.size(); i++ )
+    {
+        unsigned int begin = m_dirty[i].first;
+        unsigned int end = m_dirty[i].second;
+        if( direct )
+            glNamedBufferSubData( m_identifier, begin*element_size(), (end-begin)*element_size(), encode( m_buffer + begin*m_size, end-begin ) );
+        else
+            glBufferSubData( m_target, begin*element_size(), (end-begin)*element_size(), encode( m_buffer + begin*m_size, end-begin ) );
+    }
+
+    if( !direct )
+        state::current().bind_buffer( m_target, 0 );
+    m_dirty.clear();
+
+    m_bytesUploaded += uploaded;
+    m_bytesSaved += m_count*element_size() - uploaded;
+}
+
+template <typename T, typename D>
+inline void buffer<T, D>::bind() const
+{
+    flush();
+    if( m_state != 0 )
+        state::current().enable_client_state( m_state );
+    state::current().bind_buffer( m_target, m_identifier );
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::unbind() const
+{
+    state::current().bind_buffer( m_target, 0 );
+    if( m_state != 0 )
+        state::current().disable_client_state( m_state );
+}
+
+
+template <typename T, typename D>
+inline unsigned int buffer<T, D>::id() const
 {
     return m_identifier;
 }
 
 
-template <typename T>
-inline unsigned int buffer<T>::count() const
+template <typename T, typename D>
+inline unsigned int buffer<T, D>::count() const
 {
     return m_count;
 }
 
 
-template <typename T>
-inline unsigned int buffer<T>::size() const
+template <typename T, typename D>
+inline unsigned int buffer<T, D>::size() const
 {
     return m_size;
 }
 
 
-template <typename T>
-inline bool buffer<T>::is_valid() const
+template <typename T, typename D>
+inline std::size_t buffer<T, D>::offset() const
+{
+    return m_streaming ? m_region * m_count * element_size() : 0;
+}
+
+
+template <typename T, typename D>
+inline bool buffer<T, D>::is_valid() const
 {
     return m_valid;
 }
 
 
-template <typename T>
-inline void buffer<T>::set_usage( unsigned int usage )
+template <typename T, typename D>
+inline bool buffer<T, D>::is_streaming() const
+{
+    return m_streaming;
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::set_usage( unsigned int usage )
 {
     // check the buffer usage
     switch( usage )
@@ -252,20 +652,259 @@ inline void buffer<T>::set_usage( unsigned int usage )
 }
 
 
-template <typename T>
-inline void buffer<T>::set_size( unsigned int size )
+template <typename T, typename D>
+inline std::size_t buffer<T, D>::bytes_uploaded() const
+{
+    return m_bytesUploaded;
+}
+
+
+template <typename T, typename D>
+inline std::size_t buffer<T, D>::bytes_saved() const
+{
+    return m_bytesSaved;
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::reset_statistics()
+{
+    m_bytesUploaded = 0;
+    m_bytesSaved = 0;
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::set_regions( unsigned int regions )
+{
+    // stream through a persistent mapped ring only if the driver can do it
+    bool storage = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+    m_regions = regions;
+    m_streaming = m_usage == GL_STREAM_DRAW && regions > 1 && storage;
+}
+
+
+template <typename T, typename D>
+inline bool buffer<T, D>::is_encoding_supported( unsigned int encoding ) const
+{
+    return encoding == encode_none;
+}
+
+
+template <typename T, typename D>
+inline bool buffer<T, D>::fit_encoding( const T *, unsigned int, bool ) const
+{
+    return false;
+}
+
+
+template <typename T, typename D>
+inline std::size_t buffer<T, D>::element_size() const
+{
+    // bytes per element on the GPU
+    switch( m_encoding )
+    {
+        case encode_2_10_10_10 : return 4;
+        case encode_octahedral : return 2*sizeof(short);
+        case encode_none :       return m_size*sizeof(T);
+        default :                return m_size*util::size_of( gl_type() );
+    }
+}
+
+
+template <typename T, typename D>
+inline unsigned int buffer<T, D>::gl_type() const
+{
+    switch( m_encoding )
+    {
+        case encode_half :       return GL_HALF_FLOAT;
+        case encode_2_10_10_10 : return GL_INT_2_10_10_10_REV;
+        case encode_unorm16 :
+        case encode_uint16 :     return GL_UNSIGNED_SHORT;
+        case encode_uint8 :      return GL_UNSIGNED_BYTE;
+        case encode_snorm16 :
+        case encode_octahedral : return GL_SHORT;
+        default :                return util::type<T>::GL();
+    }
+}
+
+
+template <typename T, typename D>
+inline int buffer<T, D>::gl_components() const
+{
+    switch( m_encoding )
+    {
+        case encode_2_10_10_10 : return 4;
+        case encode_octahedral : return 2;
+        default :                return static_cast<int>( m_size );
+    }
+}
+
+
+template <typename T, typename D>
+inline const GLvoid* buffer<T, D>::encode( const T *buf, unsigned int count ) const
+{
+    if( m_encoding == encode_none || buf == 0 )
+        return buf;
+
+    std::size_t n = static_cast<std::size_t>(count)*m_size;
+    m_encoded.resize( std::max<std::size_t>( count*element_size(), 1 ) );
+    void *destination = &m_encoded[0];
+
+    switch( m_encoding )
+    {
+        case encode_half :       util::encode_half( buf, static_cast<unsigned short*>(destination), n ); break;
+        case encode_unorm16 :    util::encode_unorm16( buf, static_cast<unsigned short*>(destination), n ); break;
+        case encode_snorm16 :    util::encode_snorm16( buf, static_cast<short*>(destination), n ); break;
+        case encode_2_10_10_10 : util::encode_2_10_10_10( buf, static_cast<unsigned int*>(destination), count, m_size ); break;
+        case encode_octahedral : util::encode_octahedral( buf, static_cast<short*>(destination), count ); break;
+        case encode_uint8 :      util::narrow( buf, static_cast<unsigned char*>(destination), n ); break;
+        case encode_uint16 :     util::narrow( buf, static_cast<unsigned short*>(destination), n ); break;
+    }
+
+    return destination;
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::allocate() const
+{
+    // (re)allocate the storage with the whole client buffer
+    if( state::current().direct_state_access() )
+        glNamedBufferData( m_identifier, m_count*element_size(), encode( m_buffer, m_count ), m_usage );
+    else
+    {
+        state::current().bind_buffer( m_target, m_identifier );
+        glBufferData( m_target, m_count*element_size(), encode( m_buffer, m_count ), m_usage);
+        state::current().bind_buffer( m_target, 0 );
+    }
+
+    m_bytesUploaded += m_count*element_size();
+    m_dirty.clear();
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::init_stream()
+{
+    GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    std::size_t length = m_regions * m_count * element_size();
+
+    // allocate immutable storage for all regions and keep it mapped
+    if( state::current().direct_state_access() )
+    {
+        glNamedBufferStorage( m_identifier, length, 0, flags );
+        m_mapped = static_cast<unsigned char*>( glMapNamedBufferRange( m_identifier, 0, length, flags ) );
+    }
+    else
+    {
+        state::current().bind_buffer( m_target, m_identifier );
+        glBufferStorage( m_target, length, 0, flags );
+        m_mapped = static_cast<unsigned char*>( glMapBufferRange( m_target, 0, length, flags ) );
+        state::current().bind_buffer( m_target, 0 );
+    }
+
+    if( m_mapped == 0 )
+        throw std::runtime_error("nyx::buffer::init_stream: unable to map the buffer storage.");
+
+    // no region is in flight yet
+    m_fences.assign( m_regions, GLsync(0) );
+    m_region = 0;
+    m_valid = true;
+
+    // fill the first region
+    if( m_buffer != 0 )
+    {
+        std::memcpy( m_mapped, encode( m_buffer, m_count ), m_count*element_size() );
+        m_bytesUploaded += m_count*element_size();
+    }
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::stream( const T *buf, unsigned int count, unsigned int offset ) const
+{
+    std::size_t length = m_count*element_size();
+    const unsigned char *previous = m_mapped + m_region*length;
+
+    // fence the region submitted so far and move on to the next one
+    m_fences[m_region] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    m_region = (m_region+1) % m_regions;
+    wait_region( m_region );
+
+    unsigned char *region = m_mapped + m_region*length;
+
+    // the client buffer holds the whole frame
+    if( buf != 0 && buf == m_buffer )
+    {
+        std::memcpy( region, encode( m_buffer, m_count ), length );
+        m_bytesUploaded += length;
+        return;
+    }
+
+    // otherwise the rest of the frame is what was submitted last
+    std::memcpy( region, previous, length );
+
+    if( buf != 0 )
+    {
+        std::memcpy( region + offset*element_size(), encode( buf, count ), count*element_size() );
+        m_bytesUploaded += count*element_size();
+    }
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::wait_region( unsigned int region ) const
+{
+    GLsync fence = m_fences[region];
+    if( fence == 0 )
+        return;
+
+    // the GPU usually finished long ago, only flush if we really have to wait
+    GLenum result = glClientWaitSync( fence, 0, 0 );
+    while( result == GL_TIMEOUT_EXPIRED )
+        result = glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 );
+
+    glDeleteSync( fence );
+    m_fences[region] = 0;
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::release()
+{
+    // deleting the buffer also unmaps it
+    if( m_initialized )
+    {
+        for( size_t i=0; i<m_fences.size(); i++ )
+            m_resources->release_sync( m_fences[i] );
+        m_resources->release_buffer( m_identifier );
+    }
+    m_fences.clear();
+
+    m_dirty.clear();
+    m_mapped = 0;
+    m_identifier = 0;
+    m_initialized = false;
+    m_valid = false;
+}
+
+
+template <typename T, typename D>
+inline void buffer<T, D>::set_size( unsigned int size )
 {
     m_size = size;
 }
 
-template <typename T>
-inline void buffer<T>::set_target( unsigned int target )
+template <typename T, typename D>
+inline void buffer<T, D>::set_target( unsigned int target )
 {
     m_target = target;
 }
 
-template <typename T>
-inline void buffer<T>::set_state( unsigned int state )
+template <typename T, typename D>
+inline void buffer<T, D>::set_state( unsigned int state )
 {
     m_state = state;
 }
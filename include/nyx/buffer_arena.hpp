@@ -0,0 +1,411 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <nyx/util.hpp>
+#include <nyx/state.hpp>
+#include <nyx/resources.hpp>
+#include <nyx/offset_allocator.hpp>
+
+#include <nyx/vertex_array_buffer.hpp>
+#include <nyx/normal_array_buffer.hpp>
+#include <nyx/color_array_buffer.hpp>
+#include <nyx/texcoord_array_buffer.hpp>
+#include <nyx/element_buffer.hpp>
+
+namespace nyx
+{
+
+/*
+ * buffer_arena.hpp
+ *
+ *      Ta - defines the type of the attribute data (float, double...)
+ *      Te - defines the type of the element data
+ *
+ *      Shares a few large buffers between many small meshes. Vertex ranges are
+ *      allocated jointly for all attribute buffers, so a mesh has the same base
+ *      vertex in each of them, element ranges hold mesh relative indices and are
+ *      drawn with glDrawElementsBaseVertex. All meshes of an arena are drawn
+ *      through one VAO. The buffers grow when they run full, defragment() packs
+ *      the ranges to the front. Range handles stay valid across both.
+ *
+ *      generation() changes whenever ranges are allocated, freed or moved, so
+ *      anything caching their offsets (e.g. a draw_batch) knows when to look
+ *      them up again.
+ *
+ *      A color or texture coordinate size of 0 leaves the respective buffer out.
+ */
+
+
+template <typename Ta=float, typename Te=unsigned int>
+class buffer_arena
+{
+public:
+    static const unsigned int none = offset_allocator::none;
+
+    buffer_arena();
+    virtual ~buffer_arena();
+
+    void configure( unsigned int vertexSize, unsigned int colorSize, unsigned int texCoordSize, unsigned int usage=GL_STATIC_DRAW );
+    void configure( unsigned int usage=GL_STATIC_DRAW );
+
+    void set_encoding( unsigned int vertexEncoding, unsigned int normalEncoding, unsigned int colorEncoding, unsigned int texCoordEncoding );
+
+    void init( unsigned int vertexCapacity, unsigned int elementCapacity );
+
+    unsigned int allocate_vertices( unsigned int count );
+    unsigned int allocate_elements( unsigned int count );
+    void free_vertices( unsigned int range );
+    void free_elements( unsigned int range );
+
+    unsigned int vertex_offset( unsigned int range ) const;
+    unsigned int vertex_count( unsigned int range ) const;
+    unsigned int element_offset( unsigned int range ) const;
+    unsigned int element_count( unsigned int range ) const;
+
+    void update_vertices( unsigned int range, const Ta *vertices );
+    void update_normals( unsigned int range, const Ta *normals );
+    void update_colors( unsigned int range, const Ta *colors );
+    void update_texcoords( unsigned int range, const Ta *texCoords );
+    void update_elements( unsigned int range, const Te *elements );
+
+    void defragment();
+
+    void bind() const;
+    void unbind() const;
+
+    unsigned int vertex_capacity() const;
+    unsigned int element_capacity() const;
+    unsigned int vertex_size() const;
+    unsigned int generation() const;
+
+protected:
+    void bind_buffers() const;
+    void grow_vertices( unsigned int count );
+    void grow_elements( unsigned int count );
+
+protected:
+    // range allocators
+    offset_allocator m_vertexRanges;
+    offset_allocator m_elementRanges;
+
+    // shared buffers
+    vertex_array_buffer<Ta> m_vertices;
+    normal_array_buffer<Ta> m_normals;
+    color_array_buffer<Ta> m_colors;
+    texcoord_array_buffer<Ta> m_texCoords;
+    element_buffer<Te> m_elements;
+
+    bool m_hasColors;
+    bool m_hasTexCoords;
+
+    // vertex array object and the buffer names it was recorded with
+    mutable unsigned int m_vao;
+    mutable unsigned int m_layout[5];
+    mutable resources *m_resources;
+
+    // bumped on every change of the range layout
+    unsigned int m_generation;
+};
+
+
+template <typename Ta, typename Te>
+inline buffer_arena<Ta, Te>::buffer_arena() :
+    m_hasColors(false),
+    m_hasTexCoords(false),
+    m_vao(0),
+    m_resources(0),
+    m_generation(0)
+{
+    std::fill( m_layout, m_layout+5, 0 );
+}
+
+
+template <typename Ta, typename Te>
+inline buffer_arena<Ta, Te>::~buffer_arena()
+{
+    if( m_resources != 0 )
+        m_resources->release_vertex_array( m_vao );
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::configure( unsigned int vertexSize, unsigned int colorSize, unsigned int texCoordSize, unsigned int usage )
+{
+    m_hasColors = colorSize > 0;
+    m_hasTexCoords = texCoordSize > 0;
+
+    m_vertices.configure(vertexSize, usage);
+    m_normals.configure(3, usage);
+    if( m_hasColors ) m_colors.configure(colorSize, usage);
+    if( m_hasTexCoords ) m_texCoords.configure(texCoordSize, usage);
+
+    // the arena counts single indices, the primitive is up to the meshes
+    m_elements.configure(GL_POINTS, usage);
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::configure( unsigned int usage )
+{
+    configure(3, 3, 2, usage);
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::set_encoding( unsigned int vertexEncoding, unsigned int normalEncoding, unsigned int colorEncoding, unsigned int texCoordEncoding )
+{
+    m_vertices.set_encoding(vertexEncoding);
+    m_normals.set_encoding(normalEncoding);
+    if( m_hasColors ) m_colors.set_encoding(colorEncoding);
+    if( m_hasTexCoords ) m_texCoords.set_encoding(texCoordEncoding);
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::init( unsigned int vertexCapacity, unsigned int elementCapacity )
+{
+    // allocate storage only
+    m_vertices.init(0, vertexCapacity);
+    m_normals.init(0, vertexCapacity);
+    if( m_hasColors ) m_colors.init(0, vertexCapacity);
+    if( m_hasTexCoords ) m_texCoords.init(0, vertexCapacity);
+    m_elements.init(0, elementCapacity);
+
+    m_vertexRanges.reset(vertexCapacity);
+    m_elementRanges.reset(elementCapacity);
+    m_generation++;
+}
+
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::allocate_vertices( unsigned int count )
+{
+    unsigned int range = m_vertexRanges.allocate(count);
+    if( range == none && count > 0 )
+    {
+        grow_vertices(count);
+        range = m_vertexRanges.allocate(count);
+    }
+
+    m_generation++;
+    return range;
+}
+
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::allocate_elements( unsigned int count )
+{
+    unsigned int range = m_elementRanges.allocate(count);
+    if( range == none && count > 0 )
+    {
+        grow_elements(count);
+        range = m_elementRanges.allocate(count);
+    }
+
+    m_generation++;
+    return range;
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::free_vertices( unsigned int range ){ m_vertexRanges.free(range); m_generation++; }
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::free_elements( unsigned int range ){ m_elementRanges.free(range); m_generation++; }
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::vertex_offset( unsigned int range ) const { return m_vertexRanges.offset(range); }
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::vertex_count( unsigned int range ) const { return m_vertexRanges.size(range); }
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::element_offset( unsigned int range ) const { return m_elementRanges.offset(range); }
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::element_count( unsigned int range ) const { return m_elementRanges.size(range); }
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::vertex_capacity() const { return m_vertexRanges.capacity(); }
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::element_capacity() const { return m_elementRanges.capacity(); }
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::vertex_size() const { return m_vertices.size(); }
+
+template <typename Ta, typename Te>
+inline unsigned int buffer_arena<Ta, Te>::generation() const { return m_generation; }
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::update_vertices( unsigned int range, const Ta *vertices )
+{
+    m_vertices.update( vertices, m_vertexRanges.size(range), m_vertexRanges.offset(range) );
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::update_normals( unsigned int range, const Ta *normals )
+{
+    m_normals.update( normals, m_vertexRanges.size(range), m_vertexRanges.offset(range) );
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::update_colors( unsigned int range, const Ta *colors )
+{
+    if( m_hasColors )
+        m_colors.update( colors, m_vertexRanges.size(range), m_vertexRanges.offset(range) );
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::update_texcoords( unsigned int range, const Ta *texCoords )
+{
+    if( m_hasTexCoords )
+        m_texCoords.update( texCoords, m_vertexRanges.size(range), m_vertexRanges.offset(range) );
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::update_elements( unsigned int range, const Te *elements )
+{
+    m_elements.update( elements, m_elementRanges.size(range), m_elementRanges.offset(range) );
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::defragment()
+{
+    std::vector<offset_allocator::relocation> moves;
+
+    // moves are in ascending order and only towards the front, so they never clobber each other
+    m_vertexRanges.defragment( moves );
+    for( size_t i=0; i<moves.size(); i++ )
+    {
+        m_vertices.copy( moves[i].from, moves[i].to, moves[i].size );
+        m_normals.copy( moves[i].from, moves[i].to, moves[i].size );
+        if( m_hasColors ) m_colors.copy( moves[i].from, moves[i].to, moves[i].size );
+        if( m_hasTexCoords ) m_texCoords.copy( moves[i].from, moves[i].to, moves[i].size );
+    }
+
+    m_elementRanges.defragment( moves );
+    for( size_t i=0; i<moves.size(); i++ )
+        m_elements.copy( moves[i].from, moves[i].to, moves[i].size );
+
+    m_generation++;
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::bind() const
+{
+    if( !m_vertices.is_valid() )
+        throw std::runtime_error( "buffer_arena::bind: the arena is not initialized." );
+
+    // without VAOs bind everything on every draw
+    if( !(GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object) )
+    {
+        bind_buffers();
+        return;
+    }
+
+    // growing replaces the buffers, the VAO has to follow
+    unsigned int layout[5] = { m_vertices.id(), m_normals.id(), m_colors.id(), m_texCoords.id(), m_elements.id() };
+    if( m_vao != 0 && std::equal( layout, layout+5, m_layout ) )
+    {
+        state::current().bind_vertex_array( m_vao );
+        return;
+    }
+
+    if( m_vao == 0 )
+    {
+        m_resources = &resources::current();
+        m_vao = m_resources->create_vertex_array();
+    }
+
+    state::current().bind_vertex_array( m_vao );
+    bind_buffers();
+    state::current().bind_buffer( GL_ARRAY_BUFFER, 0 );
+
+    std::copy( layout, layout+5, m_layout );
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::unbind() const
+{
+    if( m_vao != 0 )
+    {
+        state::current().release_vertex_array();
+        return;
+    }
+
+    m_vertices.unbind();
+    m_normals.unbind();
+    m_colors.unbind();
+    m_texCoords.unbind();
+    m_elements.unbind();
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::bind_buffers() const
+{
+    m_vertices.bind();
+    m_normals.bind();
+    if( m_hasColors ) m_colors.bind(); else m_colors.unbind();
+    if( m_hasTexCoords ) m_texCoords.bind(); else m_texCoords.unbind();
+    m_elements.bind();
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::grow_vertices( unsigned int count )
+{
+    unsigned int capacity = std::max( 2*m_vertexRanges.capacity(), m_vertexRanges.capacity() + count );
+
+    m_vertices.resize(capacity);
+    m_normals.resize(capacity);
+    if( m_hasColors ) m_colors.resize(capacity);
+    if( m_hasTexCoords ) m_texCoords.resize(capacity);
+
+    m_vertexRanges.grow(capacity);
+}
+
+
+template <typename Ta, typename Te>
+inline void buffer_arena<Ta, Te>::grow_elements( unsigned int count )
+{
+    unsigned int capacity = std::max( 2*m_elementRanges.capacity(), m_elementRanges.capacity() + count );
+
+    m_elements.resize(capacity);
+    m_elementRanges.grow(capacity);
+}
+
+
+} // end namespace nyx
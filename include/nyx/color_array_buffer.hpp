@@ -36,25 +36,31 @@ namespace nyx
 
 
 template <typename T>
-class color_array_buffer : public array_buffer<T>
+class color_array_buffer : public array_buffer<T, color_array_buffer<T> >
 {
+    typedef array_buffer<T, color_array_buffer<T> > base;
+    friend class buffer<T, color_array_buffer<T> >;
+
+    static_assert( util::type<T>::is_GL_compatible(), "nyx::color_array_buffer: color buffer only supports GL-compatible data types." );
+
 public:
     color_array_buffer();
 
-    virtual void set_components( unsigned int components );
+    void set_components( unsigned int components );
+
+    void bind() const;
 
-    virtual void bind() const;
+protected:
+    bool is_encoding_supported( unsigned int encoding ) const;
 };
 
 
 template <typename T>
 inline color_array_buffer<T>::color_array_buffer() :
-    array_buffer<T>::array_buffer(),
-    color_array_buffer<T>::m_state(GL_COLOR_ARRAY)
+    base()
 {
-    // check if the type is compatible
-    if( !util::type<T>::is_GL_compatible() )
-        throw std::runtime_error("nyx::color_array_buffer::color_array_buffer: color buffer only supports GL-compatible data types.");
+    color_array_buffer<T>::m_state = GL_COLOR_ARRAY;
+    color_array_buffer<T>::m_location = 2;
 }
 
 template <typename T>
@@ -68,11 +74,22 @@ inline void color_array_buffer<T>::set_components( unsigned int components )
 }
 
 
+template <typename T>
+inline bool color_array_buffer<T>::is_encoding_supported( unsigned int encoding ) const
+{
+    // integer colors are normalized
+    return encoding == encode_none || encoding == encode_half || encoding == encode_unorm16;
+}
+
+
 template <typename T>
 inline void color_array_buffer<T>::bind() const
 {
-    buffer<T>::bind();
-    glColorPointer( color_array_buffer<T>::m_size, util::type<T>::GL(), 0, 0 );
+    base::bind();
+    if( state::current().generic_attributes() )
+        base::attribute_pointer( base::is_integer_storage() );
+    else
+        glColorPointer( base::gl_components(), base::gl_type(), 0, reinterpret_cast<const GLvoid*>(base::offset()) );
 }
 
 
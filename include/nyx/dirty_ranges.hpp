@@ -0,0 +1,131 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace nyx
+{
+
+/*
+ * dirty_ranges.hpp
+ *
+ *      Ranges of a client buffer waiting for upload, in elements. Ranges are
+ *      clamped to the buffer when marked and may arrive in any order. merge
+ *      sorts them and coalesces those that overlap or lie at most the merge
+ *      distance apart, so each merged range is uploaded with one call. The
+ *      elements between two coalesced ranges are uploaded again, which is
+ *      cheaper than another call when the gap is small.
+ */
+
+
+class dirty_ranges
+{
+public:
+    typedef std::pair<unsigned int, unsigned int> range;  // [first, second)
+
+    dirty_ranges();
+
+    void mark( unsigned int offset, unsigned int count, unsigned int limit );
+    unsigned int merge( unsigned int distance );
+    void clear();
+
+    bool empty() const;
+    std::size_t size() const;
+    const range& operator[]( std::size_t i ) const;
+
+protected:
+    std::vector<range> m_ranges;
+};
+
+
+/////
+// Implementation
+///
+inline dirty_ranges::dirty_ranges()
+{
+}
+
+
+inline void dirty_ranges::mark( unsigned int offset, unsigned int count, unsigned int limit )
+{
+    // clamp to the buffer, offset+count may wrap around
+    if( offset >= limit || count == 0 )
+        return;
+
+    m_ranges.push_back( range( offset, offset + std::min( count, limit-offset ) ) );
+}
+
+
+inline unsigned int dirty_ranges::merge( unsigned int distance )
+{
+    if( m_ranges.empty() )
+        return 0;
+
+    std::sort( m_ranges.begin(), m_ranges.end() );
+
+    // coalesce in place, the merged ranges stay sorted and disjoint
+    std::size_t last = 0;
+    for( std::size_t i=1; i<m_ranges.size(); i++ )
+    {
+        if( m_ranges[i].first <= m_ranges[last].second || m_ranges[i].first - m_ranges[last].second <= distance )
+            m_ranges[last].second = std::max( m_ranges[last].second, m_ranges[i].second );
+        else
+            m_ranges[++last] = m_ranges[i];
+    }
+    m_ranges.resize( last+1 );
+
+    // elements covered by the merged ranges
+    unsigned int covered = 0;
+    for( std::size_t i=0; i<m_ranges.size(); i++ )
+        covered += m_ranges[i].second - m_ranges[i].first;
+    return covered;
+}
+
+
+inline void dirty_ranges::clear()
+{
+    m_ranges.clear();
+}
+
+
+inline bool dirty_ranges::empty() const
+{
+    return m_ranges.empty();
+}
+
+
+inline std::size_t dirty_ranges::size() const
+{
+    return m_ranges.size();
+}
+
+
+inline const dirty_ranges::range& dirty_ranges::operator[]( std::size_t i ) const
+{
+    return m_ranges[i];
+}
+
+
+} // end namespace nyx
@@ -0,0 +1,305 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+#include <nyx/util.hpp>
+#include <nyx/state.hpp>
+#include <nyx/buffer_arena.hpp>
+#include <nyx/indirect_buffer.hpp>
+#include <nyx/vertex_buffer_object.hpp>
+
+namespace nyx
+{
+
+/*
+ * draw_batch.hpp
+ *
+ *      Ta - defines the type of the attribute data (float, double...)
+ *      Te - defines the type of the element data
+ *
+ *      Collects the draws of vertex_buffer_objects living in the same
+ *      buffer_arena and submits them with one glMultiDrawElementsIndirect (and
+ *      one glMultiDrawArraysIndirect for objects without elements). The
+ *      commands go through a GL_DRAW_INDIRECT_BUFFER which is only uploaded
+ *      again when the batch changed. All objects must use the same primitive.
+ *
+ *      The batch keeps the objects, not their offsets. The commands are built
+ *      again whenever the ranges of the arena changed (see
+ *      buffer_arena::generation), so defragment, growing and re-initialized
+ *      objects are picked up on the next draw. The objects have to stay alive
+ *      while they are in the batch, clear it before destroying them.
+ *
+ *      Without GL 4.3 / ARB_multi_draw_indirect the commands are drawn one by
+ *      one, still with a single bind of the arena.
+ */
+
+
+template <typename Ta=float, typename Te=unsigned int>
+class draw_batch
+{
+public:
+    draw_batch();
+
+    void configure( const buffer_arena<Ta, Te> &arena, unsigned int usage=GL_DYNAMIC_DRAW );
+
+    void clear();
+    void add( const vertex_buffer_object<Ta, Te> &vbo );
+    void add( const vertex_buffer_object<Ta, Te> &vbo, unsigned int offset, unsigned int size );
+
+    void draw() const;
+
+    unsigned int size() const;
+
+protected:
+    struct entry
+    {
+        const vertex_buffer_object<Ta, Te> *vbo;
+        unsigned int offset;
+        unsigned int size;      // all if none
+    };
+
+    void build() const;
+    void upload() const;
+    void check( const vertex_buffer_object<Ta, Te> &vbo );
+
+protected:
+    const buffer_arena<Ta, Te> *m_arena;
+    unsigned int m_primitiveType;
+    unsigned int m_primitiveSize;
+    std::vector<entry> m_entries;
+
+    // DrawElementsIndirectCommand and DrawArraysIndirectCommand, as plain integers
+    mutable std::vector<unsigned int> m_elementCommands;
+    mutable std::vector<unsigned int> m_arrayCommands;
+
+    mutable indirect_buffer<unsigned int> m_elementBuffer;
+    mutable indirect_buffer<unsigned int> m_arrayBuffer;
+    mutable bool m_dirty;
+
+    // generation of the arena the commands were built for
+    mutable unsigned int m_generation;
+};
+
+
+template <typename Ta, typename Te>
+inline draw_batch<Ta, Te>::draw_batch() :
+    m_arena(0),
+    m_primitiveType(0),
+    m_primitiveSize(0),
+    m_dirty(false),
+    m_generation(0)
+{
+}
+
+
+template <typename Ta, typename Te>
+inline void draw_batch<Ta, Te>::configure( const buffer_arena<Ta, Te> &arena, unsigned int usage )
+{
+    m_arena = &arena;
+    m_elementBuffer.configure( 5, usage );
+    m_arrayBuffer.configure( 4, usage );
+    clear();
+}
+
+
+template <typename Ta, typename Te>
+inline void draw_batch<Ta, Te>::clear()
+{
+    m_entries.clear();
+    m_elementCommands.clear();
+    m_arrayCommands.clear();
+    m_primitiveType = 0;
+    m_primitiveSize = 0;
+    m_dirty = true;
+}
+
+
+template <typename Ta, typename Te>
+inline void draw_batch<Ta, Te>::add( const vertex_buffer_object<Ta, Te> &vbo )
+{
+    check( vbo );
+
+    // the whole object, as large as it is when drawn
+    entry e = { &vbo, 0, buffer_arena<Ta, Te>::none };
+    m_entries.push_back( e );
+    m_dirty = true;
+}
+
+
+template <typename Ta, typename Te>
+inline void draw_batch<Ta, Te>::add( const vertex_buffer_object<Ta, Te> &vbo, unsigned int offset, unsigned int size )
+{
+    check( vbo );
+
+    // same units as draw_elements / draw_vertices
+    entry e = { &vbo, offset, size };
+    m_entries.push_back( e );
+    m_dirty = true;
+}
+
+
+template <typename Ta, typename Te>
+inline void draw_batch<Ta, Te>::draw() const
+{
+    if( m_entries.empty() )
+        return;
+
+    build();
+    upload();
+    m_arena->bind();
+
+    // strips and fans of the objects are separated by the restart index
+    bool restart = m_primitiveSize == 1 && m_primitiveType != GL_POINTS;
+    state::current().primitive_restart( restart && !m_elementCommands.empty() ? util::type<Te>::GL() : 0 );
+
+    unsigned int elementCount = static_cast<unsigned int>( m_elementCommands.size()/5 );
+    unsigned int arrayCount = static_cast<unsigned int>( m_arrayCommands.size()/4 );
+
+    if( GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect )
+    {
+        if( elementCount > 0 )
+        {
+            state::current().bind_buffer( GL_DRAW_INDIRECT_BUFFER, m_elementBuffer.id() );
+            glMultiDrawElementsIndirect( m_primitiveType, util::type<Te>::GL(), reinterpret_cast<const GLvoid*>( m_elementBuffer.offset() ), elementCount, 0 );
+        }
+        if( arrayCount > 0 )
+        {
+            state::current().bind_buffer( GL_DRAW_INDIRECT_BUFFER, m_arrayBuffer.id() );
+            glMultiDrawArraysIndirect( m_primitiveType, reinterpret_cast<const GLvoid*>( m_arrayBuffer.offset() ), arrayCount, 0 );
+        }
+    }
+    else
+    {
+        for( unsigned int i=0; i<elementCount; i++ )
+        {
+            const unsigned int *c = &m_elementCommands[i*5];
+            glDrawElementsBaseVertex( m_primitiveType, c[0], util::type<Te>::GL(), reinterpret_cast<const GLvoid*>( c[2]*sizeof(Te) ), static_cast<GLint>( c[3] ) );
+        }
+        for( unsigned int i=0; i<arrayCount; i++ )
+        {
+            const unsigned int *c = &m_arrayCommands[i*4];
+            glDrawArrays( m_primitiveType, c[2], c[0] );
+        }
+    }
+
+    m_arena->unbind();
+}
+
+
+template <typename Ta, typename Te>
+inline unsigned int draw_batch<Ta, Te>::size() const
+{
+    return static_cast<unsigned int>( m_entries.size() );
+}
+
+
+template <typename Ta, typename Te>
+inline void draw_batch<Ta, Te>::build() const
+{
+    if( !m_dirty && m_generation == m_arena->generation() )
+        return;
+
+    // look up the current ranges of the objects
+    m_elementCommands.clear();
+    m_arrayCommands.clear();
+    for( std::size_t i=0; i<m_entries.size(); i++ )
+    {
+        const vertex_buffer_object<Ta, Te> &vbo = *m_entries[i].vbo;
+        if( vbo.m_vertexRange == buffer_arena<Ta, Te>::none )
+            continue;
+
+        unsigned int baseVertex = m_arena->vertex_offset( vbo.m_vertexRange );
+        if( vbo.m_elementRange != buffer_arena<Ta, Te>::none )
+        {
+            unsigned int size = m_entries[i].size != buffer_arena<Ta, Te>::none ? m_entries[i].size :
+                                m_arena->element_count( vbo.m_elementRange ) / m_primitiveSize;
+            unsigned int command[5] = { size*m_primitiveSize, 1, m_arena->element_offset( vbo.m_elementRange ) + m_entries[i].offset*m_primitiveSize, baseVertex, 0 };
+            m_elementCommands.insert( m_elementCommands.end(), command, command+5 );
+        }
+        else
+        {
+            unsigned int size = m_entries[i].size != buffer_arena<Ta, Te>::none ? m_entries[i].size :
+                                m_arena->vertex_count( vbo.m_vertexRange );
+            unsigned int command[4] = { size, 1, baseVertex + m_entries[i].offset, 0 };
+            m_arrayCommands.insert( m_arrayCommands.end(), command, command+4 );
+        }
+    }
+
+    m_generation = m_arena->generation();
+    m_dirty = true;
+}
+
+
+template <typename Ta, typename Te>
+inline void draw_batch<Ta, Te>::upload() const
+{
+    if( !m_dirty )
+        return;
+
+    m_dirty = false;
+    if( !(GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) )
+        return;
+
+    // grow the buffers when needed, otherwise just overwrite the front
+    if( !m_elementCommands.empty() )
+    {
+        unsigned int count = static_cast<unsigned int>( m_elementCommands.size()/5 );
+        if( count > m_elementBuffer.count() )
+            m_elementBuffer.init( &m_elementCommands[0], count );
+        else
+            m_elementBuffer.update( &m_elementCommands[0], count, 0 );
+    }
+    if( !m_arrayCommands.empty() )
+    {
+        unsigned int count = static_cast<unsigned int>( m_arrayCommands.size()/4 );
+        if( count > m_arrayBuffer.count() )
+            m_arrayBuffer.init( &m_arrayCommands[0], count );
+        else
+            m_arrayBuffer.update( &m_arrayCommands[0], count, 0 );
+    }
+}
+
+
+template <typename Ta, typename Te>
+inline void draw_batch<Ta, Te>::check( const vertex_buffer_object<Ta, Te> &vbo )
+{
+    if( m_arena == 0 )
+        throw std::runtime_error( "draw_batch::add: the batch is not configured." );
+    if( vbo.m_arena != m_arena )
+        throw std::runtime_error( "draw_batch::add: the object does not live in the arena of the batch." );
+    if( vbo.m_vertexRange == buffer_arena<Ta, Te>::none )
+        throw std::runtime_error( "draw_batch::add: no vertices." );
+
+    unsigned int type = vbo.m_elements.get_primitive_type();
+    if( m_primitiveType == 0 )
+    {
+        m_primitiveType = type;
+        m_primitiveSize = vbo.m_elements.size();
+    }
+    else if( type != m_primitiveType )
+        throw std::runtime_error( "draw_batch::add: all objects of a batch must use the same primitive." );
+}
+
+
+} // end namespace nyx
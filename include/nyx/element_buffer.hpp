@@ -21,7 +21,10 @@
 
 #pragma once
 
+#include <vector>
+
 #include <nyx/buffer.hpp>
+#include <nyx/mesh_optimizer.hpp>
 
 namespace nyx
 {
@@ -32,33 +35,75 @@ namespace nyx
  *  Created on: May 4, 2010
  *      Author: alex
  *
+ *      Indices are stored in the narrowest type that holds the largest index of
+ *      the data (GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or T), the width is chosen
+ *      again on every whole upload. A partial update with larger indices widens
+ *      the storage and uploads the client buffer again. Streaming buffers and
+ *      buffers initialized without data keep the width of T, so does
+ *      set_narrowing(false). Draw with get_index_type() and index_size().
+ *
+ *      Narrowed indices can't be mapped or read back as T. map_range and
+ *      read_async first upload the client buffer again at the width of T and
+ *      turn narrowing off for good, without a client buffer (after resize) they
+ *      throw. Call set_narrowing(false) before init to skip the extra upload.
+ *
+ *      Strips, fans and line loops are one index per element, so offsets and
+ *      counts are in indices. Their primitives are separated by the primitive
+ *      restart index (all bits set, see restart_index()), call apply_restart()
+ *      before drawing. init_strips converts a triangle list into restart
+ *      separated strips (see util::stripify) and uploads those instead, the
+ *      strips are kept as the client buffer.
  */
 
 
 template <typename T>
-class element_buffer : public buffer<T>
+class element_buffer : public buffer<T, element_buffer<T> >
 {
+    typedef buffer<T, element_buffer<T> > base;
+    friend class buffer<T, element_buffer<T> >;
+
+    static_assert( util::type<T>::is_integer(), "nyx::element_buffer: data type not supported." );
+
 public:
     element_buffer();
 
-    virtual void set_components( unsigned int components );
+    void set_components( unsigned int components );
 
     unsigned int get_primitive_type() const;
+    unsigned int get_index_type() const;
+    std::size_t index_size() const;
+
+    void set_narrowing( bool narrowing );
+
+    mapped_range<T> map_range( unsigned int offset, unsigned int count, unsigned int flags=GL_MAP_INVALIDATE_RANGE_BIT );
+    void read_async( readback<T> &result, unsigned int offset, unsigned int count ) const;
+    void read_async( readback<T> &result ) const;
+
+    void init_strips( const T *triangles, unsigned int count );
+
+    bool is_restarted() const;
+    static T restart_index();
+    void apply_restart() const;
+
+protected:
+    bool fit_encoding( const T *buf, unsigned int count, bool whole ) const;
+    void widen( const char *error ) const;
 
 protected:
     unsigned int m_type;  // primitive type
+    mutable bool m_narrowing;
+
+    // strips generated by init_strips
+    std::vector<T> m_strips;
 };
 
 
 template <typename T>
-inline element_buffer<T>::element_buffer() : buffer<T>::buffer()
+inline element_buffer<T>::element_buffer() : base()
 {
     element_buffer<T>::m_target = GL_ELEMENT_ARRAY_BUFFER;
     m_type = 0;
-
-    // check data type
-    if( !util::type<T>::is_integer() )
-        throw std::runtime_error("nyx::element_buffer::element_buffer: data type not supported.");
+    m_narrowing = true;
 }
 
 
@@ -73,8 +118,13 @@ inline void element_buffer<T>::set_components( unsigned int components )
         case GL_TRIANGLES : element_buffer<T>::m_size = 3; break;
         case GL_QUADS :     element_buffer<T>::m_size = 4; break;
 
+        case GL_LINE_STRIP :
+        case GL_LINE_LOOP :
+        case GL_TRIANGLE_STRIP :
+        case GL_TRIANGLE_FAN :  element_buffer<T>::m_size = 1; break;
+
         default:
-            throw invalid_parameter("nyx::element_buffer::configure: unsupported element primitive.");
+            throw std::runtime_error("nyx::element_buffer::configure: unsupported element primitive.");
     }
     m_type = components;
 }
@@ -87,6 +137,137 @@ inline unsigned int element_buffer<T>::get_primitive_type() const
 }
 
 
+template <typename T>
+inline unsigned int element_buffer<T>::get_index_type() const
+{
+    return base::gl_type();
+}
+
+
+template <typename T>
+inline std::size_t element_buffer<T>::index_size() const
+{
+    return util::size_of( base::gl_type() );
+}
+
+
+template <typename T>
+inline void element_buffer<T>::set_narrowing( bool narrowing )
+{
+    if( base::m_initialized )
+        throw std::runtime_error("nyx::element_buffer::set_narrowing: has to be set before init.");
+
+    m_narrowing = narrowing;
+}
+
+
+template <typename T>
+inline mapped_range<T> element_buffer<T>::map_range( unsigned int offset, unsigned int count, unsigned int flags )
+{
+    widen( "nyx::element_buffer::map_range: narrowed indices need the client buffer to be mapped, call set_narrowing(false) before init." );
+    return base::map_range( offset, count, flags );
+}
+
+
+template <typename T>
+inline void element_buffer<T>::read_async( readback<T> &result, unsigned int offset, unsigned int count ) const
+{
+    widen( "nyx::element_buffer::read_async: narrowed indices need the client buffer to be read back, call set_narrowing(false) before init." );
+    base::read_async( result, offset, count );
+}
+
+
+template <typename T>
+inline void element_buffer<T>::read_async( readback<T> &result ) const
+{
+    read_async( result, 0, base::m_count );
+}
+
+
+template <typename T>
+inline void element_buffer<T>::init_strips( const T *triangles, unsigned int count )
+{
+    if( m_type != GL_TRIANGLE_STRIP )
+        throw std::runtime_error("nyx::element_buffer::init_strips: the buffer has to be configured for GL_TRIANGLE_STRIP.");
+
+    std::vector<T> list( triangles, triangles + static_cast<std::size_t>(count)*3 );
+    util::stripify( list, m_strips );
+
+    base::init( m_strips.empty() ? 0 : &m_strips[0], static_cast<unsigned int>( m_strips.size() ) );
+}
+
+
+template <typename T>
+inline bool element_buffer<T>::is_restarted() const
+{
+    return base::m_size == 1 && m_type != GL_POINTS;
+}
+
+
+template <typename T>
+inline T element_buffer<T>::restart_index()
+{
+    return static_cast<T>( ~static_cast<T>(0) );
+}
+
+
+template <typename T>
+inline void element_buffer<T>::apply_restart() const
+{
+    state::current().primitive_restart( is_restarted() ? get_index_type() : 0 );
+}
+
+
+template <typename T>
+inline bool element_buffer<T>::fit_encoding( const T *buf, unsigned int count, bool whole ) const
+{
+    // the ring regions are sized once, signed indices are not narrowed
+    if( !m_narrowing || base::m_streaming || util::type<T>::is_signed() )
+        return false;
+
+    // without data later updates could not be widened, keep the full width
+    unsigned int needed = encode_none;
+    if( buf != 0 )
+    {
+        // the largest value of the narrower type is taken by the restart index
+        bool restart = is_restarted();
+        std::size_t m = util::max_index( buf, static_cast<std::size_t>(count)*base::m_size, restart ) + (restart ? 1 : 0);
+        if( m <= 0xFF && sizeof(T) > 1 )
+            needed = encode_uint8;
+        else if( m <= 0xFFFF && sizeof(T) > 2 )
+            needed = encode_uint16;
+    }
+    else if( !whole )
+        return false;
+
+    unsigned int current = base::m_encoding;
+    std::size_t neededWidth = needed == encode_uint8 ? 1 : (needed == encode_uint16 ? 2 : sizeof(T));
+    std::size_t currentWidth = current == encode_uint8 ? 1 : (current == encode_uint16 ? 2 : sizeof(T));
+
+    // whole uploads may shrink the storage, partial ones only widen it
+    if( whole ? needed == current : neededWidth <= currentWidth )
+        return false;
+
+    base::m_encoding = needed;
+    return true;
+}
+
+
+template <typename T>
+inline void element_buffer<T>::widen( const char *error ) const
+{
+    if( base::m_encoding == encode_none || !base::m_valid )
+        return;
+    if( base::m_buffer == 0 )
+        throw std::runtime_error( error );
+
+    // the storage goes back to the width of T and stays there
+    m_narrowing = false;
+    base::m_encoding = encode_none;
+    base::allocate();
+}
+
+
 } // end namespace nyx
 
 
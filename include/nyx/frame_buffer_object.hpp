@@ -22,6 +22,8 @@
 #pragma once
 
 #include <nyx/util.hpp>
+#include <nyx/state.hpp>
+#include <nyx/resources.hpp>
 #include <nyx/texture.hpp>
 
 
@@ -63,10 +65,18 @@ protected:
     void check();
     void clean_up( bool keepColorBuffer=false, bool keepDepthBuffer=false );
 
+    // edit the FBO by name or, without DSA, while it is bound
+    void attach_texture( unsigned int attachment, unsigned int tex );
+    unsigned int attach_renderbuffer( unsigned int attachment, unsigned int format, unsigned int width, unsigned int height );
+    void select_color_buffer();
+
 protected:
     bool m_initialized;
     unsigned int m_id;
 
+    // registry the names came from
+    resources *m_resources;
+
     // textures
     unsigned int m_colorTex;
     unsigned int m_depthTex;
@@ -84,6 +94,7 @@ template<typename T>
 inline frame_buffer_objects<T>::frame_buffer_objects() :
     m_initialized(0),
     m_id(0),
+    m_resources(0),
     m_colorTex(0),
     m_depthTex(0),
     m_colorBuffer(0),
@@ -95,8 +106,12 @@ inline frame_buffer_objects<T>::frame_buffer_objects() :
 template<typename T>
 inline frame_buffer_objects<T>::~frame_buffer_objects()
 {
-    clean_up();
-    glGenFramebuffersEXT( 1, &m_id );
+    if( m_initialized )
+    {
+        m_resources->release_renderbuffer( m_colorBuffer );
+        m_resources->release_renderbuffer( m_depthBuffer );
+        m_resources->release_framebuffer( m_id );
+    }
 }
 
 
@@ -106,7 +121,8 @@ inline void frame_buffer_objects<T>::init()
     // init FBO
     if( !m_initialized )
     {
-        glGenFramebuffersEXT( 1, &m_id );
+        m_resources = &resources::current();
+        m_id = m_resources->create_framebuffer();
         m_initialized = true;
     }
 }
@@ -122,27 +138,23 @@ inline void frame_buffer_objects<T>::attach_color_texture( unsigned int colorTex
     {
         // init stuff
         m_colorTex = colorTex;
-        glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, m_id );
+        bool direct = state::current().direct_state_access();
+        if( !direct )
+            state::current().bind_framebuffer( m_id );
         clean_up( false, keepDepthBuffer );
 
         // enable rendering to attachment 0
-        glDrawBuffer( GL_COLOR_ATTACHMENT0_EXT );
-        glReadBuffer( GL_COLOR_ATTACHMENT0_EXT );
+        select_color_buffer();
 
         // generate internal depth buffer for the color texture
         if( !keepDepthBuffer )
-        {
-            glGenRenderbuffersEXT( 1, &m_depthBuffer );
-            glBindRenderbufferEXT( GL_RENDERBUFFER_EXT, m_depthBuffer );
-            glRenderbufferStorageEXT( GL_RENDERBUFFER_EXT, GL_DEPTH_COMPONENT32_ARB, width, height );
-            glFramebufferRenderbufferEXT( GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, m_depthBuffer );
-            glBindRenderbufferEXT( GL_RENDERBUFFER_EXT, 0 );
-        }
+            m_depthBuffer = attach_renderbuffer( GL_DEPTH_ATTACHMENT_EXT, GL_DEPTH_COMPONENT32_ARB, width, height );
 
         // attach the color texture
-        glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, m_colorTex, 0);
+        attach_texture( GL_COLOR_ATTACHMENT0_EXT, m_colorTex );
 
-        glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, 0 );
+        if( !direct )
+            state::current().bind_framebuffer( 0 );
 
         // check that all is well
         check();
@@ -162,24 +174,23 @@ inline void frame_buffer_objects<T>::attach_depth_texture( unsigned int depthTex
     {
         // init stuff
         m_depthTex = depthTex;
-        glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, m_id );
+        bool direct = state::current().direct_state_access();
+        if( !direct )
+            state::current().bind_framebuffer( m_id );
         clean_up( keepColorBuffer, false );
 
         // generate internal color buffer for the depth texture
         if( !keepColorBuffer )
         {
-            glGenRenderbuffersEXT( 1, &m_colorBuffer );
-            glBindRenderbufferEXT( GL_RENDERBUFFER_EXT, m_colorBuffer );
-            glRenderbufferStorageEXT( GL_RENDERBUFFER_EXT, GL_RGBA, width, height );
-            glFramebufferRenderbufferEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_RENDERBUFFER_EXT, m_colorBuffer );
-            glDrawBuffer(GL_COLOR_ATTACHMENT0_EXT);
-            glReadBuffer(GL_COLOR_ATTACHMENT0_EXT);
+            m_colorBuffer = attach_renderbuffer( GL_COLOR_ATTACHMENT0_EXT, GL_RGBA, width, height );
+            select_color_buffer();
         }
 
         // attach depth texture
-        glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,GL_DEPTH_ATTACHMENT_EXT,GL_TEXTURE_2D, m_depthTex, 0);
+        attach_texture( GL_DEPTH_ATTACHMENT_EXT, m_depthTex );
 
-        glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, m_id );
+        if( !direct )
+            state::current().bind_framebuffer( m_id );
 
         // check that all is well
         check();
@@ -198,20 +209,22 @@ inline void frame_buffer_objects<T>::attach_textures( unsigned int colorTex, uns
     if( colorTex != 0 && depthTex != 0 )
     {
         // Bind the FBO and
-        glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, m_id );
+        bool direct = state::current().direct_state_access();
+        if( !direct )
+            state::current().bind_framebuffer( m_id );
         clean_up();
 
         // attach color texture to it
         m_colorTex = colorTex;
-        glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, m_colorTex, 0);
-        glDrawBuffer( GL_COLOR_ATTACHMENT0_EXT );
-        glReadBuffer( GL_COLOR_ATTACHMENT0_EXT );
+        attach_texture( GL_COLOR_ATTACHMENT0_EXT, m_colorTex );
+        select_color_buffer();
 
         // attach depth texture to it
         m_depthTex = depthTex;
-        glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_TEXTURE_2D, m_colorTex, 0);
+        attach_texture( GL_DEPTH_ATTACHMENT_EXT, m_depthTex );
 
-        glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, 0 );
+        if( !direct )
+            state::current().bind_framebuffer( 0 );
 
         // check that all is well
         check();
@@ -248,9 +261,12 @@ inline void frame_buffer_objects<T>::enable()
     // make sure we are initialized
     init();
 
-    glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, m_id );
-    glDrawBuffer( GL_COLOR_ATTACHMENT0_EXT );
-    glReadBuffer( GL_COLOR_ATTACHMENT0_EXT );
+    // the draw and read buffers are part of the FBO, set them only when it gets bound
+    if( state::current().bind_framebuffer( m_id ) )
+    {
+        glDrawBuffer( GL_COLOR_ATTACHMENT0_EXT );
+        glReadBuffer( GL_COLOR_ATTACHMENT0_EXT );
+    }
 }
 
 
@@ -260,7 +276,7 @@ inline void frame_buffer_objects<T>::disable()
     // make sure we are initialized
     init();
 
-    glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, 0 );
+    state::current().bind_framebuffer( 0 );
 }
 
 
@@ -277,10 +293,65 @@ inline void frame_buffer_objects<T>::clean_up(  bool keepColorBuffer, bool keepD
     // make sure we are initialized
     init();
 
+    // a released name may be handed out again, do not release it twice
     if( m_colorBuffer != 0 && !keepColorBuffer )
-        glDeleteRenderbuffersEXT( 1, &m_colorBuffer );
+    {
+        m_resources->release_renderbuffer( m_colorBuffer );
+        m_colorBuffer = 0;
+    }
     if( m_depthBuffer != 0 && !keepDepthBuffer )
-        glDeleteRenderbuffersEXT( 1, &m_depthBuffer );
+    {
+        m_resources->release_renderbuffer( m_depthBuffer );
+        m_depthBuffer = 0;
+    }
+}
+
+
+template<typename T>
+inline void frame_buffer_objects<T>::attach_texture( unsigned int attachment, unsigned int tex )
+{
+    if( state::current().direct_state_access() )
+        glNamedFramebufferTexture( m_id, attachment, tex, 0 );
+    else
+        glFramebufferTexture2DEXT( GL_FRAMEBUFFER_EXT, attachment, GL_TEXTURE_2D, tex, 0 );
+}
+
+
+template<typename T>
+inline unsigned int frame_buffer_objects<T>::attach_renderbuffer( unsigned int attachment, unsigned int format, unsigned int width, unsigned int height )
+{
+    unsigned int id = m_resources->create_renderbuffer();
+
+    if( state::current().direct_state_access() )
+    {
+        glNamedRenderbufferStorage( id, format, width, height );
+        glNamedFramebufferRenderbuffer( m_id, attachment, GL_RENDERBUFFER_EXT, id );
+    }
+    else
+    {
+        state::current().bind_renderbuffer( id );
+        glRenderbufferStorageEXT( GL_RENDERBUFFER_EXT, format, width, height );
+        glFramebufferRenderbufferEXT( GL_FRAMEBUFFER_EXT, attachment, GL_RENDERBUFFER_EXT, id );
+        state::current().bind_renderbuffer( 0 );
+    }
+
+    return id;
+}
+
+
+template<typename T>
+inline void frame_buffer_objects<T>::select_color_buffer()
+{
+    if( state::current().direct_state_access() )
+    {
+        glNamedFramebufferDrawBuffer( m_id, GL_COLOR_ATTACHMENT0_EXT );
+        glNamedFramebufferReadBuffer( m_id, GL_COLOR_ATTACHMENT0_EXT );
+    }
+    else
+    {
+        glDrawBuffer( GL_COLOR_ATTACHMENT0_EXT );
+        glReadBuffer( GL_COLOR_ATTACHMENT0_EXT );
+    }
 }
 
 
@@ -291,9 +362,15 @@ inline void frame_buffer_objects<T>::check()
     init();
 
     // check if the FBO was setup properly
-    glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, m_id );
-    GLenum fboStatus = glCheckFramebufferStatusEXT( GL_FRAMEBUFFER_EXT );
-    glBindFramebufferEXT(GL_FRAMEBUFFER_EXT,0);
+    GLenum fboStatus = 0;
+    if( state::current().direct_state_access() )
+        fboStatus = glCheckNamedFramebufferStatus( m_id, GL_FRAMEBUFFER_EXT );
+    else
+    {
+        state::current().bind_framebuffer( m_id );
+        fboStatus = glCheckFramebufferStatusEXT( GL_FRAMEBUFFER_EXT );
+        state::current().bind_framebuffer( 0 );
+    }
     std::string errors;
     switch( fboStatus )
     {
@@ -0,0 +1,72 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <nyx/buffer.hpp>
+
+namespace nyx
+{
+
+/*
+ * indirect_buffer.hpp
+ *
+ *      Buffer of indirect draw commands (GL_DRAW_INDIRECT_BUFFER), one element
+ *      per command. The components select the command layout:
+ *
+ *      4 - DrawArraysIndirectCommand { count, instanceCount, first, baseInstance }
+ *      5 - DrawElementsIndirectCommand { count, instanceCount, firstIndex, baseVertex, baseInstance }
+ */
+
+
+template <typename T=unsigned int>
+class indirect_buffer : public buffer<T, indirect_buffer<T> >
+{
+    typedef buffer<T, indirect_buffer<T> > base;
+    friend class buffer<T, indirect_buffer<T> >;
+
+    static_assert( sizeof(T) == 4 && util::type<T>::is_integer(), "nyx::indirect_buffer: commands consist of 32 bit integers." );
+
+public:
+    indirect_buffer();
+
+    void set_components( unsigned int components );
+};
+
+
+template <typename T>
+inline indirect_buffer<T>::indirect_buffer() : base()
+{
+    indirect_buffer<T>::m_target = GL_DRAW_INDIRECT_BUFFER;
+}
+
+
+template <typename T>
+inline void indirect_buffer<T>::set_components( unsigned int components )
+{
+    if( components != 4 && components != 5 )
+        throw std::runtime_error("nyx::indirect_buffer::setComponents: unsupported command size.");
+    else
+        indirect_buffer<T>::m_size = components;
+}
+
+
+} // end namespace nyx
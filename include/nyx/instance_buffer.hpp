@@ -0,0 +1,234 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+
+#include <nyx/array_buffer.hpp>
+
+namespace nyx
+{
+
+/*
+ * instance_buffer.hpp
+ *
+ *      T - defines the type of the data used (float, unsigned int...)
+ *      location - first generic vertex attribute the stream is bound to
+ *      components - 1 to 4 for a vector, 8, 12 or 16 for a matrix of 2, 3 or 4
+ *                   vec4 columns occupying consecutive locations
+ *      divisor - how many instances share an element (glVertexAttribDivisor)
+ *
+ *      Per instance attribute stream (transforms, colors, IDs) for
+ *      vertex_buffer_object::draw_instanced. Integer types are bound with
+ *      glVertexAttribIPointer and arrive unconverted in the shader.
+ *
+ *      update_instances rewrites the stream every frame without reallocating,
+ *      the storage only grows (doubling) when more instances are written than
+ *      fit. Configured with GL_STREAM_DRAW the stream goes through the
+ *      persistently mapped ring of buffer.hpp and never waits for the GPU.
+ *
+ *      Location 0 aliases the vertex position in the compatibility profile,
+ *      the vertex attributes of a vertex_buffer_object use 0 to 3, start
+ *      instance streams at 4.
+ */
+
+
+class instance_stream
+{
+public:
+    virtual ~instance_stream() {}
+
+    virtual void bind_instances() const = 0;
+    virtual void unbind_instances() const = 0;
+};
+
+
+template <typename T>
+class instance_buffer : public array_buffer<T, instance_buffer<T> >, public instance_stream
+{
+    typedef array_buffer<T, instance_buffer<T> > base;
+    friend class buffer<T, instance_buffer<T> >;
+
+    static_assert( util::type<T>::is_GL_compatible(), "nyx::instance_buffer: instance buffer only supports GL-compatible data types." );
+
+public:
+    instance_buffer();
+
+    void configure( unsigned int location, unsigned int components, unsigned int divisor=1, unsigned int usage=GL_DYNAMIC_DRAW, unsigned int regions=3 );
+
+    void set_components( unsigned int components );
+
+    void reserve( unsigned int capacity );
+    void update_instances( const T *buf, unsigned int count );
+
+    unsigned int instances() const;
+    unsigned int locations() const;
+
+    void bind() const;
+    void unbind() const;
+
+    virtual void bind_instances() const;
+    virtual void unbind_instances() const;
+
+protected:
+    bool is_encoding_supported( unsigned int encoding ) const;
+
+protected:
+    unsigned int m_divisor;
+    unsigned int m_instances;
+};
+
+
+template <typename T>
+inline instance_buffer<T>::instance_buffer() :
+    base(),
+    m_divisor(1),
+    m_instances(0)
+{
+}
+
+
+template <typename T>
+inline void instance_buffer<T>::configure( unsigned int location, unsigned int components, unsigned int divisor, unsigned int usage, unsigned int regions )
+{
+    base::configure( components, usage, regions );
+
+    GLint maxAttributes = 16;
+    glGetIntegerv( GL_MAX_VERTEX_ATTRIBS, &maxAttributes );
+    if( location + locations() > static_cast<unsigned int>(maxAttributes) )
+        throw std::runtime_error("nyx::instance_buffer::configure: attribute location out of range.");
+
+    base::m_location = location;
+    m_divisor = divisor;
+}
+
+
+template <typename T>
+inline void instance_buffer<T>::set_components( unsigned int components )
+{
+    // vectors or vec4 columns
+    if( components < 1 || (components > 4 && components != 8 && components != 12 && components != 16) )
+        throw std::runtime_error("nyx::instance_buffer::setComponents: unsupported instance buffer size.");
+    else
+        instance_buffer<T>::m_size = components;
+}
+
+
+template <typename T>
+inline void instance_buffer<T>::reserve( unsigned int capacity )
+{
+    if( base::m_valid && capacity <= base::m_count )
+        return;
+
+    // storage without contents, written by update_instances
+    base::init( 0, capacity );
+    m_instances = 0;
+}
+
+
+template <typename T>
+inline void instance_buffer<T>::update_instances( const T *buf, unsigned int count )
+{
+    if( !base::m_valid || count > base::m_count )
+        reserve( std::max( count, 2*base::m_count ) );
+
+    if( count > 0 )
+        base::update( buf, count, 0 );
+
+    m_instances = count;
+}
+
+
+template <typename T>
+inline unsigned int instance_buffer<T>::instances() const
+{
+    return m_instances;
+}
+
+
+template <typename T>
+inline unsigned int instance_buffer<T>::locations() const
+{
+    return base::m_size > 4 ? base::m_size/4 : 1;
+}
+
+
+template <typename T>
+inline bool instance_buffer<T>::is_encoding_supported( unsigned int encoding ) const
+{
+    return encoding == encode_none || encoding == encode_half;
+}
+
+
+template <typename T>
+inline void instance_buffer<T>::bind() const
+{
+    base::bind();
+
+    // a matrix is split into columns, each one an attribute of its own
+    unsigned int columns = locations();
+    int components = columns > 1 ? 4 : base::gl_components();
+    GLsizei stride = columns > 1 ? static_cast<GLsizei>( base::element_size() ) : 0;
+
+    for( unsigned int c=0; c<columns; c++ )
+    {
+        const GLvoid *pointer = reinterpret_cast<const GLvoid*>( base::offset() + c*4*util::size_of( base::gl_type() ) );
+
+        state::current().enable_vertex_attrib_array( base::m_location+c );
+        if( util::type<T>::is_integer() )
+            glVertexAttribIPointer( base::m_location+c, components, base::gl_type(), stride, pointer );
+        else
+            glVertexAttribPointer( base::m_location+c, components, base::gl_type(), GL_FALSE, stride, pointer );
+        glVertexAttribDivisor( base::m_location+c, m_divisor );
+    }
+}
+
+
+template <typename T>
+inline void instance_buffer<T>::unbind() const
+{
+    // reset the divisor, the location may be used for vertex data next
+    for( unsigned int c=0; c<locations(); c++ )
+    {
+        state::current().disable_vertex_attrib_array( base::m_location+c );
+        glVertexAttribDivisor( base::m_location+c, 0 );
+    }
+
+    base::unbind();
+}
+
+
+template <typename T>
+inline void instance_buffer<T>::bind_instances() const
+{
+    bind();
+}
+
+
+template <typename T>
+inline void instance_buffer<T>::unbind_instances() const
+{
+    unbind();
+}
+
+
+} // end namespace nyx
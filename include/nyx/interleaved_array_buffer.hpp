@@ -0,0 +1,217 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <nyx/array_buffer.hpp>
+#include <nyx/state.hpp>
+
+namespace nyx
+{
+
+/*
+ * interleaved_array_buffer.hpp
+ *
+ *      Array buffer holding several attributes interleaved per vertex (AoS).
+ *      The layout is described at compile time by a list of attribute
+ *      descriptors, e.g. layout< position<3>, normal, color<4>, texcoord<2> >,
+ *      the order of the descriptors is the order inside a vertex. Each kind of
+ *      attribute can appear once.
+ *
+ *      With generic attributes the descriptors go to the default locations of
+ *      the separate arrays: 0 position, 1 normal, 2 color, 3 texcoord.
+ */
+
+
+/////
+// Attribute descriptors
+///
+
+template <unsigned int State, unsigned int Components>
+struct attribute
+{
+    static const unsigned int state = State;
+    static const unsigned int components = Components;
+};
+
+struct no_attribute : attribute<0,0> {};
+
+template <unsigned int C=3> struct position : attribute<GL_VERTEX_ARRAY, C> {};
+struct normal : attribute<GL_NORMAL_ARRAY, 3> {};
+template <unsigned int C=4> struct color : attribute<GL_COLOR_ARRAY, C> {};
+template <unsigned int C=2> struct texcoord : attribute<GL_TEXTURE_COORD_ARRAY, C> {};
+
+
+template <typename... A>
+struct layout;
+
+template <>
+struct layout<>
+{
+    static const unsigned int count = 0;
+    static const unsigned int stride = 0;
+
+    static constexpr unsigned int offset( unsigned int ) { return 0; }
+    static constexpr unsigned int components( unsigned int ) { return 0; }
+    static constexpr unsigned int state( unsigned int ) { return 0; }
+};
+
+template <typename A, typename... R>
+struct layout<A, R...>
+{
+    typedef layout<R...> rest;
+
+    // descriptors and components per vertex
+    static const unsigned int count = 1 + rest::count;
+    static const unsigned int stride = A::components + rest::stride;
+
+    // offset in components of the attribute with the given state, stride if not present
+    static constexpr unsigned int offset( unsigned int state )
+    {
+        return A::components > 0 && A::state == state ? 0 : A::components + rest::offset( state );
+    }
+
+    // components of the attribute with the given state, 0 if not present
+    static constexpr unsigned int components( unsigned int state )
+    {
+        return A::components > 0 && A::state == state ? A::components : rest::components( state );
+    }
+
+    // generic attribute location of the attribute with the given state
+    static constexpr unsigned int location( unsigned int state )
+    {
+        return state == GL_NORMAL_ARRAY ? 1 :
+               state == GL_COLOR_ARRAY ? 2 :
+               state == GL_TEXTURE_COORD_ARRAY ? 3 :
+               0;
+    }
+
+    // state of the descriptor at the given index, 0 for no_attribute
+    static constexpr unsigned int state( unsigned int index )
+    {
+        return index == 0 ? ( A::components > 0 ? A::state : 0 ) : rest::state( index-1 );
+    }
+};
+
+
+/////
+// Buffer
+///
+
+template <typename T, typename L>
+class interleaved_array_buffer : public array_buffer<T, interleaved_array_buffer<T, L> >
+{
+    typedef array_buffer<T, interleaved_array_buffer<T, L> > base;
+    friend class buffer<T, interleaved_array_buffer<T, L> >;
+
+    static_assert( util::type<T>::is_signed(), "nyx::interleaved_array_buffer: interleaved buffer does not support unsigned data types." );
+    static_assert( L::components( GL_VERTEX_ARRAY ) >= 2 && L::components( GL_VERTEX_ARRAY ) <= 4, "nyx::interleaved_array_buffer: layout needs a position with 2 to 4 components." );
+    static_assert( L::components( GL_NORMAL_ARRAY ) == 0 || L::components( GL_NORMAL_ARRAY ) == 3, "nyx::interleaved_array_buffer: unsupported normal size." );
+    static_assert( L::components( GL_COLOR_ARRAY ) == 0 || L::components( GL_COLOR_ARRAY ) == 3 || L::components( GL_COLOR_ARRAY ) == 4, "nyx::interleaved_array_buffer: unsupported color size." );
+    static_assert( L::components( GL_TEXTURE_COORD_ARRAY ) <= 4, "nyx::interleaved_array_buffer: unsupported texture coordinate size." );
+
+public:
+    interleaved_array_buffer();
+
+    void set_components( unsigned int components );
+
+    void bind() const;
+    void unbind() const;
+};
+
+
+template <typename T, typename L>
+inline interleaved_array_buffer<T, L>::interleaved_array_buffer() : base()
+{
+    interleaved_array_buffer<T, L>::m_state = GL_VERTEX_ARRAY;
+}
+
+
+template <typename T, typename L>
+inline void interleaved_array_buffer<T, L>::set_components( unsigned int components )
+{
+    // the layout defines the size of an element
+    if( components != L::stride )
+        throw std::runtime_error("nyx::interleaved_array_buffer::setComponents: size does not match the layout.");
+    else
+        interleaved_array_buffer<T, L>::m_size = components;
+}
+
+
+template <typename T, typename L>
+inline void interleaved_array_buffer<T, L>::bind() const
+{
+    base::flush();
+    state::current().bind_buffer( GL_ARRAY_BUFFER, base::m_identifier );
+
+    GLsizei stride = static_cast<GLsizei>( base::element_size() );
+    for( unsigned int i=0; i<L::count; i++ )
+    {
+        unsigned int array = L::state(i);
+        if( array == 0 )
+            continue;
+
+        const GLvoid *pointer = reinterpret_cast<const GLvoid*>( base::offset() + L::offset(array)*sizeof(T) );
+
+        if( state::current().generic_attributes() )
+        {
+            // integer normals and colors are normalized like their fixed function counterparts
+            bool normalized = util::type<T>::is_integer() && ( array == GL_NORMAL_ARRAY || array == GL_COLOR_ARRAY );
+            state::current().enable_vertex_attrib_array( L::location(array) );
+            glVertexAttribPointer( L::location(array), L::components(array), util::type<T>::GL(), normalized ? GL_TRUE : GL_FALSE, stride, pointer );
+            continue;
+        }
+
+        state::current().enable_client_state( array );
+        switch( array )
+        {
+            case GL_VERTEX_ARRAY :        glVertexPointer( L::components(array), util::type<T>::GL(), stride, pointer ); break;
+            case GL_NORMAL_ARRAY :        glNormalPointer( util::type<T>::GL(), stride, pointer ); break;
+            case GL_COLOR_ARRAY :         glColorPointer( L::components(array), util::type<T>::GL(), stride, pointer ); break;
+            case GL_TEXTURE_COORD_ARRAY : glTexCoordPointer( L::components(array), util::type<T>::GL(), stride, pointer ); break;
+        }
+    }
+}
+
+
+template <typename T, typename L>
+inline void interleaved_array_buffer<T, L>::unbind() const
+{
+    state::current().bind_buffer( GL_ARRAY_BUFFER, 0 );
+
+    bool generic = state::current().generic_attributes();
+    for( unsigned int i=0; i<L::count; i++ )
+    {
+        if( L::state(i) == 0 )
+            continue;
+
+        if( generic )
+            state::current().disable_vertex_attrib_array( L::location( L::state(i) ) );
+        else
+            state::current().disable_client_state( L::state(i) );
+    }
+}
+
+
+} // end namespace nyx
+
+
+
@@ -0,0 +1,208 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+#include <nyx/util.hpp>
+
+#include <nyx/interleaved_array_buffer.hpp>
+#include <nyx/element_buffer.hpp>
+
+namespace nyx
+{
+
+/*
+ * interleaved_buffer_object.hpp
+ *
+ *      Ta - defines the type of the attribute data (float, double...)
+ *      Te - defines the type of the element data
+ *      L - layout of a vertex, e.g. layout< position<3>, normal, color<4> >
+ *
+ *      Same interface as the vertex_buffer_object, but the separate client
+ *      streams are packed into a single interleaved buffer, so drawing only
+ *      binds one array buffer. Streams not part of the layout are ignored.
+ */
+
+
+template <typename Ta, typename L, typename Te=unsigned int>
+class interleaved_buffer_object {
+public:
+    interleaved_buffer_object();
+    virtual ~interleaved_buffer_object();
+
+    void configure( unsigned int primitiveType, unsigned int usage=GL_STATIC_DRAW );
+
+    void initVertices( const Ta *vertices, unsigned int count );
+    void initNormals( const Ta *normals );
+    void initColors( const Ta *colors );
+    void initTexCoords( const Ta *texCoords );
+    void initElements( const Te *elements, unsigned int count );
+
+    void updateVertices( const Ta *vertices );
+    void updateNormals( const Ta *normals );
+    void updateColors( const Ta *colors );
+    void updateTexCoords( const Ta *texCoords );
+    void updateElements( const Te *elements );
+
+    void draw() const;
+    void draw_vertices( unsigned int offset, unsigned int size ) const;
+    void draw_elements( unsigned int offset, unsigned int size ) const;
+
+protected:
+    void pack( unsigned int state, const Ta *data );
+
+protected:
+    // interleaved client copy of all the streams
+    std::vector<Ta> m_interleaved;
+
+    interleaved_array_buffer<Ta, L> m_arrays;
+    element_buffer<Te> m_elements;
+};
+
+
+template <typename Ta, typename L, typename Te>
+inline interleaved_buffer_object<Ta, L, Te>::interleaved_buffer_object()
+{
+}
+
+
+template <typename Ta, typename L, typename Te>
+inline interleaved_buffer_object<Ta, L, Te>::~interleaved_buffer_object()
+{
+}
+
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::configure( unsigned int primitiveType, unsigned int usage )
+{
+    m_arrays.configure(L::stride, usage);
+    m_elements.configure(primitiveType, usage);
+}
+
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::initVertices( const Ta *vertices, unsigned int count )
+{
+    m_interleaved.assign( count*L::stride, util::type<Ta>::zero() );
+    pack( GL_VERTEX_ARRAY, vertices );
+    m_arrays.init( m_interleaved.empty() ? 0 : &m_interleaved[0], count );
+}
+
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::initNormals( const Ta *normals ){ updateNormals(normals); }
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::initColors( const Ta *colors ){ updateColors(colors); }
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::initTexCoords( const Ta *texCoords ){ updateTexCoords(texCoords); }
+
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::initElements( const Te *elements, unsigned int count )
+{
+    m_elements.init(elements, count);
+}
+
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::updateVertices( const Ta *vertices ){ pack( GL_VERTEX_ARRAY, vertices ); }
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::updateNormals( const Ta *normals ){ pack( GL_NORMAL_ARRAY, normals ); }
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::updateColors( const Ta *colors ){ pack( GL_COLOR_ARRAY, colors ); }
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::updateTexCoords( const Ta *texCoords ){ pack( GL_TEXTURE_COORD_ARRAY, texCoords ); }
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::updateElements( const Te *elements ){ m_elements.update(elements); }
+
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::pack( unsigned int state, const Ta *data )
+{
+    unsigned int components = L::components(state);
+    if( components == 0 || data == 0 || m_interleaved.empty() )
+        return;
+
+    // scatter the stream into its slot of every vertex
+    unsigned int count = static_cast<unsigned int>( m_interleaved.size() / L::stride );
+    Ta *dst = &m_interleaved[ L::offset(state) ];
+    for( unsigned int i=0; i<count; i++, dst+=L::stride, data+=components )
+        for( unsigned int c=0; c<components; c++ )
+            dst[c] = data[c];
+
+    // upload on the next draw
+    m_arrays.mark_dirty( 0, count );
+}
+
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::draw() const
+{
+    if( m_elements.is_valid() )
+        draw_elements( 0, m_elements.count() );
+    else
+        draw_vertices( 0, m_arrays.count() );
+}
+
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::draw_vertices( unsigned int offset, unsigned int size ) const
+{
+    if( !m_arrays.is_valid() )
+        throw std::runtime_error( "interleaved_buffer_object::draw_vertices: no vertices." );
+    if( m_elements.is_valid() )
+        throw std::runtime_error( "interleaved_buffer_object::draw_vertices: elements are aleady defined, use \"draw_elements\" instead." );
+
+    m_arrays.bind();
+    glDrawArrays( m_elements.get_primitive_type(), offset, size );
+    m_arrays.unbind();
+}
+
+
+template <typename Ta, typename L, typename Te>
+inline void interleaved_buffer_object<Ta, L, Te>::draw_elements( unsigned int offset, unsigned int size ) const
+{
+    if( !m_arrays.is_valid() )
+        throw std::runtime_error( "interleaved_buffer_object::draw_elements: no vertices." );
+    if( !m_elements.is_valid() )
+        throw std::runtime_error( "interleaved_buffer_object::draw_elements: there are no elements." );
+
+    m_arrays.bind();
+    m_elements.bind();
+    m_elements.apply_restart();
+    glDrawElements( m_elements.get_primitive_type(),
+                    size*m_elements.size(),
+                    m_elements.get_index_type(),
+                    reinterpret_cast<const GLvoid*>( m_elements.offset() + offset*m_elements.size()*m_elements.index_size() ) );
+    m_elements.unbind();
+    m_arrays.unbind();
+}
+
+
+} // end namespace nyx
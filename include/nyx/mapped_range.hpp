@@ -0,0 +1,265 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <nyx/util.hpp>
+#include <nyx/state.hpp>
+
+namespace nyx
+{
+
+/*
+ * mapped_range.hpp
+ *
+ *      T - defines the type of the data used (float, double...)
+ *
+ *      Typed view of a mapped range of a buffer, see buffer::map_range. The
+ *      range is unmapped when the view goes out of scope, with
+ *      GL_MAP_FLUSH_EXPLICIT_BIT everything not flushed by hand is flushed
+ *      right before, the ranges passed to flush are remembered and only the
+ *      gaps between them are flushed again. Like std::auto_ptr a copy takes over the mapping, which
+ *      leaves the source empty.
+ *
+ *      Indices are in components of type T, element(i) points to the first
+ *      component of element i. operator[] is bounds checked, data() is not.
+ */
+
+
+template <typename T>
+class mapped_range
+{
+public:
+    mapped_range();
+    mapped_range( T *data, unsigned int count, unsigned int components, unsigned int target, unsigned int identifier, unsigned int flags, bool persistent );
+    mapped_range( const mapped_range<T> &other );
+    ~mapped_range();
+
+    T& operator[]( std::size_t index );
+    T* element( unsigned int index );
+    T* data();
+
+    void flush( unsigned int offset, unsigned int count );
+    bool unmap();
+
+    unsigned int count() const;
+    std::size_t size() const;
+    bool is_mapped() const;
+
+protected:
+    void flush_elements( unsigned int offset, unsigned int count );
+
+private:
+    mapped_range<T>& operator=( const mapped_range<T> &other );
+
+protected:
+    mutable T *m_data;
+    unsigned int m_count;
+    unsigned int m_components;
+
+    unsigned int m_target;
+    unsigned int m_identifier;
+    unsigned int m_flags;
+    bool m_persistent;
+
+    // element ranges [first, second) flushed by hand
+    std::vector< std::pair<unsigned int, unsigned int> > m_flushed;
+};
+
+
+template <typename T>
+inline mapped_range<T>::mapped_range() :
+    m_data(0),
+    m_count(0),
+    m_components(0),
+    m_target(0),
+    m_identifier(0),
+    m_flags(0),
+    m_persistent(false)
+{
+}
+
+
+template <typename T>
+inline mapped_range<T>::mapped_range( T *data, unsigned int count, unsigned int components, unsigned int target, unsigned int identifier, unsigned int flags, bool persistent ) :
+    m_data(data),
+    m_count(count),
+    m_components(components),
+    m_target(target),
+    m_identifier(identifier),
+    m_flags(flags),
+    m_persistent(persistent)
+{
+}
+
+
+template <typename T>
+inline mapped_range<T>::mapped_range( const mapped_range<T> &other ) :
+    m_data(other.m_data),
+    m_count(other.m_count),
+    m_components(other.m_components),
+    m_target(other.m_target),
+    m_identifier(other.m_identifier),
+    m_flags(other.m_flags),
+    m_persistent(other.m_persistent),
+    m_flushed(other.m_flushed)
+{
+    // take over the mapping
+    other.m_data = 0;
+}
+
+
+template <typename T>
+inline mapped_range<T>::~mapped_range()
+{
+    unmap();
+}
+
+
+template <typename T>
+inline T& mapped_range<T>::operator[]( std::size_t index )
+{
+    if( index >= size() )
+        throw std::out_of_range("nyx::mapped_range::operator[]: index out of range.");
+
+    return m_data[index];
+}
+
+
+template <typename T>
+inline T* mapped_range<T>::element( unsigned int index )
+{
+    if( index >= m_count )
+        throw std::out_of_range("nyx::mapped_range::element: index out of range.");
+
+    return m_data + index*m_components;
+}
+
+
+template <typename T>
+inline T* mapped_range<T>::data()
+{
+    return m_data;
+}
+
+
+template <typename T>
+inline void mapped_range<T>::flush( unsigned int offset, unsigned int count )
+{
+    // offsets are relative to the mapped range
+    if( m_data == 0 || m_persistent || !(m_flags & GL_MAP_FLUSH_EXPLICIT_BIT) || offset >= m_count )
+        return;
+
+    count = std::min( count, m_count-offset );
+    if( count == 0 )
+        return;
+
+    flush_elements( offset, count );
+    m_flushed.push_back( std::make_pair( offset, offset+count ) );
+}
+
+
+template <typename T>
+inline void mapped_range<T>::flush_elements( unsigned int offset, unsigned int count )
+{
+    std::size_t element = m_components*sizeof(T);
+    if( state::current().direct_state_access() )
+        glFlushMappedNamedBufferRange( m_identifier, offset*element, count*element );
+    else
+    {
+        state::current().bind_buffer( m_target, m_identifier );
+        glFlushMappedBufferRange( m_target, offset*element, count*element );
+    }
+}
+
+
+template <typename T>
+inline bool mapped_range<T>::unmap()
+{
+    if( m_data == 0 )
+        return true;
+
+    m_data = 0;
+
+    // persistent storage stays mapped for the lifetime of the buffer
+    if( m_persistent )
+        return true;
+
+    // flush the gaps between the ranges flushed by hand
+    if( m_flags & GL_MAP_FLUSH_EXPLICIT_BIT )
+    {
+        std::sort( m_flushed.begin(), m_flushed.end() );
+
+        unsigned int begin = 0;
+        for( std::size_t i=0; i<m_flushed.size(); i++ )
+        {
+            if( m_flushed[i].first > begin )
+                flush_elements( begin, m_flushed[i].first-begin );
+            begin = std::max( begin, m_flushed[i].second );
+        }
+        if( begin < m_count )
+            flush_elements( begin, m_count-begin );
+
+        m_flushed.clear();
+    }
+
+    // false means the contents got lost (e.g. on a mode switch) and have to be written again
+    bool intact = false;
+    if( state::current().direct_state_access() )
+        intact = glUnmapNamedBuffer( m_identifier ) == GL_TRUE;
+    else
+    {
+        state::current().bind_buffer( m_target, m_identifier );
+        intact = glUnmapBuffer( m_target ) == GL_TRUE;
+        state::current().bind_buffer( m_target, 0 );
+    }
+
+    return intact;
+}
+
+
+template <typename T>
+inline unsigned int mapped_range<T>::count() const
+{
+    return m_count;
+}
+
+
+template <typename T>
+inline std::size_t mapped_range<T>::size() const
+{
+    return static_cast<std::size_t>(m_count)*m_components;
+}
+
+
+template <typename T>
+inline bool mapped_range<T>::is_mapped() const
+{
+    return m_data != 0;
+}
+
+
+} // end namespace nyx
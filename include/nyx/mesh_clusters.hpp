@@ -0,0 +1,369 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include <nyx/util.hpp>
+
+namespace nyx
+{
+
+/*
+ * mesh_clusters.hpp
+ *
+ *      Splits a triangle list (GL_TRIANGLES) into clusters of spatially close
+ *      triangles and culls them on the CPU, see vertex_buffer_object::draw_culled.
+ *
+ *      build grows clusters of up to "clusterSize" triangles breadth first across
+ *      shared vertices, seeded along a Morton curve through the triangle
+ *      centroids, and reorders the element list so each cluster is contiguous. A cluster keeps a bounding
+ *      sphere and the cone of its triangle normals.
+ *
+ *      cull tests four clusters at a time against the frustum of a column major
+ *      view projection matrix and, given the eye position in the same space as
+ *      the vertices, against the normal cone. The backface test assumes counter
+ *      clockwise front faces and culled back faces. The visible clusters come
+ *      out as merged [first, first+count) ranges of triangles.
+ */
+
+
+class mesh_clusters
+{
+public:
+    mesh_clusters();
+
+    template <typename Ta, typename Te>
+    void build( std::vector<Te> &elements, const Ta *positions, unsigned int components, unsigned int clusterSize=128 );
+
+    void cull( const float *viewProjection, const float *eye, std::vector< std::pair<unsigned int, unsigned int> > &ranges ) const;
+
+    unsigned int size() const;
+    void clear();
+
+protected:
+    template <typename Ta, typename Te>
+    void add_cluster( const std::vector<Te> &elements, const Ta *positions, unsigned int components, std::size_t cluster );
+
+    static unsigned int spread_bits( unsigned int v );
+
+protected:
+    // triangle ranges
+    std::vector<unsigned int> m_first;
+    std::vector<unsigned int> m_count;
+
+    // bounding spheres and normal cones, one array per component for SIMD
+    std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;
+    std::vector<float> m_axisX, m_axisY, m_axisZ, m_cutoff;
+};
+
+
+inline mesh_clusters::mesh_clusters()
+{
+}
+
+
+template <typename Ta, typename Te>
+inline void mesh_clusters::build( std::vector<Te> &elements, const Ta *positions, unsigned int components, unsigned int clusterSize )
+{
+    clear();
+
+    unsigned int triangleCount = static_cast<unsigned int>( elements.size()/3 );
+    if( triangleCount == 0 || positions == 0 || components < 2 || clusterSize == 0 )
+        return;
+
+    // centroids and their bounds
+    std::vector<float> centroids( triangleCount*3, 0.0f );
+    float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for( unsigned int t=0; t<triangleCount; t++ )
+        for( unsigned int i=0; i<std::min( components, 3u ); i++ )
+        {
+            float c = 0.0f;
+            for( int k=0; k<3; k++ )
+                c += static_cast<float>( positions[ static_cast<std::size_t>(elements[t*3+k])*components + i ] );
+            c /= 3.0f;
+
+            centroids[t*3+i] = c;
+            lo[i] = std::min( lo[i], c );
+            hi[i] = std::max( hi[i], c );
+        }
+
+    // sort along the Morton curve of the centroids quantized to 10 bits
+    std::vector< std::pair<unsigned int, unsigned int> > order( triangleCount );
+    for( unsigned int t=0; t<triangleCount; t++ )
+    {
+        unsigned int code = 0;
+        for( unsigned int i=0; i<std::min( components, 3u ); i++ )
+        {
+            float extent = hi[i] - lo[i];
+            unsigned int q = extent > 0.0f ? static_cast<unsigned int>( (centroids[t*3+i] - lo[i]) / extent * 1023.0f ) : 0;
+            code |= spread_bits( q ) << i;
+        }
+        order[t] = std::make_pair( code, t );
+    }
+    std::sort( order.begin(), order.end() );
+
+    // grow each cluster breadth first across shared vertices, seeded in Morton order
+    std::size_t vertexCount = 0;
+    for( std::size_t i=0; i<triangleCount*3; i++ )
+        vertexCount = std::max( vertexCount, static_cast<std::size_t>( elements[i] )+1 );
+
+    std::vector<unsigned int> first( vertexCount+1, 0 );
+    for( std::size_t i=0; i<triangleCount*3; i++ )
+        first[ elements[i]+1 ]++;
+    for( std::size_t v=0; v<vertexCount; v++ )
+        first[v+1] += first[v];
+
+    std::vector<unsigned int> adjacency( triangleCount*3 );
+    std::vector<unsigned int> fill( first.begin(), first.end()-1 );
+    for( std::size_t i=0; i<triangleCount*3; i++ )
+        adjacency[ fill[ elements[i] ]++ ] = static_cast<unsigned int>( i/3 );
+
+    std::vector<Te> sorted;
+    sorted.reserve( elements.size() );
+    std::vector<bool> assigned( triangleCount, false );
+    std::vector<unsigned int> queue;
+
+    for( unsigned int s=0; s<triangleCount; s++ )
+    {
+        if( assigned[ order[s].second ] )
+            continue;
+
+        unsigned int begin = static_cast<unsigned int>( sorted.size()/3 ), count = 0;
+        queue.assign( 1, order[s].second );
+        for( std::size_t q=0; q<queue.size() && count<clusterSize; q++ )
+        {
+            unsigned int t = queue[q];
+            if( assigned[t] )
+                continue;
+
+            assigned[t] = true;
+            sorted.insert( sorted.end(), elements.begin() + t*3, elements.begin() + t*3 + 3 );
+            count++;
+
+            for( int k=0; k<3; k++ )
+            {
+                Te v = elements[t*3+k];
+                for( unsigned int a=first[v]; a<first[v+1]; a++ )
+                    if( !assigned[ adjacency[a] ] )
+                        queue.push_back( adjacency[a] );
+            }
+        }
+
+        m_first.push_back( begin );
+        m_count.push_back( count );
+    }
+
+    sorted.insert( sorted.end(), elements.begin() + triangleCount*3, elements.end() );
+    elements.swap( sorted );
+
+    for( std::size_t c=0; c<m_first.size(); c++ )
+        add_cluster( elements, positions, components, c );
+}
+
+
+template <typename Ta, typename Te>
+inline void mesh_clusters::add_cluster( const std::vector<Te> &elements, const Ta *positions, unsigned int components, std::size_t cluster )
+{
+    unsigned int first = m_first[cluster], count = m_count[cluster];
+
+    // sphere around the center of the bounding box
+    float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    std::vector<float> p( count*9, 0.0f );
+    for( unsigned int j=0; j<count*3; j++ )
+    {
+        const Ta *position = positions + static_cast<std::size_t>( elements[first*3+j] )*components;
+        for( unsigned int i=0; i<std::min( components, 3u ); i++ )
+        {
+            p[j*3+i] = static_cast<float>( position[i] );
+            lo[i] = std::min( lo[i], p[j*3+i] );
+            hi[i] = std::max( hi[i], p[j*3+i] );
+        }
+    }
+    if( components < 3 )
+        lo[2] = hi[2] = 0.0f;
+
+    float center[3] = { 0.5f*(lo[0]+hi[0]), 0.5f*(lo[1]+hi[1]), 0.5f*(lo[2]+hi[2]) };
+    float radius = 0.0f;
+    for( unsigned int j=0; j<count*3; j++ )
+    {
+        float d[3] = { p[j*3]-center[0], p[j*3+1]-center[1], p[j*3+2]-center[2] };
+        radius = std::max( radius, d[0]*d[0] + d[1]*d[1] + d[2]*d[2] );
+    }
+    radius = std::sqrt( radius );
+
+    // cone of the unit normals, the axis is their normalized sum
+    std::vector<float> normals;
+    normals.reserve( count*3 );
+    float axis[3] = { 0.0f, 0.0f, 0.0f };
+    for( unsigned int t=0; t<count; t++ )
+    {
+        const float *a = &p[t*9], *b = a+3, *c = a+6;
+        float e0[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] };
+        float e1[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+        float n[3] = { e0[1]*e1[2] - e0[2]*e1[1], e0[2]*e1[0] - e0[0]*e1[2], e0[0]*e1[1] - e0[1]*e1[0] };
+        float length = std::sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+        if( length == 0.0f )
+            continue;
+
+        for( int i=0; i<3; i++ )
+        {
+            normals.push_back( n[i]/length );
+            axis[i] += n[i]/length;
+        }
+    }
+
+    float length = std::sqrt( axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2] );
+    float minimum = length > 0.0f ? 1.0f : -1.0f;
+    for( int i=0; i<3; i++ )
+        axis[i] = length > 0.0f ? axis[i]/length : 0.0f;
+    for( std::size_t n=0; n<normals.size(); n+=3 )
+        minimum = std::min( minimum, normals[n]*axis[0] + normals[n+1]*axis[1] + normals[n+2]*axis[2] );
+
+    // the cluster faces away if the view direction is within 90 degrees minus the cone angle
+    // of the axis, nearly flat cones are never culled (cutoff out of range)
+    float cutoff = minimum > 0.1f ? std::sqrt( 1.0f - minimum*minimum ) : 2.0f;
+
+    m_centerX.push_back( center[0] ); m_centerY.push_back( center[1] ); m_centerZ.push_back( center[2] ); m_radius.push_back( radius );
+    m_axisX.push_back( axis[0] ); m_axisY.push_back( axis[1] ); m_axisZ.push_back( axis[2] ); m_cutoff.push_back( cutoff );
+}
+
+
+inline void mesh_clusters::cull( const float *viewProjection, const float *eye, std::vector< std::pair<unsigned int, unsigned int> > &ranges ) const
+{
+    ranges.clear();
+    const float *m = viewProjection;
+
+    // planes of the frustum, row 3 plus or minus rows 0 to 2, normalized
+    float planes[6][4];
+    for( int p=0; p<6; p++ )
+    {
+        float sign = p%2 == 0 ? 1.0f : -1.0f;
+        float length = 0.0f;
+        for( int i=0; i<4; i++ )
+        {
+            planes[p][i] = m[i*4+3] + sign*m[i*4+p/2];
+            length += i<3 ? planes[p][i]*planes[p][i] : 0.0f;
+        }
+
+        length = length > 0.0f ? std::sqrt( length ) : 1.0f;
+        for( int i=0; i<4; i++ )
+            planes[p][i] /= length;
+    }
+
+    std::size_t clusterCount = m_first.size();
+    std::vector<bool> visible( clusterCount, true );
+    std::size_t c = 0;
+
+#if defined(__SSE__)
+    for( ; c+4<=clusterCount; c+=4 )
+    {
+        __m128 x = _mm_loadu_ps( &m_centerX[c] ), y = _mm_loadu_ps( &m_centerY[c] ), z = _mm_loadu_ps( &m_centerZ[c] );
+        __m128 r = _mm_loadu_ps( &m_radius[c] );
+        __m128 negative = _mm_sub_ps( _mm_setzero_ps(), r );
+        __m128 inside = _mm_cmpeq_ps( r, r );
+
+        for( int p=0; p<6; p++ )
+        {
+            __m128 d = _mm_add_ps( _mm_add_ps( _mm_mul_ps( _mm_set1_ps( planes[p][0] ), x ), _mm_mul_ps( _mm_set1_ps( planes[p][1] ), y ) ),
+                                   _mm_add_ps( _mm_mul_ps( _mm_set1_ps( planes[p][2] ), z ), _mm_set1_ps( planes[p][3] ) ) );
+            inside = _mm_and_ps( inside, _mm_cmpge_ps( d, negative ) );
+        }
+
+        if( eye != 0 )
+        {
+            __m128 dx = _mm_sub_ps( x, _mm_set1_ps( eye[0] ) ), dy = _mm_sub_ps( y, _mm_set1_ps( eye[1] ) ), dz = _mm_sub_ps( z, _mm_set1_ps( eye[2] ) );
+            __m128 distance = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) ) );
+            __m128 dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, _mm_loadu_ps( &m_axisX[c] ) ), _mm_mul_ps( dy, _mm_loadu_ps( &m_axisY[c] ) ) ),
+                                     _mm_mul_ps( dz, _mm_loadu_ps( &m_axisZ[c] ) ) );
+            __m128 back = _mm_cmpgt_ps( dot, _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( &m_cutoff[c] ), distance ), r ) );
+            inside = _mm_andnot_ps( back, inside );
+        }
+
+        int mask = _mm_movemask_ps( inside );
+        for( int i=0; i<4; i++ )
+            visible[c+i] = (mask >> i) & 1;
+    }
+#endif
+    for( ; c<clusterCount; c++ )
+    {
+        for( int p=0; p<6 && visible[c]; p++ )
+            visible[c] = planes[p][0]*m_centerX[c] + planes[p][1]*m_centerY[c] + planes[p][2]*m_centerZ[c] + planes[p][3] >= -m_radius[c];
+
+        if( eye != 0 && visible[c] )
+        {
+            float d[3] = { m_centerX[c]-eye[0], m_centerY[c]-eye[1], m_centerZ[c]-eye[2] };
+            float distance = std::sqrt( d[0]*d[0] + d[1]*d[1] + d[2]*d[2] );
+            visible[c] = d[0]*m_axisX[c] + d[1]*m_axisY[c] + d[2]*m_axisZ[c] <= m_cutoff[c]*distance + m_radius[c];
+        }
+    }
+
+    // neighbouring clusters are contiguous, draw them as one range
+    for( c=0; c<clusterCount; c++ )
+    {
+        if( !visible[c] )
+            continue;
+
+        if( !ranges.empty() && ranges.back().first + ranges.back().second == m_first[c] )
+            ranges.back().second += m_count[c];
+        else
+            ranges.push_back( std::make_pair( m_first[c], m_count[c] ) );
+    }
+}
+
+
+inline unsigned int mesh_clusters::size() const
+{
+    return static_cast<unsigned int>( m_first.size() );
+}
+
+
+inline void mesh_clusters::clear()
+{
+    m_first.clear();
+    m_count.clear();
+    m_centerX.clear(); m_centerY.clear(); m_centerZ.clear(); m_radius.clear();
+    m_axisX.clear(); m_axisY.clear(); m_axisZ.clear(); m_cutoff.clear();
+}
+
+
+inline unsigned int mesh_clusters::spread_bits( unsigned int v )
+{
+    // 10 bits, two zero bits between each
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v <<  8)) & 0x0300F00F;
+    v = (v | (v <<  4)) & 0x030C30C3;
+    v = (v | (v <<  2)) & 0x09249249;
+    return v;
+}
+
+
+} // end namespace nyx
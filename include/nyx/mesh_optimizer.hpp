@@ -0,0 +1,457 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <nyx/util.hpp>
+
+namespace nyx
+{
+
+/*
+ * mesh_optimizer.hpp
+ *
+ *      Reorders indexed triangle lists (GL_TRIANGLES) before they are handed to
+ *      a vertex_buffer_object, in this order:
+ *
+ *      optimize_vertex_cache   - triangle order for the post transform cache (Tipsify)
+ *      optimize_overdraw       - order of cache friendly clusters, outside facing first
+ *      optimize_vertex_fetch   - vertex order of first use, apply the returned remap to
+ *                                every attribute stream with remap_vertices
+ *
+ *      stripify turns the (optimized) list into GL_TRIANGLE_STRIP strips separated
+ *      by the primitive restart index, see element_buffer::init_strips.
+ *
+ *      acmr measures the average cache miss ratio (transformed vertices per
+ *      triangle) of a FIFO cache, 0.5 is ideal for large regular meshes, 3 is
+ *      the worst case.
+ */
+
+
+namespace util
+{
+
+
+/////
+// Cache simulation
+///
+
+template <typename Te>
+inline float acmr( const std::vector<Te> &elements, unsigned int vertexCount, unsigned int cacheSize=16 )
+{
+    if( elements.size() < 3 )
+        return 0.0f;
+
+    // a vertex is in the FIFO if it was inserted less than cacheSize misses ago
+    std::vector<unsigned int> timestamps( vertexCount, 0 );
+    unsigned int time = cacheSize+1;
+    unsigned int misses = 0;
+
+    for( size_t i=0; i<elements.size(); i++ )
+    {
+        unsigned int v = static_cast<unsigned int>( elements[i] );
+        if( time - timestamps[v] > cacheSize )
+        {
+            timestamps[v] = time++;
+            misses++;
+        }
+    }
+
+    return static_cast<float>(misses) / static_cast<float>(elements.size()/3);
+}
+
+
+/////
+// Vertex cache, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", Sander et al. 2007
+///
+
+template <typename Te>
+inline void optimize_vertex_cache( std::vector<Te> &elements, unsigned int vertexCount, unsigned int cacheSize=16 )
+{
+    size_t triangleCount = elements.size()/3;
+    if( triangleCount == 0 )
+        return;
+
+    // triangles adjacent to each vertex
+    std::vector<unsigned int> live( vertexCount, 0 );
+    for( size_t i=0; i<triangleCount*3; i++ )
+        live[ elements[i] ]++;
+
+    std::vector<unsigned int> first( vertexCount+1, 0 );
+    for( unsigned int v=0; v<vertexCount; v++ )
+        first[v+1] = first[v] + live[v];
+
+    std::vector<unsigned int> adjacency( triangleCount*3 );
+    std::vector<unsigned int> fill( first.begin(), first.end()-1 );
+    for( size_t i=0; i<triangleCount*3; i++ )
+        adjacency[ fill[ elements[i] ]++ ] = static_cast<unsigned int>( i/3 );
+
+    std::vector<unsigned int> timestamps( vertexCount, 0 );
+    std::vector<bool> emitted( triangleCount, false );
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<Te> result;
+    result.reserve( triangleCount*3 );
+
+    unsigned int time = cacheSize+1;
+    unsigned int cursor = 0;
+    int fanning = 0;
+
+    while( fanning >= 0 )
+    {
+        unsigned int f = static_cast<unsigned int>( fanning );
+        candidates.clear();
+
+        // emit all remaining triangles around the fanning vertex
+        for( unsigned int a=first[f]; a<first[f+1]; a++ )
+        {
+            unsigned int t = adjacency[a];
+            if( emitted[t] )
+                continue;
+
+            for( int k=0; k<3; k++ )
+            {
+                unsigned int v = static_cast<unsigned int>( elements[t*3+k] );
+                result.push_back( elements[t*3+k] );
+                deadEnd.push_back( v );
+                candidates.push_back( v );
+                live[v]--;
+
+                if( time - timestamps[v] > cacheSize )
+                    timestamps[v] = time++;
+            }
+            emitted[t] = true;
+        }
+
+        // next fanning vertex, the one that stays longest in the cache among the candidates
+        fanning = -1;
+        int best = -1;
+        for( size_t c=0; c<candidates.size(); c++ )
+        {
+            unsigned int v = candidates[c];
+            if( live[v] == 0 )
+                continue;
+
+            int priority = 0;
+            if( time - timestamps[v] + 2*live[v] <= cacheSize )
+                priority = static_cast<int>( time - timestamps[v] );
+
+            if( priority > best )
+            {
+                best = priority;
+                fanning = static_cast<int>( v );
+            }
+        }
+
+        // dead end, go back to recently used vertices, then scan in input order
+        while( fanning < 0 && !deadEnd.empty() )
+        {
+            unsigned int v = deadEnd.back();
+            deadEnd.pop_back();
+            if( live[v] > 0 )
+                fanning = static_cast<int>( v );
+        }
+
+        while( fanning < 0 && cursor < vertexCount )
+        {
+            if( live[cursor] > 0 )
+                fanning = static_cast<int>( cursor );
+            cursor++;
+        }
+    }
+
+    elements.swap( result );
+}
+
+
+/////
+// Overdraw, splits the cache optimized order into clusters and sorts them outside in
+///
+
+template <typename Ta, typename Te>
+inline void optimize_overdraw( std::vector<Te> &elements, const std::vector<Ta> &positions, unsigned int components, unsigned int cacheSize=16, float threshold=1.05f )
+{
+    size_t triangleCount = elements.size()/3;
+    unsigned int vertexCount = static_cast<unsigned int>( positions.size()/components );
+    if( triangleCount < 2 || components < 2 )
+        return;
+
+    // hard cluster boundaries where the cache was flushed completely (3 misses)
+    std::vector<unsigned int> timestamps( vertexCount, 0 );
+    unsigned int time = cacheSize+1;
+    std::vector<unsigned int> misses( triangleCount, 0 );
+    for( size_t t=0; t<triangleCount; t++ )
+        for( int k=0; k<3; k++ )
+        {
+            unsigned int v = static_cast<unsigned int>( elements[t*3+k] );
+            if( time - timestamps[v] > cacheSize )
+            {
+                timestamps[v] = time++;
+                misses[t]++;
+            }
+        }
+
+    std::vector<size_t> hard;
+    for( size_t t=0; t<triangleCount; t++ )
+        if( t == 0 || misses[t] == 3 )
+            hard.push_back( t );
+    hard.push_back( triangleCount );
+
+    // soft boundaries inside the hard clusters, wherever the ACMR so far is close to the cluster's
+    std::vector<size_t> clusters;
+    for( size_t h=0; h+1<hard.size(); h++ )
+    {
+        size_t begin = hard[h], end = hard[h+1];
+
+        unsigned int total = 0;
+        for( size_t t=begin; t<end; t++ )
+            total += misses[t];
+        float limit = threshold * static_cast<float>(total) / static_cast<float>(end-begin);
+
+        // simulate every soft cluster with a cold cache
+        time += cacheSize+1;
+        unsigned int clusterMisses = 0;
+        size_t start = begin;
+        clusters.push_back( begin );
+        for( size_t t=begin; t<end; t++ )
+        {
+            for( int k=0; k<3; k++ )
+            {
+                unsigned int v = static_cast<unsigned int>( elements[t*3+k] );
+                if( time - timestamps[v] > cacheSize )
+                {
+                    timestamps[v] = time++;
+                    clusterMisses++;
+                }
+            }
+
+            if( t+1 < end && static_cast<float>(clusterMisses) / static_cast<float>(t+1-start) <= limit )
+            {
+                clusters.push_back( t+1 );
+                start = t+1;
+                clusterMisses = 0;
+                time += cacheSize+1;
+            }
+        }
+    }
+    clusters.push_back( triangleCount );
+
+    // area weighted centroids and normals
+    size_t clusterCount = clusters.size()-1;
+    std::vector<float> centroids( clusterCount*3, 0.0f ), normals( clusterCount*3, 0.0f ), areas( clusterCount, 0.0f );
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+
+    for( size_t c=0; c<clusterCount; c++ )
+        for( size_t t=clusters[c]; t<clusters[c+1]; t++ )
+        {
+            float p[3][3];
+            for( int k=0; k<3; k++ )
+            {
+                const Ta *position = &positions[ elements[t*3+k]*components ];
+                p[k][0] = static_cast<float>( position[0] );
+                p[k][1] = static_cast<float>( position[1] );
+                p[k][2] = components > 2 ? static_cast<float>( position[2] ) : 0.0f;
+            }
+
+            float e0[3] = { p[1][0]-p[0][0], p[1][1]-p[0][1], p[1][2]-p[0][2] };
+            float e1[3] = { p[2][0]-p[0][0], p[2][1]-p[0][1], p[2][2]-p[0][2] };
+            float n[3] = { e0[1]*e1[2] - e0[2]*e1[1], e0[2]*e1[0] - e0[0]*e1[2], e0[0]*e1[1] - e0[1]*e1[0] };
+            float area = std::sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+
+            for( int i=0; i<3; i++ )
+            {
+                float center = (p[0][i] + p[1][i] + p[2][i]) / 3.0f;
+                centroids[c*3+i] += center*area;
+                normals[c*3+i] += n[i];
+                meshCentroid[i] += center*area;
+            }
+            areas[c] += area;
+            meshArea += area;
+        }
+
+    for( int i=0; i<3; i++ )
+        meshCentroid[i] /= meshArea > 0.0f ? meshArea : 1.0f;
+
+    // clusters facing away from the center occlude the others, draw them first
+    std::vector< std::pair<float, size_t> > order( clusterCount );
+    for( size_t c=0; c<clusterCount; c++ )
+    {
+        float length = std::sqrt( normals[c*3]*normals[c*3] + normals[c*3+1]*normals[c*3+1] + normals[c*3+2]*normals[c*3+2] );
+        float key = 0.0f;
+        if( areas[c] > 0.0f && length > 0.0f )
+            for( int i=0; i<3; i++ )
+                key += (centroids[c*3+i]/areas[c] - meshCentroid[i]) * normals[c*3+i] / length;
+
+        order[c] = std::make_pair( -key, c );
+    }
+    std::stable_sort( order.begin(), order.end() );
+
+    std::vector<Te> result;
+    result.reserve( elements.size() );
+    for( size_t o=0; o<clusterCount; o++ )
+    {
+        size_t c = order[o].second;
+        result.insert( result.end(), elements.begin() + clusters[c]*3, elements.begin() + clusters[c+1]*3 );
+    }
+
+    elements.swap( result );
+}
+
+
+/////
+// Vertex fetch, renumbers the vertices in order of first use and drops unused ones
+///
+
+template <typename Te>
+inline unsigned int optimize_vertex_fetch( std::vector<Te> &elements, unsigned int vertexCount, std::vector<Te> &remap )
+{
+    const Te unused = static_cast<Te>( ~static_cast<Te>(0) );
+    remap.assign( vertexCount, unused );
+
+    unsigned int next = 0;
+    for( size_t i=0; i<elements.size(); i++ )
+    {
+        Te &v = remap[ elements[i] ];
+        if( v == unused )
+            v = static_cast<Te>( next++ );
+        elements[i] = v;
+    }
+
+    return next;
+}
+
+
+template <typename Ta, typename Te>
+inline void remap_vertices( std::vector<Ta> &stream, unsigned int components, const std::vector<Te> &remap, unsigned int vertexCount )
+{
+    const Te unused = static_cast<Te>( ~static_cast<Te>(0) );
+    std::vector<Ta> result( static_cast<size_t>(vertexCount)*components );
+
+    for( size_t v=0; v<remap.size(); v++ )
+        if( remap[v] != unused )
+            std::copy( stream.begin() + v*components, stream.begin() + (v+1)*components, result.begin() + static_cast<size_t>(remap[v])*components );
+
+    stream.swap( result );
+}
+
+
+/////
+// Strips, greedy walk across shared edges, starting in input order
+///
+
+template <typename Te>
+inline void stripify( const std::vector<Te> &triangles, std::vector<Te> &strips )
+{
+    const Te restart = static_cast<Te>( ~static_cast<Te>(0) );
+    const unsigned int none = ~0u;
+    size_t triangleCount = triangles.size()/3;
+    strips.clear();
+
+    // edge k of triangle t runs from corner k to corner k+1, sorted by its end points
+    std::vector< std::pair< std::pair<Te, Te>, unsigned int > > edges( triangleCount*3 );
+    for( size_t t=0; t<triangleCount; t++ )
+        for( int k=0; k<3; k++ )
+        {
+            Te a = triangles[t*3+k], b = triangles[t*3+(k+1)%3];
+            edges[t*3+k] = std::make_pair( std::make_pair( std::min( a, b ), std::max( a, b ) ), static_cast<unsigned int>( t*3+k ) );
+        }
+    std::sort( edges.begin(), edges.end() );
+
+    // only manifold edges with consistent winding connect two triangles
+    std::vector<unsigned int> neighbour( triangleCount*3, none );
+    for( size_t i=0; i<edges.size(); )
+    {
+        size_t j = i+1;
+        while( j<edges.size() && edges[j].first == edges[i].first )
+            j++;
+
+        unsigned int e0 = edges[i].second, e1 = j-i == 2 ? edges[i+1].second : none;
+        if( e1 != none && triangles[e0] == triangles[e1 - e1%3 + (e1%3+1)%3] && triangles[e0] != triangles[e1] )
+        {
+            neighbour[e0] = e1;
+            neighbour[e1] = e0;
+        }
+        i = j;
+    }
+
+    std::vector<bool> emitted( triangleCount, false );
+    for( size_t start=0; start<triangleCount; start++ )
+    {
+        const Te *corners = &triangles[start*3];
+        if( emitted[start] )
+            continue;
+
+        // degenerate triangles are invisible, drop them
+        emitted[start] = true;
+        if( corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0] )
+            continue;
+
+        // start so the edge between the last two strip vertices leads to a free triangle
+        int rotation = 0;
+        for( int r=0; r<3; r++ )
+        {
+            unsigned int n = neighbour[start*3+(r+1)%3];
+            if( n != none && !emitted[n/3] )
+            {
+                rotation = r;
+                break;
+            }
+        }
+
+        if( !strips.empty() )
+            strips.push_back( restart );
+        for( int k=0; k<3; k++ )
+            strips.push_back( corners[(rotation+k)%3] );
+
+        // the exit edge runs from the second to last to the last strip vertex in odd
+        // triangles and the other way around in even ones, either way it's shared
+        unsigned int exit = static_cast<unsigned int>( start*3 + (rotation+1)%3 );
+        while( true )
+        {
+            unsigned int n = neighbour[exit];
+            if( n == none || emitted[n/3] )
+                break;
+
+            size_t t = n/3;
+            Te last = strips.back();
+            Te third = triangles[t*3+(n%3+2)%3];
+            emitted[t] = true;
+            strips.push_back( third );
+
+            // the next exit edge connects the last vertex and the new one
+            for( int k=0; k<3; k++ )
+            {
+                Te a = triangles[t*3+k], b = triangles[t*3+(k+1)%3];
+                if( (a == last && b == third) || (a == third && b == last) )
+                    exit = static_cast<unsigned int>( t*3+k );
+            }
+        }
+    }
+}
+
+
+} // end namespace util
+} // end namespace nyx
@@ -0,0 +1,312 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <nyx/util.hpp>
+
+namespace nyx
+{
+
+/*
+ * mesh_simplifier.hpp
+ *
+ *      Reduces an indexed triangle list (GL_TRIANGLES) with quadric error edge
+ *      collapses, "Surface Simplification Using Quadric Error Metrics", Garland
+ *      and Heckbert 1997. Only the indices change, a vertex collapses onto one of
+ *      its neighbours, so every simplified list still refers to the original
+ *      vertex buffer and levels of detail can share it.
+ *
+ *      simplify collapses the cheapest edges until "targetCount" triangles are
+ *      left or the next collapse would exceed "maxError", collapses that flip a
+ *      triangle are skipped and mesh borders are kept in place by extra planes.
+ *      It returns the error of the result as a distance in the units of the
+ *      positions.
+ */
+
+
+namespace util
+{
+
+
+/////
+// Quadric of squared distances to a set of planes, weighted by area
+///
+
+struct quadric
+{
+    double a00, a01, a02, a11, a12, a22, b0, b1, b2, c;
+    double weight;
+
+    quadric() : a00(0), a01(0), a02(0), a11(0), a12(0), a22(0), b0(0), b1(0), b2(0), c(0), weight(0) {}
+
+    quadric( const double *n, double d, double w ) :
+        a00(w*n[0]*n[0]), a01(w*n[0]*n[1]), a02(w*n[0]*n[2]), a11(w*n[1]*n[1]), a12(w*n[1]*n[2]), a22(w*n[2]*n[2]),
+        b0(w*n[0]*d), b1(w*n[1]*d), b2(w*n[2]*d), c(w*d*d), weight(w) {}
+
+    quadric& operator+=( const quadric &q )
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+        weight += q.weight;
+        return *this;
+    }
+
+    // mean squared distance of p to the planes
+    double error( const double *p ) const
+    {
+        double e = a00*p[0]*p[0] + a11*p[1]*p[1] + a22*p[2]*p[2]
+                 + 2.0*(a01*p[0]*p[1] + a02*p[0]*p[2] + a12*p[1]*p[2])
+                 + 2.0*(b0*p[0] + b1*p[1] + b2*p[2]) + c;
+        return weight > 0.0 ? std::fabs( e ) / weight : 0.0;
+    }
+};
+
+
+template <typename Te>
+inline bool collapse_flips( const std::vector<Te> &elements, const std::vector<unsigned int> &first, const std::vector<unsigned int> &adjacency,
+                            const std::vector<double> &p, Te from, Te to, std::size_t &removed )
+{
+    // moving "from" onto "to" must not flip any of the remaining triangles
+    removed = 0;
+    for( unsigned int a=first[from]; a<first[from+1]; a++ )
+    {
+        const Te *tri = &elements[ adjacency[a]*3 ];
+        if( tri[0] == to || tri[1] == to || tri[2] == to )
+        {
+            removed++;
+            continue;
+        }
+
+        double before[3], after[3];
+        for( int s=0; s<2; s++ )
+        {
+            const double *q[3];
+            for( int k=0; k<3; k++ )
+                q[k] = &p[ (s == 1 && tri[k] == from ? to : tri[k])*3 ];
+            double e0[3] = { q[1][0]-q[0][0], q[1][1]-q[0][1], q[1][2]-q[0][2] }, e1[3] = { q[2][0]-q[0][0], q[2][1]-q[0][1], q[2][2]-q[0][2] };
+            double *n = s == 0 ? before : after;
+            n[0] = e0[1]*e1[2] - e0[2]*e1[1]; n[1] = e0[2]*e1[0] - e0[0]*e1[2]; n[2] = e0[0]*e1[1] - e0[1]*e1[0];
+        }
+        // a triangle without area has no side to flip to
+        double area = before[0]*before[0] + before[1]*before[1] + before[2]*before[2];
+        if( area > 0.0 && before[0]*after[0] + before[1]*after[1] + before[2]*after[2] <= 0.0 )
+            return true;
+    }
+    return false;
+}
+
+
+template <typename Ta, typename Te>
+inline float simplify( std::vector<Te> &elements, const Ta *positions, unsigned int components, unsigned int vertexCount, std::size_t targetCount, float maxError=FLT_MAX )
+{
+    std::size_t triangleCount = elements.size()/3;
+    elements.resize( triangleCount*3 );
+    if( triangleCount <= targetCount || components < 2 )
+        return 0.0f;
+
+    std::vector<double> p( static_cast<std::size_t>(vertexCount)*3, 0.0 );
+    for( std::size_t v=0; v<vertexCount; v++ )
+        for( unsigned int i=0; i<std::min( components, 3u ); i++ )
+            p[v*3+i] = static_cast<double>( positions[v*components+i] );
+
+    // planes of the triangles
+    std::vector<quadric> quadrics( vertexCount );
+    std::vector< std::pair< std::pair<Te, Te>, std::size_t > > edges;
+    edges.reserve( triangleCount*3 );
+    for( std::size_t t=0; t<triangleCount; t++ )
+    {
+        const double *a = &p[ elements[t*3]*3 ], *b = &p[ elements[t*3+1]*3 ], *c = &p[ elements[t*3+2]*3 ];
+        double e0[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] }, e1[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+        double n[3] = { e0[1]*e1[2] - e0[2]*e1[1], e0[2]*e1[0] - e0[0]*e1[2], e0[0]*e1[1] - e0[1]*e1[0] };
+        double length = std::sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+        if( length > 0.0 )
+        {
+            n[0] /= length; n[1] /= length; n[2] /= length;
+            quadric q( n, -(n[0]*a[0] + n[1]*a[1] + n[2]*a[2]), 0.5*length );
+            for( int k=0; k<3; k++ )
+                quadrics[ elements[t*3+k] ] += q;
+        }
+
+        for( int k=0; k<3; k++ )
+        {
+            Te u = elements[t*3+k], v = elements[t*3+(k+1)%3];
+            edges.push_back( std::make_pair( std::make_pair( std::min( u, v ), std::max( u, v ) ), t*3+k ) );
+        }
+    }
+
+    // border edges (used by one triangle) get a plane perpendicular to their triangle
+    std::sort( edges.begin(), edges.end() );
+    for( std::size_t i=0; i<edges.size(); i++ )
+    {
+        bool shared = (i > 0 && edges[i-1].first == edges[i].first) || (i+1 < edges.size() && edges[i+1].first == edges[i].first);
+        if( shared )
+            continue;
+
+        std::size_t t = edges[i].second/3;
+        Te u = elements[ edges[i].second ], v = elements[ t*3 + (edges[i].second%3+1)%3 ];
+        const double *a = &p[ elements[t*3]*3 ], *b = &p[ elements[t*3+1]*3 ], *c = &p[ elements[t*3+2]*3 ];
+        double e0[3] = { b[0]-a[0], b[1]-a[1], b[2]-a[2] }, e1[3] = { c[0]-a[0], c[1]-a[1], c[2]-a[2] };
+        double n[3] = { e0[1]*e1[2] - e0[2]*e1[1], e0[2]*e1[0] - e0[0]*e1[2], e0[0]*e1[1] - e0[1]*e1[0] };
+        double e[3] = { p[v*3]-p[u*3], p[v*3+1]-p[u*3+1], p[v*3+2]-p[u*3+2] };
+        double m[3] = { e[1]*n[2] - e[2]*n[1], e[2]*n[0] - e[0]*n[2], e[0]*n[1] - e[1]*n[0] };
+        double length = std::sqrt( m[0]*m[0] + m[1]*m[1] + m[2]*m[2] );
+        if( length == 0.0 )
+            continue;
+
+        m[0] /= length; m[1] /= length; m[2] /= length;
+        quadric q( m, -(m[0]*p[u*3] + m[1]*p[u*3+1] + m[2]*p[u*3+2]), 10.0*(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]) );
+        quadrics[u] += q;
+        quadrics[v] += q;
+    }
+
+    double maxCost = static_cast<double>(maxError)*maxError;
+    double resultCost = 0.0;
+    std::vector<Te> remap( vertexCount );
+    std::vector<bool> locked( vertexCount );
+    std::vector<unsigned int> first( vertexCount+1 ), adjacency, fill;
+    std::vector< std::pair<double, std::pair<Te, Te> > > candidates;
+    std::vector<char> flipping;
+
+    // every pass collapses an independent set of edges, cheapest first
+    while( triangleCount > targetCount )
+    {
+        std::fill( first.begin(), first.end(), 0 );
+        for( std::size_t i=0; i<triangleCount*3; i++ )
+            first[ elements[i]+1 ]++;
+        for( std::size_t v=0; v<vertexCount; v++ )
+            first[v+1] += first[v];
+
+        adjacency.resize( triangleCount*3 );
+        fill.assign( first.begin(), first.end()-1 );
+        for( std::size_t i=0; i<triangleCount*3; i++ )
+            adjacency[ fill[ elements[i] ]++ ] = static_cast<unsigned int>( i/3 );
+
+        // cost of the cheaper direction of every edge, inner edges are seen from both triangles
+        candidates.clear();
+        for( std::size_t i=0; i<triangleCount*3; i++ )
+        {
+            Te u = elements[i], v = elements[ i - i%3 + (i%3+1)%3 ];
+            if( u > v )
+            {
+                // a border edge only has this side
+                bool twin = false;
+                for( unsigned int a=first[u]; a<first[u+1] && !twin; a++ )
+                {
+                    const Te *tri = &elements[ adjacency[a]*3 ];
+                    for( int k=0; k<3; k++ )
+                        twin = twin || ( tri[k] == v && tri[(k+1)%3] == u );
+                }
+                if( twin )
+                    continue;
+            }
+
+            quadric q = quadrics[u];
+            q += quadrics[v];
+            double uv = q.error( &p[v*3] ), vu = q.error( &p[u*3] );
+            candidates.push_back( uv <= vu ? std::make_pair( uv, std::make_pair( u, v ) ) : std::make_pair( vu, std::make_pair( v, u ) ) );
+        }
+        std::sort( candidates.begin(), candidates.end() );
+        if( candidates.empty() )
+            break;
+
+        // a pass stops at about the cost the target needs, or the locked cheap collapses
+        // would be replaced by expensive ones instead of waiting for the next pass.
+        // Collapses that flip don't count, they would hold the limit down for good.
+        std::size_t goal = (triangleCount - targetCount)/2;
+        std::size_t valid = 0;
+        double passCost = maxCost;
+        flipping.assign( candidates.size(), 0 );
+        for( std::size_t c=0; c<candidates.size() && candidates[c].first <= maxCost; c++ )
+        {
+            std::size_t removed;
+            flipping[c] = collapse_flips( elements, first, adjacency, p, candidates[c].second.first, candidates[c].second.second, removed ) ? 1 : 0;
+            if( !flipping[c] && valid++ == goal )
+            {
+                passCost = std::min( maxCost, candidates[c].first * 1.5 );
+                break;
+            }
+        }
+
+        for( std::size_t v=0; v<vertexCount; v++ )
+            remap[v] = static_cast<Te>( v );
+        std::fill( locked.begin(), locked.end(), false );
+
+        std::size_t collapses = 0;
+        std::size_t remaining = triangleCount;
+        for( std::size_t c=0; c<candidates.size() && remaining > targetCount; c++ )
+        {
+            double cost = candidates[c].first;
+            Te from = candidates[c].second.first, to = candidates[c].second.second;
+            if( cost > passCost )
+                break;
+            if( locked[from] || locked[to] || flipping[c] )
+                continue;
+
+            // candidates past the limit search weren't checked yet, also counts the collapsing triangles
+            std::size_t removed;
+            if( collapse_flips( elements, first, adjacency, p, from, to, removed ) )
+                continue;
+
+            // keep the neighbourhood fixed for the rest of the pass
+            for( unsigned int a=first[from]; a<first[from+1]; a++ )
+                for( int k=0; k<3; k++ )
+                    locked[ elements[ adjacency[a]*3+k ] ] = true;
+
+            remap[from] = to;
+            quadrics[to] += quadrics[from];
+            resultCost = std::max( resultCost, cost );
+            remaining -= std::min( removed, remaining );
+            collapses++;
+        }
+
+        // everything within the error limit flips
+        if( collapses == 0 )
+            break;
+
+        // drop the triangles that collapsed
+        std::size_t kept = 0;
+        for( std::size_t t=0; t<triangleCount; t++ )
+        {
+            Te a = remap[ elements[t*3] ], b = remap[ elements[t*3+1] ], c = remap[ elements[t*3+2] ];
+            if( a == b || b == c || c == a )
+                continue;
+
+            elements[kept*3] = a; elements[kept*3+1] = b; elements[kept*3+2] = c;
+            kept++;
+        }
+
+        triangleCount = kept;
+        elements.resize( triangleCount*3 );
+    }
+
+    return static_cast<float>( std::sqrt( resultCost ) );
+}
+
+
+} // end namespace util
+} // end namespace nyx
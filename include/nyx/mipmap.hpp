@@ -0,0 +1,522 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <nyx/util.hpp>
+#include <nyx/quantize.hpp>
+
+namespace nyx
+{
+
+/*
+ * mipmap.hpp
+ *
+ *      T - defines the type of the pixels (unsigned char, float...)
+ *
+ *      CPU generation of mip chains, for textures the GPU can't generate mip
+ *      levels for (integer, depth and some snorm or 16/32 bit RGB formats) or
+ *      for a better filter than the box of glGenerateMipmap, see texture.hpp.
+ *
+ *      filter_box      - average of 2x2 (2x2x2 for volumes) texels
+ *      filter_kaiser   - separable Kaiser windowed sinc with 6 taps per axis,
+ *                        sharper than the box, may ring at hard edges
+ *
+ *      Every level halves each dimension (rounding down, at least 1), like GL.
+ *      The box filter folds an odd last row, column or slice into the last
+ *      texel with 3 taps along that axis, the Kaiser taps reach it anyway.
+ *      The rows of a level are split across "threads" workers (0 for all
+ *      cores), levels too small to be worth it are filtered on the calling
+ *      thread. The box filter uses SSE2 for 4 channel unsigned bytes and for
+ *      1 and 4 channel floats.
+ *
+ *      mip_chain keeps the levels from 1 on tightly packed in one allocation,
+ *      which is reused by the next build. Level 0 is the source itself, it
+ *      has to stay valid as long as level(0) is used.
+ */
+
+
+enum mip_filter
+{
+    filter_box = 0,
+    filter_kaiser
+};
+
+
+// levels of a complete chain down to 1x1x1
+inline unsigned int mip_levels( unsigned int width, unsigned int height=1, unsigned int depth=1 )
+{
+    unsigned int size = std::max( width, std::max( height, depth ) );
+    unsigned int levels = 1;
+    while( size > 1 )
+    {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+
+inline unsigned int mip_extent( unsigned int size, unsigned int level )
+{
+    return std::max( 1u, size >> level );
+}
+
+
+namespace util
+{
+
+
+/////
+// Conversion of pixels to and from the filter precision
+///
+
+template <typename T>
+inline float mip_load( T v )
+{
+    return static_cast<float>( v );
+}
+
+inline float mip_load( half v )
+{
+    return half_to_float( v.bits );
+}
+
+
+// integers are rounded and saturated, the kaiser filter overshoots
+template <typename T>
+inline T mip_store( float v )
+{
+    if( !std::numeric_limits<T>::is_integer )
+        return static_cast<T>( v );
+
+    float lo = static_cast<float>( std::numeric_limits<T>::min() );
+    float hi = static_cast<float>( std::numeric_limits<T>::max() );
+    v = std::floor( v + 0.5f );
+    return v <= lo ? std::numeric_limits<T>::min() : ( v >= hi ? std::numeric_limits<T>::max() : static_cast<T>( v ) );
+}
+
+template <>
+inline half mip_store<half>( float v )
+{
+    half h;
+    h.bits = float_to_half( v );
+    return h;
+}
+
+
+/////
+// Work sharing
+///
+
+// calls work(begin, end) on consecutive ranges of [0, count) on up to "threads" threads
+template <typename F>
+inline void parallel_rows( unsigned int count, std::size_t rowCost, unsigned int threads, F work )
+{
+    if( threads == 0 )
+        threads = std::max( 1u, std::thread::hardware_concurrency() );
+
+    // a thread should have at least 64k elements to be worth starting
+    std::size_t useful = std::max<std::size_t>( 1, std::size_t(count) * rowCost / 65536 );
+    threads = static_cast<unsigned int>( std::min<std::size_t>( std::min<std::size_t>( threads, useful ), count ) );
+
+    if( threads <= 1 )
+    {
+        work( 0u, count );
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve( threads-1 );
+    unsigned int chunk = (count + threads - 1) / threads;
+    for( unsigned int t=1; t<threads; t++ )
+    {
+        unsigned int begin = std::min( count, t*chunk );
+        unsigned int end = std::min( count, begin+chunk );
+        workers.push_back( std::thread( work, begin, end ) );
+    }
+
+    work( 0u, std::min( count, chunk ) );
+    for( std::size_t t=0; t<workers.size(); t++ )
+        workers[t].join();
+}
+
+
+/////
+// Box filter
+///
+
+// source texels of destination texel i along an axis, an odd last texel is folded into the last destination texel
+inline unsigned int box_taps( unsigned int i, unsigned int size, unsigned int half, unsigned int *taps )
+{
+    taps[0] = 2*i;
+    taps[1] = std::min( 2*i+1, size-1 );
+    if( size > 1 && (size & 1) && i+1 == half )
+    {
+        taps[2] = 2*i+2;
+        return 3;
+    }
+    return 2;
+}
+
+
+// one destination row, the average of "count" source rows over 2 (3 at an odd edge) columns
+template <typename T>
+inline void box_row( const T *const *rows, unsigned int count, unsigned int width, unsigned int channels, T *destination, unsigned int dstWidth, unsigned int first=0 )
+{
+    unsigned int taps[3];
+    for( unsigned int x=first; x<dstWidth; x++ )
+    {
+        unsigned int n = box_taps( x, width, dstWidth, taps );
+        float scale = 1.0f / float( n*count );
+        for( unsigned int c=0; c<channels; c++ )
+        {
+            float sum = 0.0f;
+            for( unsigned int r=0; r<count; r++ )
+                for( unsigned int t=0; t<n; t++ )
+                    sum += mip_load( rows[r][taps[t]*channels+c] );
+            destination[x*channels+c] = mip_store<T>( sum * scale );
+        }
+    }
+}
+
+
+#if defined(__SSE2__)
+
+// the SSE paths only do plain 2x2 boxes, folded edges and volumes take the generic path
+inline void box_row( const unsigned char *const *rows, unsigned int count, unsigned int width, unsigned int channels, unsigned char *destination, unsigned int dstWidth, unsigned int first=0 )
+{
+    unsigned int x = first;
+    unsigned int pairs = (width & 1) && width > 1 ? dstWidth-1 : dstWidth;
+    if( count == 2 && channels == 4 )
+    {
+        // 4 source texels to 2 destination texels per step, rounds like mip_store
+        const unsigned char *row0 = rows[0], *row1 = rows[1];
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16( 2 );
+        for( ; x+2 <= pairs && 2*x+4 <= width; x+=2 )
+        {
+            __m128i a = _mm_loadu_si128( reinterpret_cast<const __m128i*>( row0 + 8*x ) );
+            __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( row1 + 8*x ) );
+            __m128i lo = _mm_add_epi16( _mm_unpacklo_epi8( a, zero ), _mm_unpacklo_epi8( b, zero ) );
+            __m128i hi = _mm_add_epi16( _mm_unpackhi_epi8( a, zero ), _mm_unpackhi_epi8( b, zero ) );
+            lo = _mm_add_epi16( lo, _mm_srli_si128( lo, 8 ) );
+            hi = _mm_add_epi16( hi, _mm_srli_si128( hi, 8 ) );
+            __m128i sum = _mm_srli_epi16( _mm_add_epi16( _mm_unpacklo_epi64( lo, hi ), two ), 2 );
+            _mm_storel_epi64( reinterpret_cast<__m128i*>( destination + 4*x ), _mm_packus_epi16( sum, zero ) );
+        }
+    }
+
+    box_row<unsigned char>( rows, count, width, channels, destination, dstWidth, x );
+}
+
+
+inline void box_row( const float *const *rows, unsigned int count, unsigned int width, unsigned int channels, float *destination, unsigned int dstWidth, unsigned int first=0 )
+{
+    unsigned int x = first;
+    unsigned int pairs = (width & 1) && width > 1 ? dstWidth-1 : dstWidth;
+    const float *row0 = rows[0], *row1 = rows[1];
+    const __m128 quarter = _mm_set1_ps( 0.25f );
+    if( count == 2 && channels == 4 )
+    {
+        for( ; x < pairs && 2*x+2 <= width; x++ )
+        {
+            __m128 sum = _mm_add_ps( _mm_add_ps( _mm_loadu_ps( row0 + 8*x ), _mm_loadu_ps( row0 + 8*x + 4 ) ),
+                                     _mm_add_ps( _mm_loadu_ps( row1 + 8*x ), _mm_loadu_ps( row1 + 8*x + 4 ) ) );
+            _mm_storeu_ps( destination + 4*x, _mm_mul_ps( sum, quarter ) );
+        }
+    }
+    else if( count == 2 && channels == 1 )
+    {
+        for( ; x+4 <= pairs && 2*x+8 <= width; x+=4 )
+        {
+            __m128 a = _mm_add_ps( _mm_loadu_ps( row0 + 2*x ), _mm_loadu_ps( row1 + 2*x ) );
+            __m128 b = _mm_add_ps( _mm_loadu_ps( row0 + 2*x + 4 ), _mm_loadu_ps( row1 + 2*x + 4 ) );
+            __m128 sum = _mm_add_ps( _mm_shuffle_ps( a, b, _MM_SHUFFLE(2,0,2,0) ), _mm_shuffle_ps( a, b, _MM_SHUFFLE(3,1,3,1) ) );
+            _mm_storeu_ps( destination + x, _mm_mul_ps( sum, quarter ) );
+        }
+    }
+
+    box_row<float>( rows, count, width, channels, destination, dstWidth, x );
+}
+
+#endif
+
+
+// 2x2 box of a 2D level, 2x2x2 of a volume, 3 texels wide along an axis at an odd edge
+template <typename T>
+inline void box_level( const T *source, unsigned int width, unsigned int height, unsigned int depth, unsigned int stride, unsigned int channels, T *destination, unsigned int threads )
+{
+    unsigned int w = mip_extent( width, 1 ), h = mip_extent( height, 1 ), d = mip_extent( depth, 1 );
+    std::size_t row = std::size_t(stride) * channels;
+    std::size_t slice = row * height;
+
+    parallel_rows( h*d, std::size_t(width)*channels*(depth > 1 ? 4 : 2), threads, [=]( unsigned int begin, unsigned int end )
+    {
+        unsigned int ys[3], zs[3] = { 0, 0, 0 };
+        const T *rows[9];
+        for( unsigned int r=begin; r<end; r++ )
+        {
+            unsigned int y = r % h, z = r / h;
+            unsigned int ny = box_taps( y, height, h, ys );
+            unsigned int nz = depth > 1 ? box_taps( z, depth, d, zs ) : 1;
+
+            unsigned int count = 0;
+            for( unsigned int k=0; k<nz; k++ )
+                for( unsigned int j=0; j<ny; j++ )
+                    rows[count++] = source + zs[k]*slice + ys[j]*row;
+
+            box_row( rows, count, width, channels, destination + std::size_t(r) * w * channels, w );
+        }
+    } );
+}
+
+
+/////
+// Kaiser filter
+///
+
+// modified Bessel function of the first kind, order 0, by its power series
+inline float bessel_i0( float x )
+{
+    float sum = 0.0f, term = 1.0f;
+    for( int k=1; k<20; k++ )
+    {
+        sum += term;
+        term *= (x*x/4.0f) / float(k*k);
+    }
+    return sum;
+}
+
+
+// weights of the taps at -2.5, -1.5, -0.5, 0.5, 1.5, 2.5 source texels around a destination texel
+inline std::vector<float> kaiser_weights()
+{
+    // alpha 4, the window reaches 3 source texels
+    const float beta = 4.0f;
+    std::vector<float> weights( 6 );
+
+    float sum = 0.0f;
+    for( int t=0; t<6; t++ )
+    {
+        float d = float(t) - 2.5f;
+        float x = 3.14159265f * d * 0.5f;
+        float r = d / 3.0f;
+        weights[t] = std::sin( x ) / x * bessel_i0( beta * std::sqrt( 1.0f - r*r ) ) / bessel_i0( beta );
+        sum += weights[t];
+    }
+    for( int t=0; t<6; t++ )
+        weights[t] /= sum;
+
+    return weights;
+}
+
+
+// halves one axis of a float image, neighbours along the axis are "spacing" elements apart
+inline void kaiser_axis( const std::vector<float> &source, unsigned int length, std::size_t spacing, std::vector<float> &destination, unsigned int threads )
+{
+    static const std::vector<float> weights = kaiser_weights();
+    unsigned int half = mip_extent( length, 1 );
+    unsigned int blocks = static_cast<unsigned int>( source.size() / (spacing*length) );
+
+    // each destination line of "spacing" contiguous elements is the weighted sum of 6 source lines
+    parallel_rows( blocks*half, spacing*6, threads, [&]( unsigned int begin, unsigned int end )
+    {
+        for( unsigned int r=begin; r<end; r++ )
+        {
+            std::size_t block = r / half;
+            int i = static_cast<int>( r % half );
+            const float *in = &source[ block*spacing*length ];
+            float *out = &destination[ (block*half + i)*spacing ];
+
+            std::fill( out, out+spacing, 0.0f );
+            for( int t=0; t<6; t++ )
+            {
+                int j = std::min( std::max( 2*i - 2 + t, 0 ), int(length) - 1 );
+                const float *line = in + j*spacing;
+                float w = weights[t];
+                for( std::size_t e=0; e<spacing; e++ )
+                    out[e] += w * line[e];
+            }
+        }
+    } );
+}
+
+
+template <typename T>
+inline void kaiser_level( const T *source, unsigned int width, unsigned int height, unsigned int depth, unsigned int stride, unsigned int channels, T *destination, unsigned int threads )
+{
+    unsigned int size[3] = { width, height, depth };
+    std::size_t texels = std::size_t(width) * height * depth;
+
+    std::vector<float> a( texels * channels ), b;
+    for( std::size_t r=0; r<std::size_t(height)*depth; r++ )
+        for( std::size_t e=0; e<std::size_t(width)*channels; e++ )
+            a[r*width*channels+e] = mip_load( source[r*stride*channels+e] );
+
+    // one pass per axis longer than one texel, the image shrinks along it
+    for( int axis=0; axis<3; axis++ )
+    {
+        if( size[axis] == 1 )
+            continue;
+
+        // elements between neighbours along the axis
+        std::size_t spacing = channels;
+        for( int k=0; k<axis; k++ )
+            spacing *= size[k];
+
+        b.resize( a.size() / size[axis] * mip_extent( size[axis], 1 ) );
+        kaiser_axis( a, size[axis], spacing, b, threads );
+        size[axis] = mip_extent( size[axis], 1 );
+        a.swap( b );
+    }
+
+    for( std::size_t e=0; e<a.size(); e++ )
+        destination[e] = mip_store<T>( a[e] );
+}
+
+
+} // end namespace util
+
+
+template <typename T>
+class mip_chain
+{
+public:
+    mip_chain();
+
+    void build( const T *pixels, unsigned int width, unsigned int height, unsigned int depth, unsigned int channels,
+                unsigned int levels=0, mip_filter filter=filter_box, unsigned int stride=0, unsigned int threads=0 );
+
+    unsigned int levels() const;
+    unsigned int width( unsigned int level ) const;
+    unsigned int height( unsigned int level ) const;
+    unsigned int depth( unsigned int level ) const;
+    unsigned int channels() const;
+
+    const T* level( unsigned int level ) const;
+
+protected:
+    const T *m_source;
+    unsigned int m_size[3];
+    unsigned int m_channels;
+    unsigned int m_levels;
+
+    std::vector<T> m_data;
+    std::vector<std::size_t> m_offsets;
+};
+
+
+template <typename T>
+inline mip_chain<T>::mip_chain() :
+    m_source(0),
+    m_channels(0),
+    m_levels(0)
+{
+    m_size[0] = m_size[1] = m_size[2] = 0;
+}
+
+
+template <typename T>
+inline void mip_chain<T>::build( const T *pixels, unsigned int width, unsigned int height, unsigned int depth, unsigned int channels,
+                                 unsigned int levels, mip_filter filter, unsigned int stride, unsigned int threads )
+{
+    unsigned int complete = mip_levels( width, height, depth );
+    m_levels = levels == 0 ? complete : std::min( levels, complete );
+    m_source = pixels;
+    m_size[0] = width;
+    m_size[1] = height;
+    m_size[2] = depth;
+    m_channels = channels;
+
+    // the levels from 1 on one after another
+    m_offsets.assign( m_levels+1, 0 );
+    for( unsigned int l=1; l<m_levels; l++ )
+        m_offsets[l+1] = m_offsets[l] + std::size_t( mip_extent( width, l ) ) * mip_extent( height, l ) * mip_extent( depth, l ) * channels;
+    m_data.resize( m_offsets[m_levels] );
+
+    for( unsigned int l=1; l<m_levels; l++ )
+    {
+        // only level 0 may have padded rows
+        const T *source = level( l-1 );
+        unsigned int rowLength = l == 1 && stride != 0 ? stride : mip_extent( width, l-1 );
+
+        if( filter == filter_kaiser )
+            util::kaiser_level( source, mip_extent( width, l-1 ), mip_extent( height, l-1 ), mip_extent( depth, l-1 ), rowLength, channels, &m_data[ m_offsets[l] ], threads );
+        else
+            util::box_level( source, mip_extent( width, l-1 ), mip_extent( height, l-1 ), mip_extent( depth, l-1 ), rowLength, channels, &m_data[ m_offsets[l] ], threads );
+    }
+}
+
+
+template <typename T>
+inline unsigned int mip_chain<T>::levels() const
+{
+    return m_levels;
+}
+
+
+template <typename T>
+inline unsigned int mip_chain<T>::width( unsigned int level ) const
+{
+    return mip_extent( m_size[0], level );
+}
+
+
+template <typename T>
+inline unsigned int mip_chain<T>::height( unsigned int level ) const
+{
+    return mip_extent( m_size[1], level );
+}
+
+
+template <typename T>
+inline unsigned int mip_chain<T>::depth( unsigned int level ) const
+{
+    return mip_extent( m_size[2], level );
+}
+
+
+template <typename T>
+inline unsigned int mip_chain<T>::channels() const
+{
+    return m_channels;
+}
+
+
+template <typename T>
+inline const T* mip_chain<T>::level( unsigned int level ) const
+{
+    return level == 0 ? m_source : &m_data[ m_offsets[level] ];
+}
+
+
+} // end namespace nyx
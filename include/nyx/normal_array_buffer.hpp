@@ -36,25 +36,30 @@ namespace nyx
 
 
 template <typename T>
-class normal_array_buffer : public array_buffer<T>
+class normal_array_buffer : public array_buffer<T, normal_array_buffer<T> >
 {
+    typedef array_buffer<T, normal_array_buffer<T> > base;
+    friend class buffer<T, normal_array_buffer<T> >;
+
+    static_assert( util::type<T>::is_signed(), "nyx::normal_array_buffer: normal buffer does not support unsigned data types." );
+
 public:
     normal_array_buffer();
 
-    virtual void set_components( unsigned int components );
+    void set_components( unsigned int components );
+
+    void bind() const;
 
-    virtual void bind() const;
+protected:
+    bool is_encoding_supported( unsigned int encoding ) const;
 };
 
 
 template <typename T>
-inline normal_array_buffer<T>::normal_array_buffer() : array_buffer<T>::array_buffer()
+inline normal_array_buffer<T>::normal_array_buffer() : base()
 {
     normal_array_buffer<T>::m_state = GL_NORMAL_ARRAY;
-
-    // check if the type is compatible
-    if( !util::type<T>::is_signed() )
-        throw std::runtime_error("nyx::normal_array_buffer::normal_array_buffer: normal buffer does not support unsigned data types.");
+    normal_array_buffer<T>::m_location = 1;
 }
 
 template <typename T>
@@ -68,11 +73,26 @@ inline void normal_array_buffer<T>::set_components( unsigned int components )
 }
 
 
+template <typename T>
+inline bool normal_array_buffer<T>::is_encoding_supported( unsigned int encoding ) const
+{
+    // octahedral normals need a shader to decode. glNormalPointer lists the packed types since
+    // GL 3.3, but packed arrays must have 4 components and its implicit size is 3, which drivers
+    // (e.g. Mesa) reject with GL_INVALID_OPERATION, so both need a generic attribute
+    if( encoding == encode_2_10_10_10 || encoding == encode_octahedral )
+        return state::current().generic_attributes();
+    return encoding == encode_none || encoding == encode_half || encoding == encode_snorm16;
+}
+
+
 template <typename T>
 inline void normal_array_buffer<T>::bind() const
 {
-    buffer<T>::bind();
-    glNormalPointer(util::type<T>::GL(), 0, 0 );
+    base::bind();
+    if( state::current().generic_attributes() )
+        base::attribute_pointer( base::is_integer_storage() );
+    else
+        glNormalPointer( base::gl_type(), 0, reinterpret_cast<const GLvoid*>(base::offset()) );
 }
 
 
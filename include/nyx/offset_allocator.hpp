@@ -0,0 +1,465 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+namespace nyx
+{
+
+/*
+ * offset_allocator.hpp
+ *
+ *      Two level segregated fit (TLSF) allocator for ranges of a buffer. It
+ *      only hands out offsets, the memory itself lives on the GPU. Allocation
+ *      and release are O(1), free neighbours are coalesced on release.
+ *
+ *      Sizes and offsets are in arbitrary units (elements, bytes). Allocations
+ *      are identified by handles which stay valid until they are freed, even
+ *      across defragment(), which packs all allocations to the front and
+ *      reports how they moved.
+ */
+
+
+class offset_allocator
+{
+public:
+    static const unsigned int none = 0xFFFFFFFFu;
+
+    struct relocation
+    {
+        unsigned int handle;
+        unsigned int from;
+        unsigned int to;
+        unsigned int size;
+    };
+
+    offset_allocator();
+
+    void reset( unsigned int capacity );
+    void grow( unsigned int capacity );
+
+    unsigned int allocate( unsigned int size );
+    void free( unsigned int handle );
+
+    void defragment( std::vector<relocation> &moves );
+
+    unsigned int offset( unsigned int handle ) const;
+    unsigned int size( unsigned int handle ) const;
+    unsigned int capacity() const;
+    unsigned int used() const;
+
+protected:
+    struct block
+    {
+        unsigned int offset;
+        unsigned int size;
+        unsigned int prev;      // physical neighbours
+        unsigned int next;
+        unsigned int prevFree;  // free list of the size class
+        unsigned int nextFree;
+        bool free;
+    };
+
+    static const unsigned int sl_log2 = 4;
+    static const unsigned int sl_count = 1 << sl_log2;
+    static const unsigned int fl_count = 32;
+
+    static unsigned int fls( unsigned int x );
+    static unsigned int ffs( unsigned int x );
+    static void mapping( unsigned int size, unsigned int &fl, unsigned int &sl );
+
+    unsigned int find_free( unsigned int size ) const;
+    void insert_free( unsigned int b );
+    void remove_free( unsigned int b );
+
+    unsigned int new_block( unsigned int offset, unsigned int size );
+    void release_block( unsigned int b );
+
+protected:
+    std::vector<block> m_blocks;
+    std::vector<unsigned int> m_unused;
+
+    unsigned int m_flBitmap;
+    unsigned int m_slBitmap[fl_count];
+    unsigned int m_heads[fl_count][sl_count];
+
+    unsigned int m_first;
+    unsigned int m_last;
+    unsigned int m_capacity;
+    unsigned int m_used;
+};
+
+
+/////
+// Implementation
+///
+inline offset_allocator::offset_allocator()
+{
+    reset( 0 );
+}
+
+
+inline void offset_allocator::reset( unsigned int capacity )
+{
+    m_blocks.clear();
+    m_unused.clear();
+
+    m_flBitmap = 0;
+    for( unsigned int i=0; i<fl_count; i++ )
+    {
+        m_slBitmap[i] = 0;
+        for( unsigned int j=0; j<sl_count; j++ )
+            m_heads[i][j] = none;
+    }
+
+    m_first = m_last = none;
+    m_capacity = 0;
+    m_used = 0;
+
+    grow( capacity );
+}
+
+
+inline void offset_allocator::grow( unsigned int capacity )
+{
+    if( capacity <= m_capacity )
+        return;
+
+    unsigned int extra = capacity - m_capacity;
+    m_capacity = capacity;
+
+    // extend a free last block or append a new one
+    if( m_last != none && m_blocks[m_last].free )
+    {
+        remove_free( m_last );
+        m_blocks[m_last].size += extra;
+        insert_free( m_last );
+        return;
+    }
+
+    unsigned int b = new_block( capacity - extra, extra );
+    m_blocks[b].prev = m_last;
+    if( m_last != none )
+        m_blocks[m_last].next = b;
+    else
+        m_first = b;
+    m_last = b;
+
+    insert_free( b );
+}
+
+
+inline unsigned int offset_allocator::allocate( unsigned int size )
+{
+    if( size == 0 )
+        return none;
+
+    unsigned int b = find_free( size );
+    if( b == none )
+        return none;
+
+    remove_free( b );
+
+    // split off the remainder
+    if( m_blocks[b].size > size )
+    {
+        unsigned int r = new_block( m_blocks[b].offset + size, m_blocks[b].size - size );
+        m_blocks[r].prev = b;
+        m_blocks[r].next = m_blocks[b].next;
+        if( m_blocks[b].next != none )
+            m_blocks[ m_blocks[b].next ].prev = r;
+        else
+            m_last = r;
+        m_blocks[b].next = r;
+        m_blocks[b].size = size;
+
+        insert_free( r );
+    }
+
+    m_blocks[b].free = false;
+    m_used += size;
+    return b;
+}
+
+
+inline void offset_allocator::free( unsigned int handle )
+{
+    if( handle >= m_blocks.size() || m_blocks[handle].free )
+        return;
+
+    unsigned int b = handle;
+    m_blocks[b].free = true;
+    m_used -= m_blocks[b].size;
+
+    // coalesce with the next block
+    unsigned int next = m_blocks[b].next;
+    if( next != none && m_blocks[next].free )
+    {
+        remove_free( next );
+        m_blocks[b].size += m_blocks[next].size;
+        m_blocks[b].next = m_blocks[next].next;
+        if( m_blocks[next].next != none )
+            m_blocks[ m_blocks[next].next ].prev = b;
+        else
+            m_last = b;
+        release_block( next );
+    }
+
+    // coalesce with the previous block
+    unsigned int prev = m_blocks[b].prev;
+    if( prev != none && m_blocks[prev].free )
+    {
+        remove_free( prev );
+        m_blocks[prev].size += m_blocks[b].size;
+        m_blocks[prev].next = m_blocks[b].next;
+        if( m_blocks[b].next != none )
+            m_blocks[ m_blocks[b].next ].prev = prev;
+        else
+            m_last = prev;
+        release_block( b );
+        b = prev;
+    }
+
+    insert_free( b );
+}
+
+
+inline void offset_allocator::defragment( std::vector<relocation> &moves )
+{
+    moves.clear();
+
+    // drop all free blocks and pack the used ones to the front
+    unsigned int cursor = 0;
+    unsigned int last = none;
+    unsigned int b = m_first;
+    m_first = none;
+    while( b != none )
+    {
+        unsigned int next = m_blocks[b].next;
+
+        if( m_blocks[b].free )
+            release_block( b );
+        else
+        {
+            if( m_blocks[b].offset != cursor )
+            {
+                relocation move = { b, m_blocks[b].offset, cursor, m_blocks[b].size };
+                moves.push_back( move );
+                m_blocks[b].offset = cursor;
+            }
+            cursor += m_blocks[b].size;
+
+            m_blocks[b].prev = last;
+            m_blocks[b].next = none;
+            if( last != none )
+                m_blocks[last].next = b;
+            else
+                m_first = b;
+            last = b;
+        }
+
+        b = next;
+    }
+
+    // rebuild the free lists with a single block at the end
+    m_flBitmap = 0;
+    for( unsigned int i=0; i<fl_count; i++ )
+    {
+        m_slBitmap[i] = 0;
+        for( unsigned int j=0; j<sl_count; j++ )
+            m_heads[i][j] = none;
+    }
+
+    m_last = last;
+    unsigned int capacity = m_capacity;
+    m_capacity = cursor;
+    grow( capacity );
+}
+
+
+inline unsigned int offset_allocator::offset( unsigned int handle ) const
+{
+    return m_blocks[handle].offset;
+}
+
+
+inline unsigned int offset_allocator::size( unsigned int handle ) const
+{
+    return m_blocks[handle].size;
+}
+
+
+inline unsigned int offset_allocator::capacity() const
+{
+    return m_capacity;
+}
+
+
+inline unsigned int offset_allocator::used() const
+{
+    return m_used;
+}
+
+
+inline unsigned int offset_allocator::fls( unsigned int x )
+{
+    // index of the highest set bit
+    unsigned int i = 0;
+    while( x >>= 1 )
+        i++;
+    return i;
+}
+
+
+inline unsigned int offset_allocator::ffs( unsigned int x )
+{
+    // index of the lowest set bit
+    unsigned int i = 0;
+    while( (x & 1) == 0 )
+    {
+        x >>= 1;
+        i++;
+    }
+    return i;
+}
+
+
+inline void offset_allocator::mapping( unsigned int size, unsigned int &fl, unsigned int &sl )
+{
+    // small sizes get a linear class each
+    if( size < sl_count )
+    {
+        fl = 0;
+        sl = size;
+        return;
+    }
+
+    unsigned int f = fls( size );
+    fl = f - sl_log2 + 1;
+    sl = (size >> (f - sl_log2)) - sl_count;
+}
+
+
+inline unsigned int offset_allocator::find_free( unsigned int size ) const
+{
+    unsigned int fl, sl;
+
+    // round up to the next size class, so every block in it is large enough
+    unsigned int rounded = size;
+    if( size >= sl_count )
+    {
+        unsigned int round = (1u << (fls(size) - sl_log2)) - 1;
+        rounded = size > 0xFFFFFFFFu - round ? 0xFFFFFFFFu : size + round;
+    }
+
+    mapping( rounded, fl, sl );
+
+    unsigned int slMap = m_slBitmap[fl] & (0xFFFFFFFFu << sl);
+    if( slMap == 0 )
+    {
+        unsigned int flMap = fl+1 < fl_count ? m_flBitmap & (0xFFFFFFFFu << (fl+1)) : 0;
+        if( flMap != 0 )
+        {
+            fl = ffs( flMap );
+            slMap = m_slBitmap[fl];
+        }
+    }
+
+    if( slMap != 0 )
+        return m_heads[fl][ ffs( slMap ) ];
+
+    // last resort, a block of the request's own class might still fit
+    mapping( size, fl, sl );
+    for( unsigned int b=m_heads[fl][sl]; b!=none; b=m_blocks[b].nextFree )
+        if( m_blocks[b].size >= size )
+            return b;
+
+    return none;
+}
+
+
+inline void offset_allocator::insert_free( unsigned int b )
+{
+    unsigned int fl, sl;
+    mapping( m_blocks[b].size, fl, sl );
+
+    m_blocks[b].free = true;
+    m_blocks[b].prevFree = none;
+    m_blocks[b].nextFree = m_heads[fl][sl];
+    if( m_heads[fl][sl] != none )
+        m_blocks[ m_heads[fl][sl] ].prevFree = b;
+    m_heads[fl][sl] = b;
+
+    m_flBitmap |= 1u << fl;
+    m_slBitmap[fl] |= 1u << sl;
+}
+
+
+inline void offset_allocator::remove_free( unsigned int b )
+{
+    unsigned int fl, sl;
+    mapping( m_blocks[b].size, fl, sl );
+
+    if( m_blocks[b].prevFree != none )
+        m_blocks[ m_blocks[b].prevFree ].nextFree = m_blocks[b].nextFree;
+    else
+        m_heads[fl][sl] = m_blocks[b].nextFree;
+    if( m_blocks[b].nextFree != none )
+        m_blocks[ m_blocks[b].nextFree ].prevFree = m_blocks[b].prevFree;
+
+    // update the bitmaps if the class ran empty
+    if( m_heads[fl][sl] == none )
+    {
+        m_slBitmap[fl] &= ~(1u << sl);
+        if( m_slBitmap[fl] == 0 )
+            m_flBitmap &= ~(1u << fl);
+    }
+}
+
+
+inline unsigned int offset_allocator::new_block( unsigned int offset, unsigned int size )
+{
+    block b = { offset, size, none, none, none, none, true };
+
+    if( !m_unused.empty() )
+    {
+        unsigned int index = m_unused.back();
+        m_unused.pop_back();
+        m_blocks[index] = b;
+        return index;
+    }
+
+    m_blocks.push_back( b );
+    return static_cast<unsigned int>( m_blocks.size()-1 );
+}
+
+
+inline void offset_allocator::release_block( unsigned int b )
+{
+    m_blocks[b].free = true;
+    m_blocks[b].size = 0;
+    m_unused.push_back( b );
+}
+
+
+} // end namespace nyx
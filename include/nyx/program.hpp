@@ -24,6 +24,8 @@
 #include <string>
 
 #include <nyx/shader.hpp>
+#include <nyx/state.hpp>
+#include <nyx/resources.hpp>
 
 namespace nyx
 {
@@ -63,8 +65,9 @@ protected:
     bool m_initialized;
     unsigned int m_id;
     bool m_loaded;
+    resources *m_resources;
 
-    geometry_shader m_vertexShader;
+    vertex_shader m_vertexShader;
     fragment_shader m_fragmentShader;
     geometry_shader m_geometryShader;
 };
@@ -76,7 +79,7 @@ typedef base_shader_program<char> shader_program;
 // Implementations
 ///
 template<typename Ch>
-inline base_shader_program<Ch>::base_shader_program() : m_initialized(true), m_id(0)
+inline base_shader_program<Ch>::base_shader_program() : m_initialized(false), m_id(0), m_loaded(false), m_resources(0)
 {
 }
 
@@ -85,7 +88,7 @@ template<typename Ch>
 inline base_shader_program<Ch>::~base_shader_program()
 {
     if( m_initialized )
-        glDeleteProgram(m_id);
+        m_resources->release_program(m_id);
 }
 
 
@@ -94,6 +97,7 @@ inline void base_shader_program<Ch>::init()
 {
     if( !m_initialized )
     {
+        m_resources = &resources::current();
         m_id = glCreateProgram();
         m_initialized = true;
     }
@@ -150,20 +154,23 @@ template<typename Ch>
 inline void base_shader_program<Ch>::enable()
 {
     if(m_loaded)
-        glUseProgram(m_id);
+        state::current().use_program(m_id);
 }
 
 
 template<typename Ch>
 inline void base_shader_program<Ch>::disable()
 {
-    glUseProgram(0);
+    state::current().use_program(0);
 }
 
 
 template<typename Ch>
 inline void base_shader_program<Ch>::link()
 {
+    // make sure we are initialized
+    init();
+
     // attach shaders
     glAttachShader(m_id, m_vertexShader.id());
     glAttachShader(m_id, m_fragmentShader.id());
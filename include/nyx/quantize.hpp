@@ -0,0 +1,410 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+
+#include <nyx/util.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace nyx
+{
+
+/*
+ * quantize.hpp
+ *
+ *      Encodings a buffer can store its client data in, see buffer::set_encoding.
+ *      The client array stays in full precision, it is encoded while uploading.
+ *
+ *      encode_none         - as is
+ *      encode_half         - 16 bit floats (GL_HALF_FLOAT)
+ *      encode_2_10_10_10   - 3 or 4 signed normalized components packed into 32 bits (GL_INT_2_10_10_10_REV)
+ *      encode_unorm16      - [0,1] as normalized GL_UNSIGNED_SHORT
+ *      encode_snorm16      - [-1,1] as normalized GL_SHORT
+ *      encode_octahedral   - unit vectors as 2 normalized GL_SHORT, decoded in the shader (see octahedral_glsl)
+ *      encode_uint8        - indices narrowed to GL_UNSIGNED_BYTE
+ *      encode_uint16       - indices narrowed to GL_UNSIGNED_SHORT
+ *
+ *      The per component encoders use SSE2 and F16C when the compiler targets them.
+ */
+
+
+enum encoding
+{
+    encode_none = 0,
+    encode_half,
+    encode_2_10_10_10,
+    encode_unorm16,
+    encode_snorm16,
+    encode_octahedral,
+    encode_uint8,
+    encode_uint16
+};
+
+
+namespace util
+{
+
+
+/////
+// Scalar conversions
+///
+
+inline unsigned short float_to_half( float f )
+{
+    unsigned int x;
+    std::memcpy( &x, &f, 4 );
+
+    unsigned int sign = (x >> 16) & 0x8000;
+    unsigned int mantissa = x & 0x007FFFFF;
+    int exponent = static_cast<int>((x >> 23) & 0xFF) - 127 + 15;
+
+    // NaN and infinity
+    if( ((x >> 23) & 0xFF) == 0xFF )
+        return static_cast<unsigned short>( sign | 0x7C00 | (mantissa ? 0x200 : 0) );
+
+    // overflow
+    if( exponent >= 31 )
+        return static_cast<unsigned short>( sign | 0x7C00 );
+
+    // subnormal or zero
+    if( exponent <= 0 )
+    {
+        if( exponent < -10 )
+            return static_cast<unsigned short>( sign );
+
+        mantissa |= 0x00800000;
+        unsigned int shift = static_cast<unsigned int>( 14 - exponent );
+        unsigned int half = mantissa >> shift;
+        unsigned int rest = mantissa & ((1u << shift) - 1);
+        unsigned int halfway = 1u << (shift-1);
+        if( rest > halfway || (rest == halfway && (half & 1)) )
+            half++;
+        return static_cast<unsigned short>( sign | half );
+    }
+
+    // normal, round to nearest even, a carry moves on into the exponent
+    unsigned int half = (static_cast<unsigned int>(exponent) << 10) | (mantissa >> 13);
+    unsigned int rest = mantissa & 0x1FFF;
+    if( rest > 0x1000 || (rest == 0x1000 && (half & 1)) )
+        half++;
+    return static_cast<unsigned short>( sign | half );
+}
+
+
+inline float half_to_float( unsigned short h )
+{
+    unsigned int sign = static_cast<unsigned int>(h & 0x8000) << 16;
+    unsigned int exponent = (h >> 10) & 0x1F;
+    unsigned int mantissa = h & 0x03FF;
+    unsigned int x;
+
+    if( exponent == 0x1F )
+        x = sign | 0x7F800000 | (mantissa << 13);
+    else if( exponent != 0 )
+        x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    else if( mantissa == 0 )
+        x = sign;
+    else
+    {
+        // subnormal, normalize the mantissa
+        int e = 127 - 15 + 1;
+        while( (mantissa & 0x0400) == 0 )
+        {
+            mantissa <<= 1;
+            e--;
+        }
+        x = sign | (static_cast<unsigned int>(e) << 23) | ((mantissa & 0x03FF) << 13);
+    }
+
+    float f;
+    std::memcpy( &f, &x, 4 );
+    return f;
+}
+
+
+inline float clamp( float v, float lo, float hi )
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+
+inline int round_to_int( float v )
+{
+    return static_cast<int>( v < 0.0f ? v - 0.5f : v + 0.5f );
+}
+
+
+/////
+// Per component encoders, n is the number of components
+///
+
+template <typename T>
+inline void encode_half( const T *source, unsigned short *destination, size_t n )
+{
+    for( size_t i=0; i<n; i++ )
+        destination[i] = float_to_half( static_cast<float>(source[i]) );
+}
+
+
+inline void encode_half( const float *source, unsigned short *destination, size_t n )
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for( ; i+8<=n; i+=8 )
+    {
+        __m256 v = _mm256_loadu_ps( source+i );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(destination+i), _mm256_cvtps_ph( v, _MM_FROUND_TO_NEAREST_INT ) );
+    }
+#endif
+    for( ; i<n; i++ )
+        destination[i] = float_to_half( source[i] );
+}
+
+
+template <typename T>
+inline void encode_unorm16( const T *source, unsigned short *destination, size_t n )
+{
+    for( size_t i=0; i<n; i++ )
+        destination[i] = static_cast<unsigned short>( clamp( static_cast<float>(source[i]), 0.0f, 1.0f ) * 65535.0f + 0.5f );
+}
+
+
+inline void encode_unorm16( const float *source, unsigned short *destination, size_t n )
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps( 1.0f ), scale = _mm_set1_ps( 65535.0f );
+    const __m128i bias = _mm_set1_epi32( 32768 ), flip = _mm_set1_epi16( static_cast<short>(0x8000) );
+    for( ; i+8<=n; i+=8 )
+    {
+        __m128 a = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( source+i ), zero ), one );
+        __m128 b = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( source+i+4 ), zero ), one );
+        __m128i ia = _mm_cvtps_epi32( _mm_mul_ps( a, scale ) );
+        __m128i ib = _mm_cvtps_epi32( _mm_mul_ps( b, scale ) );
+
+        // SSE2 only packs signed, shift into the signed range and back
+        __m128i packed = _mm_packs_epi32( _mm_sub_epi32( ia, bias ), _mm_sub_epi32( ib, bias ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(destination+i), _mm_xor_si128( packed, flip ) );
+    }
+#endif
+    for( ; i<n; i++ )
+        destination[i] = static_cast<unsigned short>( clamp( source[i], 0.0f, 1.0f ) * 65535.0f + 0.5f );
+}
+
+
+template <typename T>
+inline void encode_snorm16( const T *source, short *destination, size_t n )
+{
+    for( size_t i=0; i<n; i++ )
+        destination[i] = static_cast<short>( round_to_int( clamp( static_cast<float>(source[i]), -1.0f, 1.0f ) * 32767.0f ) );
+}
+
+
+inline void encode_snorm16( const float *source, short *destination, size_t n )
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 lo = _mm_set1_ps( -1.0f ), hi = _mm_set1_ps( 1.0f ), scale = _mm_set1_ps( 32767.0f );
+    for( ; i+8<=n; i+=8 )
+    {
+        __m128 a = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( source+i ), lo ), hi );
+        __m128 b = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( source+i+4 ), lo ), hi );
+        __m128i packed = _mm_packs_epi32( _mm_cvtps_epi32( _mm_mul_ps( a, scale ) ), _mm_cvtps_epi32( _mm_mul_ps( b, scale ) ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(destination+i), packed );
+    }
+#endif
+    for( ; i<n; i++ )
+        destination[i] = static_cast<short>( round_to_int( clamp( source[i], -1.0f, 1.0f ) * 32767.0f ) );
+}
+
+
+/////
+// Per vertex encoders, count is the number of vertices
+///
+
+template <typename T>
+inline void encode_2_10_10_10( const T *source, unsigned int *destination, size_t count, unsigned int components )
+{
+    for( size_t i=0; i<count; i++, source+=components )
+    {
+        unsigned int x = static_cast<unsigned int>( round_to_int( clamp( static_cast<float>(source[0]), -1.0f, 1.0f ) * 511.0f ) ) & 0x3FF;
+        unsigned int y = static_cast<unsigned int>( round_to_int( clamp( static_cast<float>(source[1]), -1.0f, 1.0f ) * 511.0f ) ) & 0x3FF;
+        unsigned int z = static_cast<unsigned int>( round_to_int( clamp( static_cast<float>(source[2]), -1.0f, 1.0f ) * 511.0f ) ) & 0x3FF;
+        unsigned int w = components > 3 ? static_cast<unsigned int>( round_to_int( clamp( static_cast<float>(source[3]), -1.0f, 1.0f ) ) ) & 0x3 : 0;
+
+        destination[i] = x | (y << 10) | (z << 20) | (w << 30);
+    }
+}
+
+
+template <typename T>
+inline void encode_octahedral( const T *source, short *destination, size_t count )
+{
+    for( size_t i=0; i<count; i++, source+=3, destination+=2 )
+    {
+        float x = static_cast<float>(source[0]), y = static_cast<float>(source[1]), z = static_cast<float>(source[2]);
+        float l1 = std::fabs(x) + std::fabs(y) + std::fabs(z);
+        if( l1 == 0.0f )
+            l1 = 1.0f;
+
+        // project onto the octahedron, fold the lower half over the upper one
+        float u = x / l1, v = y / l1;
+        if( z < 0.0f )
+        {
+            float fu = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+            float fv = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+            u = fu;
+            v = fv;
+        }
+
+        destination[0] = static_cast<short>( round_to_int( clamp( u, -1.0f, 1.0f ) * 32767.0f ) );
+        destination[1] = static_cast<short>( round_to_int( clamp( v, -1.0f, 1.0f ) * 32767.0f ) );
+    }
+}
+
+
+/////
+// Index narrowing, n is the number of indices. With restart the primitive restart
+// index (all bits set) is not counted by max_index, narrow saturates so it stays
+// the restart index of the narrower type.
+///
+
+template <typename T>
+inline T max_index( const T *source, size_t n, bool restart=false )
+{
+    // the restart index wraps around to 0
+    const T bias = restart ? 1 : 0;
+    T m = 0;
+    for( size_t i=0; i<n; i++ )
+    {
+        T v = static_cast<T>( source[i] + bias );
+        m = v > m ? v : m;
+    }
+    return m > 0 ? static_cast<T>( m - bias ) : 0;
+}
+
+
+inline unsigned int max_index( const unsigned int *source, size_t n, bool restart=false )
+{
+    const unsigned int bias = restart ? 1u : 0u;
+    unsigned int m = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    // SSE2 only compares signed, flip the sign bit to compare unsigned
+    const __m128i flip = _mm_set1_epi32( static_cast<int>(0x80000000u) ), vbias = _mm_set1_epi32( static_cast<int>(bias) );
+    __m128i vm = flip;
+    for( ; i+4<=n; i+=4 )
+    {
+        __m128i v = _mm_xor_si128( _mm_add_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>(source+i) ), vbias ), flip );
+        __m128i greater = _mm_cmpgt_epi32( v, vm );
+        vm = _mm_or_si128( _mm_and_si128( greater, v ), _mm_andnot_si128( greater, vm ) );
+    }
+
+    unsigned int lanes[4];
+    _mm_storeu_si128( reinterpret_cast<__m128i*>(lanes), _mm_xor_si128( vm, flip ) );
+    for( int j=0; j<4; j++ )
+        m = lanes[j] > m ? lanes[j] : m;
+#endif
+    for( ; i<n; i++ )
+        m = source[i]+bias > m ? source[i]+bias : m;
+    return m > 0 ? m - bias : 0;
+}
+
+
+template <typename T, typename Tdst>
+inline void narrow( const T *source, Tdst *destination, size_t n )
+{
+    const T largest = static_cast<T>( static_cast<Tdst>( ~static_cast<Tdst>(0) ) );
+    for( size_t i=0; i<n; i++ )
+        destination[i] = static_cast<Tdst>( source[i] < largest ? source[i] : largest );
+}
+
+
+#if defined(__SSE2__)
+// indices of 2^31 and above would be negative for the signed packs, clamp them below
+inline __m128i saturate_index( __m128i v )
+{
+    __m128i negative = _mm_srai_epi32( v, 31 );
+    return _mm_or_si128( _mm_andnot_si128( negative, v ), _mm_srli_epi32( negative, 1 ) );
+}
+#endif
+
+
+inline void narrow( const unsigned int *source, unsigned short *destination, size_t n )
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi32( 32768 ), flip = _mm_set1_epi16( static_cast<short>(0x8000) );
+    for( ; i+8<=n; i+=8 )
+    {
+        __m128i a = _mm_sub_epi32( saturate_index( _mm_loadu_si128( reinterpret_cast<const __m128i*>(source+i) ) ), bias );
+        __m128i b = _mm_sub_epi32( saturate_index( _mm_loadu_si128( reinterpret_cast<const __m128i*>(source+i+4) ) ), bias );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(destination+i), _mm_xor_si128( _mm_packs_epi32( a, b ), flip ) );
+    }
+#endif
+    for( ; i<n; i++ )
+        destination[i] = static_cast<unsigned short>( source[i] < 0xFFFFu ? source[i] : 0xFFFFu );
+}
+
+
+inline void narrow( const unsigned int *source, unsigned char *destination, size_t n )
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    // indices below 256 survive both saturating packs
+    for( ; i+16<=n; i+=16 )
+    {
+        const __m128i *s = reinterpret_cast<const __m128i*>(source+i);
+        __m128i lo = _mm_packs_epi32( saturate_index( _mm_loadu_si128( s ) ), saturate_index( _mm_loadu_si128( s+1 ) ) );
+        __m128i hi = _mm_packs_epi32( saturate_index( _mm_loadu_si128( s+2 ) ), saturate_index( _mm_loadu_si128( s+3 ) ) );
+        _mm_storeu_si128( reinterpret_cast<__m128i*>(destination+i), _mm_packus_epi16( lo, hi ) );
+    }
+#endif
+    for( ; i<n; i++ )
+        destination[i] = static_cast<unsigned char>( source[i] < 0xFFu ? source[i] : 0xFFu );
+}
+
+
+// GLSL function decoding an octahedral normal from the normalized attribute
+inline const char* octahedral_glsl()
+{
+    return "vec3 octahedral_decode( vec2 e )\n"
+           "{\n"
+           "    vec3 n = vec3( e.xy, 1.0 - abs(e.x) - abs(e.y) );\n"
+           "    float t = max( -n.z, 0.0 );\n"
+           "    n.x += n.x >= 0.0 ? -t : t;\n"
+           "    n.y += n.y >= 0.0 ? -t : t;\n"
+           "    return normalize( n );\n"
+           "}\n";
+}
+
+
+} // end namespace util
+} // end namespace nyx
@@ -0,0 +1,211 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+#include <nyx/util.hpp>
+#include <nyx/state.hpp>
+#include <nyx/resources.hpp>
+
+namespace nyx
+{
+
+/*
+ * readback.hpp
+ *
+ *      T - defines the type of the data used (float, double...)
+ *
+ *      Handle of an asynchronous read of buffer contents, see buffer::read_async.
+ *      The data is copied on the GPU into a GL_STREAM_READ staging buffer owned
+ *      by the handle and fenced. Poll is_ready() once per frame (or wait()) and
+ *      fetch the result with data() after the fence signaled, which doesn't
+ *      stall the pipeline. The staging buffer is kept for the next request, keep
+ *      one handle per frame in flight.
+ */
+
+
+template <typename T>
+class readback
+{
+public:
+    readback();
+    ~readback();
+
+    void request( unsigned int identifier, std::size_t offset, std::size_t length );
+
+    bool is_pending() const;
+    bool is_ready() const;
+    void wait() const;
+
+    const std::vector<T>& data();
+
+protected:
+    void fetch();
+
+private:
+    readback( const readback<T> &other );
+    readback<T>& operator=( const readback<T> &other );
+
+protected:
+    unsigned int m_staging;
+    resources *m_resources;
+    std::size_t m_capacity;
+    std::size_t m_length;
+
+    mutable GLsync m_fence;
+    bool m_pending;
+    std::vector<T> m_data;
+};
+
+
+template <typename T>
+inline readback<T>::readback() :
+    m_staging(0),
+    m_resources(0),
+    m_capacity(0),
+    m_length(0),
+    m_fence(0),
+    m_pending(false)
+{
+}
+
+
+template <typename T>
+inline readback<T>::~readback()
+{
+    if( m_resources != 0 )
+    {
+        m_resources->release_sync( m_fence );
+        m_resources->release_buffer( m_staging );
+    }
+}
+
+
+template <typename T>
+inline void readback<T>::request( unsigned int identifier, std::size_t offset, std::size_t length )
+{
+    // a previous result that was never fetched is dropped
+    if( m_fence != 0 )
+        glDeleteSync( m_fence );
+    m_fence = 0;
+
+    if( m_staging == 0 )
+    {
+        m_resources = &resources::current();
+        m_staging = m_resources->create_buffer();
+    }
+
+    if( state::current().direct_state_access() )
+    {
+        if( length > m_capacity )
+        {
+            glNamedBufferData( m_staging, length, 0, GL_STREAM_READ );
+            m_capacity = length;
+        }
+        glCopyNamedBufferSubData( identifier, m_staging, offset, 0, length );
+    }
+    else
+    {
+        state::current().bind_buffer( GL_COPY_WRITE_BUFFER, m_staging );
+        if( length > m_capacity )
+        {
+            glBufferData( GL_COPY_WRITE_BUFFER, length, 0, GL_STREAM_READ );
+            m_capacity = length;
+        }
+
+        state::current().bind_buffer( GL_COPY_READ_BUFFER, identifier );
+        glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, length );
+    }
+
+    m_fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    m_length = length;
+    m_pending = true;
+}
+
+
+template <typename T>
+inline bool readback<T>::is_pending() const
+{
+    return m_pending;
+}
+
+
+template <typename T>
+inline bool readback<T>::is_ready() const
+{
+    if( m_fence == 0 )
+        return m_pending;
+
+    // flush once, so the fence gets signaled even if nothing else is submitted
+    GLenum result = glClientWaitSync( m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0 );
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+
+template <typename T>
+inline void readback<T>::wait() const
+{
+    if( m_fence == 0 )
+        return;
+
+    while( glClientWaitSync( m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 ) == GL_TIMEOUT_EXPIRED ) {}
+}
+
+
+template <typename T>
+inline const std::vector<T>& readback<T>::data()
+{
+    if( m_pending )
+    {
+        wait();
+        fetch();
+    }
+
+    return m_data;
+}
+
+
+template <typename T>
+inline void readback<T>::fetch()
+{
+    // the copy is complete, reading the staging buffer does not stall anymore
+    m_data.resize( m_length / sizeof(T) );
+    if( !m_data.empty() )
+    {
+        if( state::current().direct_state_access() )
+            glGetNamedBufferSubData( m_staging, 0, m_data.size()*sizeof(T), &m_data[0] );
+        else
+        {
+            state::current().bind_buffer( GL_COPY_READ_BUFFER, m_staging );
+            glGetBufferSubData( GL_COPY_READ_BUFFER, 0, m_data.size()*sizeof(T), &m_data[0] );
+        }
+    }
+
+    if( m_fence != 0 )
+        glDeleteSync( m_fence );
+    m_fence = 0;
+    m_pending = false;
+}
+
+
+} // end namespace nyx
@@ -0,0 +1,524 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <nyx/util.hpp>
+#include <nyx/state.hpp>
+
+namespace nyx
+{
+
+/*
+ * resources.hpp
+ *
+ *      Registry of the GL object names of a context. Names of buffers,
+ *      textures, framebuffers, renderbuffers and vertex arrays are generated
+ *      in batches and handed out one at a time, so creating an object rarely
+ *      reaches GL. The create functions must be called on the thread that
+ *      owns the context.
+ *
+ *      Releasing a name into a deferred registry only queues it, which never
+ *      stalls and is safe on any thread. collect() fences everything queued
+ *      since the previous call and deletes the names whose fence has signaled,
+ *      with one glDelete* call per kind. Shaders, programs and syncs are not
+ *      used by the GPU after being released, they are deleted by the next
+ *      collect() right away. Every create collects as well, call it once per
+ *      frame on the context thread to not depend on that.
+ *
+ *      A registry that is not deferred deletes released names right away,
+ *      like plain glDelete* calls, as long as they are released on the context
+ *      thread (the one that last created or collected). Releases from other
+ *      threads can't reach the context, they are queued as if it were deferred.
+ *      Without a registry made current objects use a fallback one, which is
+ *      not deferred and generates one name at a time, nobody flushes it.
+ *
+ *      Every context needs its own registry, make it current together with
+ *      the context and the state. Objects remember the registry their names
+ *      came from and release them into it, whichever is current at the time,
+ *      so it has to outlive them. Call flush() before destroying the context,
+ *      it waits for the GPU and deletes everything pending as well as the
+ *      names that were never handed out. The destructor does not touch GL.
+ *
+ *      With direct state access the batches are created with glCreate*, so
+ *      every name already is an object that can be edited without binding it.
+ *      Textures are created for a target then, each target has its own batch.
+ *
+ *      zero_buffer hands out a buffer of zeros shared by the whole context,
+ *      e.g. to clear textures from a pixel unpack buffer instead of a zero
+ *      filled client array. It only grows and is zeroed on the GPU where
+ *      possible, flush() deletes it.
+ */
+
+
+class resources
+{
+public:
+    resources( unsigned int batch=64, bool deferred=true );
+
+    static resources& current();
+    static void make_current( resources *r );
+
+    unsigned int create_buffer();
+    unsigned int create_texture( unsigned int target=GL_TEXTURE_2D );
+    unsigned int create_framebuffer();
+    unsigned int create_renderbuffer();
+    unsigned int create_vertex_array();
+
+    void release_buffer( unsigned int id );
+    void release_texture( unsigned int id );
+    void release_framebuffer( unsigned int id );
+    void release_renderbuffer( unsigned int id );
+    void release_vertex_array( unsigned int id );
+    void release_shader( unsigned int id );
+    void release_program( unsigned int id );
+    void release_sync( GLsync fence );
+
+    unsigned int zero_buffer( std::size_t length );
+
+    void collect();
+    void flush();
+
+    std::size_t pending() const;
+    bool is_deferred() const;
+
+protected:
+    enum kind { buffers, textures, framebuffers, renderbuffers, vertex_arrays, shaders, programs, kinds };
+
+    // names released together, deleted once their fence signaled
+    struct generation
+    {
+        GLsync fence;
+        std::vector<unsigned int> names[kinds];
+        std::vector<GLsync> syncs;
+    };
+
+    static resources*& current_pointer();
+
+    unsigned int create( int kind, unsigned int target=0 );
+    void release( int kind, unsigned int id );
+    void select_mode();
+    static void destroy( int kind, std::vector<unsigned int> &names );
+    static void generate( int kind, unsigned int target, bool direct, std::vector<unsigned int> &names );
+
+protected:
+    unsigned int m_batch;
+    bool m_deferred;
+
+    // only touched on the context thread, textures are kept apart by target
+    bool m_direct;
+    std::vector<unsigned int> m_free[shaders];
+    std::vector< std::pair<unsigned int, std::vector<unsigned int> > > m_freeTextures;
+    std::deque<generation> m_fenced;
+    unsigned int m_zeroBuffer;
+    std::size_t m_zeroLength;
+
+    // filled from any thread
+    generation m_queued;
+    std::thread::id m_thread;
+    mutable std::mutex m_mutex;
+};
+
+
+/////
+// Implementation
+///
+inline resources::resources( unsigned int batch, bool deferred ) :
+    m_batch( batch > 0 ? batch : 1 ),
+    m_deferred( deferred ),
+    m_direct( false ),
+    m_zeroBuffer( 0 ),
+    m_zeroLength( 0 )
+{
+    m_queued.fence = 0;
+}
+
+
+inline resources*& resources::current_pointer()
+{
+    static resources *r = 0;
+    return r;
+}
+
+
+inline resources& resources::current()
+{
+    static resources fallback( 1, false );
+    resources *r = current_pointer();
+    return r != 0 ? *r : fallback;
+}
+
+
+inline void resources::make_current( resources *r )
+{
+    current_pointer() = r;
+}
+
+
+inline unsigned int resources::create_buffer() { return create( buffers ); }
+inline unsigned int resources::create_texture( unsigned int target ) { return create( textures, target ); }
+inline unsigned int resources::create_framebuffer() { return create( framebuffers ); }
+inline unsigned int resources::create_renderbuffer() { return create( renderbuffers ); }
+inline unsigned int resources::create_vertex_array() { return create( vertex_arrays ); }
+
+inline void resources::release_buffer( unsigned int id ) { release( buffers, id ); }
+inline void resources::release_texture( unsigned int id ) { release( textures, id ); }
+inline void resources::release_framebuffer( unsigned int id ) { release( framebuffers, id ); }
+inline void resources::release_renderbuffer( unsigned int id ) { release( renderbuffers, id ); }
+inline void resources::release_vertex_array( unsigned int id ) { release( vertex_arrays, id ); }
+inline void resources::release_shader( unsigned int id ) { release( shaders, id ); }
+inline void resources::release_program( unsigned int id ) { release( programs, id ); }
+
+
+inline void resources::release_sync( GLsync fence )
+{
+    if( fence == 0 )
+        return;
+
+    {
+        // other threads can't reach the context, they always queue
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if( m_deferred || std::this_thread::get_id() != m_thread )
+        {
+            m_queued.syncs.push_back( fence );
+            return;
+        }
+    }
+
+    glDeleteSync( fence );
+}
+
+
+inline unsigned int resources::create( int kind, unsigned int target )
+{
+    // creating happens on the context thread, a good moment to delete what's done
+    collect();
+
+    select_mode();
+
+    // generated texture names get their target when they are bound first
+    if( !m_direct )
+        target = 0;
+
+    std::vector<unsigned int> *pool = &m_free[kind];
+    if( kind == textures )
+    {
+        std::size_t i = 0;
+        while( i < m_freeTextures.size() && m_freeTextures[i].first != target )
+            i++;
+        if( i == m_freeTextures.size() )
+            m_freeTextures.push_back( std::make_pair( target, std::vector<unsigned int>() ) );
+        pool = &m_freeTextures[i].second;
+    }
+
+    std::vector<unsigned int> &names = *pool;
+    if( names.empty() )
+    {
+        names.resize( m_batch );
+        generate( kind, target, m_direct, names );
+
+        // hand out the lowest names first
+        std::reverse( names.begin(), names.end() );
+    }
+
+    unsigned int id = names.back();
+    names.pop_back();
+    return id;
+}
+
+
+inline void resources::select_mode()
+{
+    bool direct = state::current().direct_state_access();
+    if( direct == m_direct )
+        return;
+
+    // generated names are no objects yet, DSA can not use them
+    for( std::size_t i=0; i<m_freeTextures.size(); i++ )
+        m_free[textures].insert( m_free[textures].end(), m_freeTextures[i].second.begin(), m_freeTextures[i].second.end() );
+    m_freeTextures.clear();
+
+    for( int k=0; k<shaders; k++ )
+    {
+        if( m_deferred )
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_queued.names[k].insert( m_queued.names[k].end(), m_free[k].begin(), m_free[k].end() );
+            m_free[k].clear();
+        }
+        else
+            destroy( k, m_free[k] );
+    }
+
+    m_direct = direct;
+}
+
+
+inline void resources::release( int kind, unsigned int id )
+{
+    if( id == 0 )
+        return;
+
+    {
+        // other threads can't reach the context, they always queue
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if( m_deferred || std::this_thread::get_id() != m_thread )
+        {
+            m_queued.names[kind].push_back( id );
+            return;
+        }
+    }
+
+    std::vector<unsigned int> names( 1, id );
+    destroy( kind, names );
+}
+
+
+inline void resources::collect()
+{
+    generation released;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_thread = std::this_thread::get_id();
+        for( int k=0; k<kinds; k++ )
+            released.names[k].swap( m_queued.names[k] );
+        released.syncs.swap( m_queued.syncs );
+    }
+
+    // GL keeps shaders and programs alive while they are in use
+    destroy( shaders, released.names[shaders] );
+    destroy( programs, released.names[programs] );
+    for( std::size_t i=0; i<released.syncs.size(); i++ )
+        glDeleteSync( released.syncs[i] );
+    released.syncs.clear();
+
+    // everything else waits until the GPU passed the current point
+    bool empty = true;
+    for( int k=0; k<shaders; k++ )
+        empty = empty && released.names[k].empty();
+
+    if( !empty )
+    {
+        m_fenced.push_back( generation() );
+        m_fenced.back().fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+        for( int k=0; k<shaders; k++ )
+            m_fenced.back().names[k].swap( released.names[k] );
+    }
+
+    // the fences signal in order, stop at the first busy one
+    while( !m_fenced.empty() )
+    {
+        GLenum result = glClientWaitSync( m_fenced.front().fence, 0, 0 );
+        if( result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED )
+            break;
+
+        glDeleteSync( m_fenced.front().fence );
+        for( int k=0; k<shaders; k++ )
+            destroy( k, m_fenced.front().names[k] );
+        m_fenced.pop_front();
+    }
+}
+
+
+inline unsigned int resources::zero_buffer( std::size_t length )
+{
+    if( length <= m_zeroLength )
+        return m_zeroBuffer;
+
+    // the old one may still be read by the GPU
+    release( buffers, m_zeroBuffer );
+    m_zeroBuffer = create( buffers );
+    m_zeroLength = length;
+
+    bool direct = state::current().direct_state_access();
+    if( !direct )
+        state::current().bind_buffer( GL_COPY_WRITE_BUFFER, m_zeroBuffer );
+
+    if( direct )
+        glNamedBufferData( m_zeroBuffer, length, 0, GL_STATIC_DRAW );
+    else
+        glBufferData( GL_COPY_WRITE_BUFFER, length, 0, GL_STATIC_DRAW );
+
+    // zero it on the GPU if possible, otherwise write through a mapping
+    if( GLEW_VERSION_4_3 || GLEW_ARB_clear_buffer_object )
+    {
+        if( direct )
+            glClearNamedBufferData( m_zeroBuffer, GL_R8, GL_RED, GL_UNSIGNED_BYTE, 0 );
+        else
+            glClearBufferData( GL_COPY_WRITE_BUFFER, GL_R8, GL_RED, GL_UNSIGNED_BYTE, 0 );
+    }
+    else
+    {
+        void *data = direct ? glMapNamedBufferRange( m_zeroBuffer, 0, length, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT ) :
+                              glMapBufferRange( GL_COPY_WRITE_BUFFER, 0, length, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+        if( data == 0 )
+            throw std::runtime_error("nyx::resources::zero_buffer: unable to map the buffer.");
+
+        std::memset( data, 0, length );
+        if( direct )
+            glUnmapNamedBuffer( m_zeroBuffer );
+        else
+            glUnmapBuffer( GL_COPY_WRITE_BUFFER );
+    }
+
+    return m_zeroBuffer;
+}
+
+
+inline void resources::flush()
+{
+    release( buffers, m_zeroBuffer );
+    m_zeroBuffer = 0;
+    m_zeroLength = 0;
+
+    collect();
+
+    while( !m_fenced.empty() )
+    {
+        GLenum result = glClientWaitSync( m_fenced.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 );
+        if( result == GL_TIMEOUT_EXPIRED )
+            continue;
+
+        glDeleteSync( m_fenced.front().fence );
+        for( int k=0; k<shaders; k++ )
+            destroy( k, m_fenced.front().names[k] );
+        m_fenced.pop_front();
+    }
+
+    // names that were never handed out
+    for( int k=0; k<shaders; k++ )
+        destroy( k, m_free[k] );
+    for( std::size_t i=0; i<m_freeTextures.size(); i++ )
+        destroy( textures, m_freeTextures[i].second );
+    m_freeTextures.clear();
+}
+
+
+inline std::size_t resources::pending() const
+{
+    std::size_t count = 0;
+    for( std::size_t i=0; i<m_fenced.size(); i++ )
+        for( int k=0; k<shaders; k++ )
+            count += m_fenced[i].names[k].size();
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+    for( int k=0; k<kinds; k++ )
+        count += m_queued.names[k].size();
+    return count + m_queued.syncs.size();
+}
+
+
+inline bool resources::is_deferred() const
+{
+    return m_deferred;
+}
+
+
+inline void resources::generate( int kind, unsigned int target, bool direct, std::vector<unsigned int> &names )
+{
+    GLsizei count = static_cast<GLsizei>( names.size() );
+
+    if( direct )
+    {
+        switch( kind )
+        {
+            case buffers : glCreateBuffers( count, &names[0] ); return;
+            case textures : glCreateTextures( target, count, &names[0] ); return;
+            case framebuffers : glCreateFramebuffers( count, &names[0] ); return;
+            case renderbuffers : glCreateRenderbuffers( count, &names[0] ); return;
+            case vertex_arrays : glCreateVertexArrays( count, &names[0] ); return;
+        }
+    }
+
+    switch( kind )
+    {
+        case buffers : glGenBuffers( count, &names[0] ); break;
+        case textures : glGenTextures( count, &names[0] ); break;
+        case framebuffers : glGenFramebuffersEXT( count, &names[0] ); break;
+        case renderbuffers : glGenRenderbuffersEXT( count, &names[0] ); break;
+        case vertex_arrays : glGenVertexArrays( count, &names[0] ); break;
+        default : throw std::runtime_error("nyx::resources::generate: names of this kind are not pooled.");
+    }
+}
+
+
+inline void resources::destroy( int kind, std::vector<unsigned int> &names )
+{
+    if( names.empty() )
+        return;
+
+    GLsizei count = static_cast<GLsizei>( names.size() );
+    state &s = state::current();
+
+    switch( kind )
+    {
+        case buffers :
+            for( std::size_t i=0; i<names.size(); i++ )
+                s.forget_buffer( names[i] );
+            glDeleteBuffers( count, &names[0] );
+            break;
+        case textures :
+            for( std::size_t i=0; i<names.size(); i++ )
+                s.forget_texture( names[i] );
+            glDeleteTextures( count, &names[0] );
+            break;
+        case framebuffers :
+            for( std::size_t i=0; i<names.size(); i++ )
+                s.forget_framebuffer( names[i] );
+            glDeleteFramebuffersEXT( count, &names[0] );
+            break;
+        case renderbuffers :
+            for( std::size_t i=0; i<names.size(); i++ )
+                s.forget_renderbuffer( names[i] );
+            glDeleteRenderbuffersEXT( count, &names[0] );
+            break;
+        case vertex_arrays :
+            for( std::size_t i=0; i<names.size(); i++ )
+                s.forget_vertex_array( names[i] );
+            glDeleteVertexArrays( count, &names[0] );
+            break;
+        case shaders :
+            for( std::size_t i=0; i<names.size(); i++ )
+                glDeleteShader( names[i] );
+            break;
+        case programs :
+            for( std::size_t i=0; i<names.size(); i++ )
+            {
+                s.forget_program( names[i] );
+                glDeleteProgram( names[i] );
+            }
+            break;
+    }
+
+    names.clear();
+}
+
+
+} // end namespace nyx
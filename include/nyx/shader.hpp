@@ -26,6 +26,7 @@
 #include <stdexcept>
 
 #include <nyx/util.hpp>
+#include <nyx/resources.hpp>
 
 
 namespace nyx
@@ -66,6 +67,7 @@ protected:
     bool m_initialized;
     std::string m_src;
     unsigned int m_id;
+    resources *m_resources;
 };
 
 typedef base_shader<vertex> vertex_shader;
@@ -77,7 +79,7 @@ typedef base_shader<geometry> geometry_shader;
 // Implementation
 ///
 template<shader_type T>
-inline base_shader<T>::base_shader() : m_initialized(false)
+inline base_shader<T>::base_shader() : m_initialized(false), m_resources(0)
 {
 }
 
@@ -85,7 +87,8 @@ inline base_shader<T>::base_shader() : m_initialized(false)
 template<shader_type T>
 inline base_shader<T>::~base_shader()
 {
-    glDeleteShader(m_id);
+    if( m_initialized )
+        m_resources->release_shader(m_id);
 }
 
 
@@ -95,6 +98,7 @@ inline void base_shader<T>::init()
     if( !m_initialized )
     {
         // create the shader
+        m_resources = &resources::current();
         m_id = glCreateShader(T);
         m_initialized = true;
     }
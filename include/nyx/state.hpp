@@ -0,0 +1,583 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+#include <nyx/util.hpp>
+
+namespace nyx
+{
+
+/*
+ * state.hpp
+ *
+ *      Shadow copy of the bindings of a GL context. All nyx wrappers change
+ *      bindings through the state of the current context, which only calls GL
+ *      if the binding actually changes. The bind functions return true if GL
+ *      was called.
+ *
+ *      Every context needs its own state, make it current together with the
+ *      context. Without one a default state is used. Everything starts out as
+ *      unknown, so the first bind always reaches GL. Call invalidate() after
+ *      foreign code changed bindings behind the back of nyx.
+ *
+ *      The state also selects how the wrappers modify objects. With direct
+ *      state access (GL 4.5 or ARB_direct_state_access) buffers, textures and
+ *      framebuffers are edited by name and the bindings stay untouched,
+ *      otherwise they are bound to be edited. DSA is used whenever it is
+ *      supported, set_direct_state_access(false) forces bind-to-edit and
+ *      defining NYX_NO_DSA compiles it out. Select the mode before creating
+ *      objects.
+ *
+ *      Likewise the array buffers are bound either through the fixed function
+ *      pointers and client states or through generic vertex attributes. The
+ *      generic path is the default in a core profile, which has no fixed
+ *      function arrays, set_generic_attributes(true) selects it for a
+ *      compatibility context. A core profile has no vertex array object 0
+ *      either, the state binds a default VAO of its own in its place.
+ *
+ *      A vertex array object released with release_vertex_array() stays bound
+ *      until something that a VAO captures (element buffer, client states,
+ *      attribute arrays, another VAO) is changed through the state, so consecutive draws of the
+ *      same vertex_buffer_object only bind once. Call bind_vertex_array(0)
+ *      before touching vertex arrays with plain GL.
+ */
+
+
+class state
+{
+public:
+    state();
+
+    static state& current();
+    static void make_current( state *s );
+
+    bool bind_buffer( unsigned int target, unsigned int id );
+    bool bind_vertex_array( unsigned int id );
+    void release_vertex_array();
+    bool active_texture( unsigned int unit );
+    bool bind_texture( unsigned int target, unsigned int id );
+    bool bind_framebuffer( unsigned int id );
+    bool bind_renderbuffer( unsigned int id );
+    bool use_program( unsigned int id );
+    bool enable_client_state( unsigned int array );
+    bool disable_client_state( unsigned int array );
+    bool enable_vertex_attrib_array( unsigned int index );
+    bool disable_vertex_attrib_array( unsigned int index );
+    bool primitive_restart( unsigned int indexType );
+
+    bool direct_state_access();
+    void set_direct_state_access( bool enable );
+
+    bool core_profile();
+    bool generic_attributes();
+    void set_generic_attributes( bool enable );
+
+    // deleting a bound object resets its binding to 0
+    void forget_buffer( unsigned int id );
+    void forget_vertex_array( unsigned int id );
+    void forget_texture( unsigned int id );
+    void forget_framebuffer( unsigned int id );
+    void forget_renderbuffer( unsigned int id );
+    void forget_program( unsigned int id );
+
+    void invalidate();
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+    void reset_statistics();
+
+protected:
+    static state*& current_pointer();
+
+    static int buffer_slot( unsigned int target );
+    static int texture_slot( unsigned int target );
+    static int client_state_slot( unsigned int array );
+
+    bool update( unsigned int &shadow, unsigned int value );
+    void flush_vertex_array();
+    void invalidate_vertex_array_state();
+
+protected:
+    static const unsigned int unknown = 0xFFFFFFFFu;
+    static const int buffer_slots = 9;
+    static const int texture_slots = 6;
+    static const int client_state_slots = 4;
+
+    unsigned int m_buffers[buffer_slots];
+    unsigned int m_vertexArray;
+    bool m_vertexArrayReleased;
+    unsigned int m_activeTexture;
+    std::vector<unsigned int> m_textures;
+    unsigned int m_framebuffer;
+    unsigned int m_renderbuffer;
+    unsigned int m_program;
+    unsigned int m_clientStates[client_state_slots];
+    std::vector<unsigned int> m_vertexAttribArrays;
+    unsigned int m_primitiveRestart;
+    unsigned int m_directStateAccess;
+    unsigned int m_coreProfile;
+    unsigned int m_genericAttributes;
+    unsigned int m_defaultVertexArray;
+
+    std::size_t m_hits;
+    std::size_t m_misses;
+};
+
+
+/////
+// Implementation
+///
+inline state::state() :
+    m_directStateAccess(unknown),
+    m_coreProfile(unknown),
+    m_genericAttributes(unknown),
+    m_defaultVertexArray(0),
+    m_hits(0),
+    m_misses(0)
+{
+    invalidate();
+}
+
+
+inline state*& state::current_pointer()
+{
+    static state *s = 0;
+    return s;
+}
+
+
+inline state& state::current()
+{
+    static state fallback;
+    state *s = current_pointer();
+    return s != 0 ? *s : fallback;
+}
+
+
+inline void state::make_current( state *s )
+{
+    current_pointer() = s;
+}
+
+
+inline bool state::bind_buffer( unsigned int target, unsigned int id )
+{
+    int slot = buffer_slot( target );
+
+    // the element buffer binding belongs to the bound VAO
+    if( target == GL_ELEMENT_ARRAY_BUFFER )
+        flush_vertex_array();
+
+    if( slot >= 0 && !update( m_buffers[slot], id ) )
+        return false;
+
+    glBindBuffer( target, id );
+    return true;
+}
+
+
+inline bool state::bind_vertex_array( unsigned int id )
+{
+    m_vertexArrayReleased = false;
+    if( !update( m_vertexArray, id ) )
+        return false;
+
+    // the default VAO of a core profile lives as long as the context
+    if( id == 0 && core_profile() )
+    {
+        if( m_defaultVertexArray == 0 )
+            glGenVertexArrays( 1, &m_defaultVertexArray );
+        id = m_defaultVertexArray;
+    }
+
+    glBindVertexArray( id );
+    invalidate_vertex_array_state();
+    return true;
+}
+
+
+inline void state::release_vertex_array()
+{
+    m_vertexArrayReleased = m_vertexArray != 0 && m_vertexArray != unknown;
+}
+
+
+inline bool state::active_texture( unsigned int unit )
+{
+    if( !update( m_activeTexture, unit ) )
+        return false;
+
+    glActiveTexture( unit );
+    return true;
+}
+
+
+inline bool state::bind_texture( unsigned int target, unsigned int id )
+{
+    // texture bindings are per unit, ask once which one is active
+    if( m_activeTexture == unknown )
+    {
+        GLint unit = GL_TEXTURE0;
+        glGetIntegerv( GL_ACTIVE_TEXTURE, &unit );
+        m_activeTexture = static_cast<unsigned int>( unit );
+    }
+
+    int slot = texture_slot( target );
+    if( slot >= 0 )
+    {
+        std::size_t index = (m_activeTexture - GL_TEXTURE0)*texture_slots + slot;
+        if( index >= m_textures.size() )
+            m_textures.resize( index - index%texture_slots + texture_slots, static_cast<unsigned int>(unknown) );
+
+        if( !update( m_textures[index], id ) )
+            return false;
+    }
+    else
+        m_misses++;
+
+    glBindTexture( target, id );
+    return true;
+}
+
+
+inline bool state::bind_framebuffer( unsigned int id )
+{
+    if( !update( m_framebuffer, id ) )
+        return false;
+
+    glBindFramebufferEXT( GL_FRAMEBUFFER_EXT, id );
+    return true;
+}
+
+
+inline bool state::bind_renderbuffer( unsigned int id )
+{
+    if( !update( m_renderbuffer, id ) )
+        return false;
+
+    glBindRenderbufferEXT( GL_RENDERBUFFER_EXT, id );
+    return true;
+}
+
+
+inline bool state::use_program( unsigned int id )
+{
+    if( !update( m_program, id ) )
+        return false;
+
+    glUseProgram( id );
+    return true;
+}
+
+
+inline bool state::enable_client_state( unsigned int array )
+{
+    flush_vertex_array();
+
+    int slot = client_state_slot( array );
+    if( slot >= 0 && !update( m_clientStates[slot], 1 ) )
+        return false;
+
+    glEnableClientState( array );
+    return true;
+}
+
+
+inline bool state::disable_client_state( unsigned int array )
+{
+    flush_vertex_array();
+
+    int slot = client_state_slot( array );
+    if( slot >= 0 && !update( m_clientStates[slot], 0 ) )
+        return false;
+
+    glDisableClientState( array );
+    return true;
+}
+
+
+inline bool state::enable_vertex_attrib_array( unsigned int index )
+{
+    flush_vertex_array();
+
+    if( index >= m_vertexAttribArrays.size() )
+        m_vertexAttribArrays.resize( index+1, static_cast<unsigned int>(unknown) );
+
+    if( !update( m_vertexAttribArrays[index], 1 ) )
+        return false;
+
+    glEnableVertexAttribArray( index );
+    return true;
+}
+
+
+inline bool state::disable_vertex_attrib_array( unsigned int index )
+{
+    flush_vertex_array();
+
+    if( index >= m_vertexAttribArrays.size() )
+        m_vertexAttribArrays.resize( index+1, static_cast<unsigned int>(unknown) );
+
+    if( !update( m_vertexAttribArrays[index], 0 ) )
+        return false;
+
+    glDisableVertexAttribArray( index );
+    return true;
+}
+
+
+inline bool state::primitive_restart( unsigned int indexType )
+{
+    // 0 disables, otherwise the largest value of the index type restarts
+    if( !update( m_primitiveRestart, indexType ) )
+        return false;
+
+    if( GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility )
+    {
+        if( indexType != 0 ) glEnable( GL_PRIMITIVE_RESTART_FIXED_INDEX ); else glDisable( GL_PRIMITIVE_RESTART_FIXED_INDEX );
+    }
+    else if( indexType != 0 )
+    {
+        glEnable( GL_PRIMITIVE_RESTART );
+        glPrimitiveRestartIndex( indexType == GL_UNSIGNED_BYTE ? 0xFFu : (indexType == GL_UNSIGNED_SHORT ? 0xFFFFu : 0xFFFFFFFFu) );
+    }
+    else
+        glDisable( GL_PRIMITIVE_RESTART );
+
+    return true;
+}
+
+
+inline bool state::direct_state_access()
+{
+#ifdef NYX_NO_DSA
+    return false;
+#else
+    // the extensions are only known once GLEW is initialized
+    if( m_directStateAccess == unknown )
+        m_directStateAccess = ( GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access ) ? 1 : 0;
+    return m_directStateAccess == 1;
+#endif
+}
+
+
+inline void state::set_direct_state_access( bool enable )
+{
+    m_directStateAccess = enable ? unknown : 0;
+}
+
+
+inline bool state::core_profile()
+{
+    if( m_coreProfile == unknown )
+    {
+        GLint mask = 0;
+        if( GLEW_VERSION_3_2 )
+            glGetIntegerv( GL_CONTEXT_PROFILE_MASK, &mask );
+        m_coreProfile = (mask & GL_CONTEXT_CORE_PROFILE_BIT) ? 1 : 0;
+    }
+    return m_coreProfile == 1;
+}
+
+
+inline bool state::generic_attributes()
+{
+    if( m_genericAttributes == unknown )
+        m_genericAttributes = core_profile() ? 1 : 0;
+    return m_genericAttributes == 1;
+}
+
+
+inline void state::set_generic_attributes( bool enable )
+{
+    // a core profile has no fixed function arrays
+    m_genericAttributes = ( enable || core_profile() ) ? 1 : 0;
+}
+
+
+inline void state::forget_buffer( unsigned int id )
+{
+    for( int i=0; i<buffer_slots; i++ )
+        if( m_buffers[i] == id )
+            m_buffers[i] = 0;
+}
+
+
+inline void state::forget_vertex_array( unsigned int id )
+{
+    if( m_vertexArray == id )
+    {
+        // deleting the bound VAO reverts to name 0, which is not our default VAO in a core profile
+        m_vertexArray = core_profile() ? unknown : 0;
+        m_vertexArrayReleased = false;
+        invalidate_vertex_array_state();
+    }
+}
+
+
+inline void state::forget_texture( unsigned int id )
+{
+    for( std::size_t i=0; i<m_textures.size(); i++ )
+        if( m_textures[i] == id )
+            m_textures[i] = 0;
+}
+
+
+inline void state::forget_framebuffer( unsigned int id )
+{
+    if( m_framebuffer == id )
+        m_framebuffer = 0;
+}
+
+
+inline void state::forget_renderbuffer( unsigned int id )
+{
+    if( m_renderbuffer == id )
+        m_renderbuffer = 0;
+}
+
+
+inline void state::forget_program( unsigned int id )
+{
+    if( m_program == id )
+        m_program = unknown;
+}
+
+
+inline void state::invalidate()
+{
+    for( int i=0; i<buffer_slots; i++ )
+        m_buffers[i] = unknown;
+
+    m_vertexArray = unknown;
+    m_vertexArrayReleased = false;
+    m_activeTexture = unknown;
+    m_textures.clear();
+    m_framebuffer = unknown;
+    m_renderbuffer = unknown;
+    m_program = unknown;
+    m_primitiveRestart = unknown;
+    invalidate_vertex_array_state();
+}
+
+
+inline std::size_t state::hits() const
+{
+    return m_hits;
+}
+
+
+inline std::size_t state::misses() const
+{
+    return m_misses;
+}
+
+
+inline void state::reset_statistics()
+{
+    m_hits = 0;
+    m_misses = 0;
+}
+
+
+inline int state::buffer_slot( unsigned int target )
+{
+    switch( target )
+    {
+        case GL_ARRAY_BUFFER :          return 0;
+        case GL_ELEMENT_ARRAY_BUFFER :  return 1;
+        case GL_PIXEL_PACK_BUFFER :     return 2;
+        case GL_PIXEL_UNPACK_BUFFER :   return 3;
+        case GL_COPY_READ_BUFFER :      return 4;
+        case GL_COPY_WRITE_BUFFER :     return 5;
+        case GL_DRAW_INDIRECT_BUFFER :  return 6;
+        case GL_UNIFORM_BUFFER :        return 7;
+        case GL_TEXTURE_BUFFER :        return 8;
+        default :                       return -1;
+    }
+}
+
+
+inline int state::texture_slot( unsigned int target )
+{
+    switch( target )
+    {
+        case GL_TEXTURE_1D :        return 0;
+        case GL_TEXTURE_2D :        return 1;
+        case GL_TEXTURE_3D :        return 2;
+        case GL_TEXTURE_2D_ARRAY :  return 3;
+        case GL_TEXTURE_CUBE_MAP :  return 4;
+        case GL_TEXTURE_RECTANGLE : return 5;
+        default :                   return -1;
+    }
+}
+
+
+inline int state::client_state_slot( unsigned int array )
+{
+    switch( array )
+    {
+        case GL_VERTEX_ARRAY :          return 0;
+        case GL_NORMAL_ARRAY :          return 1;
+        case GL_COLOR_ARRAY :           return 2;
+        case GL_TEXTURE_COORD_ARRAY :   return 3;
+        default :                       return -1;
+    }
+}
+
+
+inline bool state::update( unsigned int &shadow, unsigned int value )
+{
+    if( shadow == value )
+    {
+        m_hits++;
+        return false;
+    }
+
+    m_misses++;
+    shadow = value;
+    return true;
+}
+
+
+inline void state::flush_vertex_array()
+{
+    // unbind a released VAO before state it captures is changed, a core
+    // profile needs some VAO bound for that state to exist at all
+    if( m_vertexArrayReleased || (m_vertexArray == unknown && core_profile()) )
+        bind_vertex_array( 0 );
+}
+
+
+inline void state::invalidate_vertex_array_state()
+{
+    // these are part of the VAO and change along with it
+    m_buffers[ buffer_slot( GL_ELEMENT_ARRAY_BUFFER ) ] = unknown;
+    for( int i=0; i<client_state_slots; i++ )
+        m_clientStates[i] = unknown;
+    m_vertexAttribArrays.clear();
+}
+
+
+} // end namespace nyx
@@ -36,25 +36,30 @@ namespace nyx
 
 
 template <typename T>
-class texcoord_array_buffer : public array_buffer<T>
+class texcoord_array_buffer : public array_buffer<T, texcoord_array_buffer<T> >
 {
+    typedef array_buffer<T, texcoord_array_buffer<T> > base;
+    friend class buffer<T, texcoord_array_buffer<T> >;
+
+    static_assert( util::type<T>::is_signed() && util::type<T>::GL() != GL_BYTE, "nyx::texcoord_array_buffer: texCoods buffer does not support unsigned data types, as well as GL_BYTE." );
+
 public:
     texcoord_array_buffer();
 
-    virtual void set_components( unsigned int components );
+    void set_components( unsigned int components );
+
+    void bind() const;
 
-    virtual void bind() const;
+protected:
+    bool is_encoding_supported( unsigned int encoding ) const;
 };
 
 
 template <typename T>
-inline texcoord_array_buffer<T>::texcoord_array_buffer() : array_buffer<T>::array_buffer()
+inline texcoord_array_buffer<T>::texcoord_array_buffer() : base()
 {
     texcoord_array_buffer<T>::m_state = GL_TEXTURE_COORD_ARRAY;
-
-    // check if the type is compatible
-    if( !util::type<T>::is_signed() || util::type<T>::GL()==GL_BYTE )
-        throw std::runtime_error("nyx::texcoord_array_buffer::texcoord_array_buffer: texCoods buffer does not support unsigned data types, as well as GL_BYTE.");
+    texcoord_array_buffer<T>::m_location = 3;
 }
 
 template <typename T>
@@ -68,11 +73,24 @@ inline void texcoord_array_buffer<T>::set_components( unsigned int components )
 }
 
 
+template <typename T>
+inline bool texcoord_array_buffer<T>::is_encoding_supported( unsigned int encoding ) const
+{
+    // glTexCoordPointer does not normalize, unorm16 needs a generic attribute
+    if( encoding == encode_unorm16 )
+        return state::current().generic_attributes();
+    return encoding == encode_none || encoding == encode_half;
+}
+
+
 template <typename T>
 inline void texcoord_array_buffer<T>::bind() const
 {
-    buffer<T>::bind();
-    glTexCoordPointer( texcoord_array_buffer<T>::m_size, util::type<T>::GL(), 0, 0 );
+    base::bind();
+    if( state::current().generic_attributes() )
+        base::attribute_pointer( base::encoding() == encode_unorm16 );
+    else
+        glTexCoordPointer( base::gl_components(), base::gl_type(), 0, reinterpret_cast<const GLvoid*>(base::offset()) );
 }
 
 
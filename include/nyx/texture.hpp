@@ -24,6 +24,9 @@
 #include <iostream>
 
 #include <nyx/util.hpp>
+#include <nyx/state.hpp>
+#include <nyx/resources.hpp>
+#include <nyx/mipmap.hpp>
 
 namespace nyx
 {
@@ -33,6 +36,48 @@ namespace nyx
  *
  *  Created on: May 4, 2010
  *      Author: alex
+ *
+ *      set_data allocates immutable storage (glTexStorage) once, all uploads
+ *      replace the contents with glTexSubImage. Calling set_data again with the
+ *      same size and format only uploads. Unsized formats (the default GL_RGBA)
+ *      are stored in the sized format matching T, e.g. GL_RGBA32F for floats.
+ *      32 bit integers keep the unsized format and are normalized as before,
+ *      integer textures (usampler, isampler) are opt-in with an integer format,
+ *      e.g. set_format( GL_RGBA_INTEGER ) stores unsigned ints as GL_RGBA32UI.
+ *      Legacy formats without a sized equivalent (GL_LUMINANCE...), unsized 32
+ *      bit integers and drivers without texture storage get mutable storage,
+ *      allocated once as well.
+ *
+ *      update with a region replaces a part of the texture, the pixels start at
+ *      the first pixel of the region. set_stride sets the row length in pixels
+ *      of the source images (GL_UNPACK_ROW_LENGTH), e.g. to upload from a
+ *      padded camera image or a region of a larger one, 0 for tight rows.
+ *
+ *      Without pixels (0) the texture is cleared to zero on the GPU, with
+ *      glClearTexImage (GL 4.4 / ARB_clear_texture) or else slice by slice from
+ *      the shared zero buffer of the resources, never from a client array.
+ *
+ *      set_levels (before set_data) allocates a mip chain, 0 for the complete
+ *      one. The levels are regenerated after every upload, with glGenerateMipmap
+ *      where GL allows it for the format, otherwise on the CPU from the pixels
+ *      of update (see mipmap.hpp). After region updates and update_from the
+ *      CPU reads level 0 back first, which waits for the GPU, use update_levels
+ *      for streamed integer textures. set_mipmap_filter( filter_kaiser )
+ *      always filters on the CPU. update_levels uploads a precomputed chain in
+ *      one go instead.
+ *      Integer textures are sampled with GL_NEAREST, they can't be filtered.
+ *
+ *      update_from replaces the whole texture from a pixel unpack buffer, e.g.
+ *      one slot of a texture_stream (see texture_stream.hpp).
+ *
+ *      set_layers allocates a GL_TEXTURE_2D_ARRAY, depth() is the number of
+ *      layers and z the layer in region updates. Layers are never filtered
+ *      into each other, every one gets its own mip levels, and all of them are
+ *      sampled through a single binding, e.g. as the pages of a texture_atlas
+ *      (see atlas.hpp).
+ *
+ *      With direct state access the parameters and updates are applied by
+ *      name, only mutable storage still binds the texture to be allocated.
  */
 
 
@@ -46,13 +91,25 @@ public:
 
     void set_format( unsigned int format );
     void set_format( unsigned int internalFormat, unsigned int externalFormat );
+    void set_stride( unsigned int stride );
 
     void set_data( unsigned int width, const T *pixels );
     void set_data( unsigned int width, unsigned int height, const T *pixels );
     void set_data( unsigned int width, unsigned int height, unsigned int depth, const T *pixels );
+    void set_layers( unsigned int width, unsigned int height, unsigned int layers, const T *pixels );
 
     void update( const T *pixels );
     void update();
+    void update( const T *pixels, unsigned int x, unsigned int y, unsigned int width, unsigned int height );
+    void update( const T *pixels, unsigned int x, unsigned int y, unsigned int z, unsigned int width, unsigned int height, unsigned int depth );
+    void update_from( unsigned int pixelBuffer, std::size_t offset=0 );
+    void clear();
+
+    void set_levels( unsigned int levels );
+    void set_mipmap_filter( mip_filter filter );
+    void generate_mipmaps();
+    void update_levels( const T *levels );
+    void update_levels( const mip_chain<T> &chain, unsigned int layer=0 );
 
     void bind();
     void unbind();
@@ -60,25 +117,44 @@ public:
     unsigned int width() const;
     unsigned int height() const;
     unsigned int depth() const;
+    unsigned int stride() const;
+    bool is_array() const;
+    unsigned int levels() const;
 
     unsigned int internal_format() const;
     unsigned int external_format() const;
     unsigned int id() const;
 
 protected:
-    void init();
+    void init( unsigned int type, unsigned int width, unsigned int height, unsigned int depth );
+    void allocate();
+    void sub_image( const T *pixels, unsigned int level, unsigned int x, unsigned int y, unsigned int z, unsigned int width, unsigned int height, unsigned int depth );
+    void generate_mipmaps( const T *pixels );
+    unsigned int level_depth( unsigned int level ) const;
+    void parameter( unsigned int name, float value );
 
 protected:
     // texture data
     const T *m_pixels;
     unsigned int m_size[3];
+    unsigned int m_stride;
 
 
     // openGL relevant information
     unsigned int m_type;
     unsigned int m_internalFormat;
     unsigned int m_externalFormat;
+    unsigned int m_storageFormat;
     unsigned int m_identifier;
+    resources *m_resources;
+    bool m_allocated;
+
+    // mip levels, requested (0 for all) and allocated
+    unsigned int m_levels;
+    unsigned int m_levelCount;
+    mip_filter m_mipFilter;
+    mip_chain<T> m_mipmaps;
+    std::vector<T> m_levelZero;
 };
 
 
@@ -88,59 +164,59 @@ inline texture<T>::texture()
     // init stuff
     m_pixels = 0;
     m_size[0] = m_size[1] = m_size[2] = 0;
+    m_stride = 0;
 
     m_type = 0;
     m_internalFormat = GL_RGBA;
     m_externalFormat = GL_RGBA;
+    m_storageFormat = 0;
     m_identifier = 0;
+    m_resources = 0;
+    m_allocated = false;
+
+    m_levels = 1;
+    m_levelCount = 1;
+    m_mipFilter = filter_box;
 }
 
 
 template <typename T>
 inline texture<T>::~texture()
 {
-    if( m_identifier != 0 )
-    {
-        glDeleteTextures( 1, &m_identifier );
-    }
+    if( m_resources != 0 )
+        m_resources->release_texture( m_identifier );
 }
 
 
 template <typename T>
 inline void texture<T>::set_data( unsigned int width, const T *pixels )
 {
-    m_size[0] = width;
-    m_size[1] = 1;
-    m_size[2] = 1;
     m_pixels = pixels;
-    m_type = GL_TEXTURE_1D;
-
-    init();
+    init( GL_TEXTURE_1D, width, 1, 1 );
 }
 
 
 template <typename T>
 inline void texture<T>::set_data( unsigned int width, unsigned int height, const T *pixels )
 {
-    m_size[0] = width;
-    m_size[1] = height;
-    m_size[2] = 1;
     m_pixels = pixels;
-    m_type = GL_TEXTURE_2D;
-
-    init();
+    init( GL_TEXTURE_2D, width, height, 1 );
 }
 
 
 template <typename T>
 inline void texture<T>::set_data( unsigned int width, unsigned int height, unsigned int depth, const T *pixels )
 {
-    m_size[0] = width;
-    m_size[1] = height;
-    m_size[2] = depth;
-    m_type = GL_TEXTURE_3D;
+    m_pixels = pixels;
+    init( GL_TEXTURE_3D, width, height, depth );
+}
 
-    init();
+
+template <typename T>
+inline void texture<T>::set_layers( unsigned int width, unsigned int height, unsigned int layers, const T *pixels )
+{
+    m_pixels = pixels;
+    init( GL_TEXTURE_2D_ARRAY, width, height, layers );
 }
 
 
@@ -160,6 +236,13 @@ inline void texture<T>::set_format( unsigned int internalFormat, unsigned int ex
 }
 
 
+template <typename T>
+inline void texture<T>::set_stride( unsigned int stride )
+{
+    m_stride = stride;
+}
+
+
 template <typename T>
 inline void texture<T>::update( const T *pixels )
 {
@@ -171,125 +254,425 @@ inline void texture<T>::update( const T *pixels )
 template <typename T>
 inline void texture<T>::update()
 {
+    if( !m_allocated )
+        throw std::runtime_error("nyx::texture::update: the texture has no storage, call set_data first.");
+
     // if the pointer is 0 init with black
-    bool noData = m_pixels == 0;
-    T *pixels;
-    if( noData )
+    if( m_pixels == 0 )
+        clear();
+    else
     {
-        std::size_t length = m_size[0]*m_size[1]*m_size[2]* util::channels( m_externalFormat );
-        pixels = new T[ length ];
-        m_pixels = pixels;
-        for( size_t i=0; i<length; i++ )
-            pixels[i]=0;
+        sub_image( m_pixels, 0, 0, 0, 0, m_size[0], m_size[1], m_size[2] );
+        generate_mipmaps( m_pixels );
     }
+}
+
+
+template <typename T>
+inline void texture<T>::update( const T *pixels, unsigned int x, unsigned int y, unsigned int width, unsigned int height )
+{
+    update( pixels, x, y, 0, width, height, 1 );
+}
 
-    // set the row stride
-    //glPixelStorei(GL_UNPACK_ROW_LENGTH,m_stride);
-    glPixelStorei(GL_UNPACK_ALIGNMENT,1);
 
-    // bind the texture
-    bind();
+template <typename T>
+inline void texture<T>::update( const T *pixels, unsigned int x, unsigned int y, unsigned int z, unsigned int width, unsigned int height, unsigned int depth )
+{
+    if( !m_allocated )
+        throw std::runtime_error("nyx::texture::update: the texture has no storage, call set_data first.");
 
-    // load the texture to the GPU
-    switch(m_type)
+    if( x+width > m_size[0] || y+height > m_size[1] || z+depth > m_size[2] )
+        throw std::runtime_error("nyx::texture::update: region out of bounds.");
+
+    sub_image( pixels, 0, x, y, z, width, height, depth );
+    generate_mipmaps( 0 );
+}
+
+
+template <typename T>
+inline void texture<T>::update_from( unsigned int pixelBuffer, std::size_t offset )
+{
+    if( !m_allocated )
+        throw std::runtime_error("nyx::texture::update_from: the texture has no storage, call set_data first.");
+
+    // with an unpack buffer bound the pixel pointer is an offset into it
+    state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, pixelBuffer );
+    sub_image( reinterpret_cast<const T*>( offset ), 0, 0, 0, 0, m_size[0], m_size[1], m_size[2] );
+    state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+    generate_mipmaps( 0 );
+}
+
+
+template <typename T>
+inline void texture<T>::clear()
+{
+    if( !m_allocated )
+        throw std::runtime_error("nyx::texture::clear: the texture has no storage, call set_data first.");
+
+    // no data means zeros, on every level
+    if( GLEW_VERSION_4_4 || GLEW_ARB_clear_texture )
     {
-        case GL_TEXTURE_1D :
-            glTexImage1D ( m_type,
-                           0,
-                           m_internalFormat,
-                           static_cast<GLsizei>(m_size[0]),
-                           0,
-                           m_externalFormat,
-                           util::type<T>::GL(),
-                           m_pixels );
-            break;
-
-        case GL_TEXTURE_2D :
-            glTexImage2D ( m_type,
-                           0,
-                           m_internalFormat,
-                           static_cast<GLsizei>(m_size[0]),
-                           static_cast<GLsizei>(m_size[1]),
-                           0,
-                           m_externalFormat,
-                           util::type<T>::GL(),
-                           m_pixels );
-            break;
-
-        case GL_TEXTURE_3D :
-            glTexImage3D ( m_type,
-                           0,
-                           m_internalFormat,
-                           static_cast<GLsizei>(m_size[0]),
-                           static_cast<GLsizei>(m_size[1]),
-                           static_cast<GLsizei>(m_size[2]),
-                           0,
-                           m_externalFormat,
-                           util::type<T>::GL(),
-                           m_pixels);
-            break;
+        for( unsigned int l=0; l<m_levelCount; l++ )
+            glClearTexImage( m_identifier, static_cast<GLint>(l), m_externalFormat, util::type<T>::GL(), 0 );
+        return;
     }
 
-    // unbind the texture
-    unbind();
+    // the zeros only need to cover one tightly packed slice
+    std::size_t slice = std::size_t(m_size[0]) * m_size[1] * util::channels( m_externalFormat ) * sizeof(T);
+    unsigned int zeros = m_resources->zero_buffer( slice );
+
+    unsigned int stride = m_stride;
+    m_stride = 0;
+
+    state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, zeros );
+    for( unsigned int l=0; l<m_levelCount; l++ )
+        for( unsigned int z=0; z<level_depth( l ); z++ )
+            sub_image( 0, l, 0, 0, z, mip_extent( m_size[0], l ), mip_extent( m_size[1], l ), 1 );
+    state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+    m_stride = stride;
+}
+
+
+template <typename T>
+inline void texture<T>::set_levels( unsigned int levels )
+{
+    m_levels = levels;
+}
+
+
+template <typename T>
+inline void texture<T>::set_mipmap_filter( mip_filter filter )
+{
+    m_mipFilter = filter;
+}
+
+
+template <typename T>
+inline void texture<T>::generate_mipmaps()
+{
+    if( !m_allocated )
+        throw std::runtime_error("nyx::texture::generate_mipmaps: the texture has no storage, call set_data first.");
+
+    generate_mipmaps( m_pixels );
+}
+
 
-    // clean up
-    if( noData )
+template <typename T>
+inline void texture<T>::update_levels( const T *levels )
+{
+    if( !m_allocated )
+        throw std::runtime_error("nyx::texture::update_levels: the texture has no storage, call set_data first.");
+
+    // the levels are tightly packed one after another
+    unsigned int stride = m_stride;
+    m_stride = 0;
+
+    std::size_t channels = util::channels( m_externalFormat );
+    for( unsigned int l=0; l<m_levelCount; l++ )
     {
-        delete [] pixels;
-        m_pixels = 0;
+        unsigned int w = mip_extent( m_size[0], l ), h = mip_extent( m_size[1], l ), d = level_depth( l );
+        sub_image( levels, l, 0, 0, 0, w, h, d );
+        levels += std::size_t(w) * h * d * channels;
     }
+
+    m_stride = stride;
+}
+
+
+template <typename T>
+inline void texture<T>::update_levels( const mip_chain<T> &chain, unsigned int layer )
+{
+    if( !m_allocated )
+        throw std::runtime_error("nyx::texture::update_levels: the texture has no storage, call set_data first.");
+
+    // an array takes the chain of one layer, other textures the whole volume
+    unsigned int depth = is_array() ? 1 : m_size[2];
+    if( chain.width(0) != m_size[0] || chain.height(0) != m_size[1] || chain.depth(0) != depth || chain.levels() < m_levelCount )
+        throw std::runtime_error("nyx::texture::update_levels: the chain does not match the texture.");
+
+    if( layer >= m_size[2] || ( layer != 0 && !is_array() ) )
+        throw std::runtime_error("nyx::texture::update_levels: layer out of bounds.");
+
+    // the source of level 0 may have padded rows, the generated levels don't
+    sub_image( chain.level(0), 0, 0, 0, layer, m_size[0], m_size[1], depth );
+
+    unsigned int stride = m_stride;
+    m_stride = 0;
+    for( unsigned int l=1; l<m_levelCount; l++ )
+        sub_image( chain.level(l), l, 0, 0, layer, chain.width(l), chain.height(l), chain.depth(l) );
+    m_stride = stride;
 }
 
 
 template <typename T>
 inline void texture<T>::bind()
 {
-    glBindTexture(m_type, m_identifier);
+    state::current().bind_texture(m_type, m_identifier);
 }
 
 
 template <typename T>
 inline void texture<T>::unbind()
 {
-    glBindTexture(m_type, 0);
+    state::current().bind_texture(m_type, 0);
 }
 
 
 template <typename T>
-inline void texture<T>::init()
+inline void texture<T>::init( unsigned int type, unsigned int width, unsigned int height, unsigned int depth )
 {
-    // delete if necessary old texture
-    if( m_identifier != 0 )
+    // sized format for the pixel type, integer storage takes integer pixels
+    unsigned int storageFormat = util::sized_format( m_internalFormat, util::type<T>::GL() );
+    if( util::is_integer_format( storageFormat ) )
+        m_externalFormat = util::integer_format( m_externalFormat );
+    if( storageFormat == 0 )
+        storageFormat = m_internalFormat;
+
+    // the layers of an array don't shrink
+    unsigned int complete = mip_levels( width, height, type == GL_TEXTURE_2D_ARRAY ? 1 : depth );
+    unsigned int levelCount = m_levels == 0 ? complete : std::min( m_levels, complete );
+
+    // the storage stays as long as its layout does
+    bool keep = m_allocated &&
+                m_type == type &&
+                m_size[0] == width && m_size[1] == height && m_size[2] == depth &&
+                m_storageFormat == storageFormat &&
+                m_levelCount == levelCount;
+
+    m_type = type;
+    m_size[0] = width;
+    m_size[1] = height;
+    m_size[2] = depth;
+    m_storageFormat = storageFormat;
+    m_levelCount = levelCount;
+
+    if( !keep )
     {
-        glDeleteTextures( 1, &m_identifier );
+        // delete if necessary old texture
+        if( m_resources != 0 )
+            m_resources->release_texture( m_identifier );
+
+        // allocate a texture name
+        m_resources = &resources::current();
+        m_identifier = m_resources->create_texture( m_type );
+        m_allocated = false;
+
+        // select our current texture
+        bool bound = !state::current().direct_state_access();
+        if( bound )
+            bind();
+
+        allocate();
+
+        // select modulate to mix texture with color for shading, a core profile has no texture environment
+        bool core = state::current().core_profile();
+        if( !core )
+            glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+
+        // setup bilinear interpolation, trilinear with mip levels, integers can't be interpolated
+        bool integer = util::is_integer_format( m_storageFormat );
+        bool mipmapped = m_levelCount > 1;
+        parameter( GL_TEXTURE_MAG_FILTER, integer ? GL_NEAREST : GL_LINEAR );
+        parameter( GL_TEXTURE_MIN_FILTER, integer ? ( mipmapped ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST ) :
+                                                    ( mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST ) );
+        parameter( GL_TEXTURE_MAX_LEVEL, static_cast<float>( m_levelCount-1 ) );
+
+        // clamp or repeat
+        //glTexParameterf( type, GL_TEXTURE_WRAP_S, clamp ? GL_CLAMP : GL_REPEAT );
+        //glTexParameterf( type, GL_TEXTURE_WRAP_T, clamp ? GL_CLAMP : GL_REPEAT );
+        unsigned int clamp = core ? GL_CLAMP_TO_EDGE : GL_CLAMP;
+        parameter( GL_TEXTURE_WRAP_S, clamp );
+        parameter( GL_TEXTURE_WRAP_T, clamp );
+        parameter( GL_TEXTURE_WRAP_R, clamp );
+
+        // deselect the texture, direct state access leaves the binding alone
+        if( bound )
+            unbind();
     }
 
-    // allocate a texture name
-    glGenTextures( 1, &m_identifier );
+    // upload the texture
+    update();
+}
 
-    // select our current texture
-    bind();
 
-    // select modulate to mix texture with color for shading
-    glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+template <typename T>
+inline void texture<T>::allocate()
+{
+    GLsizei w = static_cast<GLsizei>(m_size[0]);
+    GLsizei h = static_cast<GLsizei>(m_size[1]);
+    GLsizei d = static_cast<GLsizei>(m_size[2]);
+    GLsizei levels = static_cast<GLsizei>(m_levelCount);
 
-    // setup bilinear interpolation
-    glTexParameterf( m_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-    glTexParameterf( m_type, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    // legacy formats can't be sized, they and old drivers get mutable storage
+    bool immutable = util::sized_format( m_storageFormat, util::type<T>::GL() ) != 0 &&
+                     ( GLEW_VERSION_4_2 || GLEW_ARB_texture_storage );
 
-    // clamp or repeat
-    //glTexParameterf( type, GL_TEXTURE_WRAP_S, clamp ? GL_CLAMP : GL_REPEAT );
-    //glTexParameterf( type, GL_TEXTURE_WRAP_T, clamp ? GL_CLAMP : GL_REPEAT );
-    glTexParameterf( m_type, GL_TEXTURE_WRAP_S, GL_CLAMP );
-    glTexParameterf( m_type, GL_TEXTURE_WRAP_T, GL_CLAMP );
-    glTexParameterf( m_type, GL_TEXTURE_WRAP_R, GL_CLAMP );
+    if( immutable && state::current().direct_state_access() )
+    {
+        switch(m_type)
+        {
+            case GL_TEXTURE_1D : glTextureStorage1D( m_identifier, levels, m_storageFormat, w ); break;
+            case GL_TEXTURE_2D : glTextureStorage2D( m_identifier, levels, m_storageFormat, w, h ); break;
+            case GL_TEXTURE_3D :
+            case GL_TEXTURE_2D_ARRAY : glTextureStorage3D( m_identifier, levels, m_storageFormat, w, h, d ); break;
+        }
+    }
+    else if( immutable )
+    {
+        switch(m_type)
+        {
+            case GL_TEXTURE_1D : glTexStorage1D( m_type, levels, m_storageFormat, w ); break;
+            case GL_TEXTURE_2D : glTexStorage2D( m_type, levels, m_storageFormat, w, h ); break;
+            case GL_TEXTURE_3D :
+            case GL_TEXTURE_2D_ARRAY : glTexStorage3D( m_type, levels, m_storageFormat, w, h, d ); break;
+        }
+    }
+    else
+    {
+        // mutable storage can only be specified through a binding, level by level
+        bind();
+        for( GLint l=0; l<levels; l++ )
+        {
+            GLsizei lw = std::max( 1, w >> l ), lh = std::max( 1, h >> l ), ld = static_cast<GLsizei>( level_depth( l ) );
+            switch(m_type)
+            {
+                case GL_TEXTURE_1D : glTexImage1D( m_type, l, m_storageFormat, lw, 0, m_externalFormat, util::type<T>::GL(), 0 ); break;
+                case GL_TEXTURE_2D : glTexImage2D( m_type, l, m_storageFormat, lw, lh, 0, m_externalFormat, util::type<T>::GL(), 0 ); break;
+                case GL_TEXTURE_3D :
+                case GL_TEXTURE_2D_ARRAY : glTexImage3D( m_type, l, m_storageFormat, lw, lh, ld, 0, m_externalFormat, util::type<T>::GL(), 0 ); break;
+            }
+        }
+
+        // without direct state access init bound the texture and unbinds it itself
+        if( state::current().direct_state_access() )
+            unbind();
+    }
 
-    // upload the texture
-    update();
+    m_allocated = true;
+}
+
+
+template <typename T>
+inline void texture<T>::sub_image( const T *pixels, unsigned int level, unsigned int x, unsigned int y, unsigned int z, unsigned int width, unsigned int height, unsigned int depth )
+{
+    GLint lv = static_cast<GLint>(level);
+    GLint ox = static_cast<GLint>(x);
+    GLint oy = static_cast<GLint>(y);
+    GLint oz = static_cast<GLint>(z);
+    GLsizei w = static_cast<GLsizei>(width);
+    GLsizei h = static_cast<GLsizei>(height);
+    GLsizei d = static_cast<GLsizei>(depth);
 
-    // deselect the texture
-    unbind();
+    // set the row stride
+    glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+    if( m_stride != 0 )
+        glPixelStorei(GL_UNPACK_ROW_LENGTH,static_cast<GLint>(m_stride));
+
+    if( state::current().direct_state_access() )
+    {
+        switch(m_type)
+        {
+            case GL_TEXTURE_1D : glTextureSubImage1D( m_identifier, lv, ox, w, m_externalFormat, util::type<T>::GL(), pixels ); break;
+            case GL_TEXTURE_2D : glTextureSubImage2D( m_identifier, lv, ox, oy, w, h, m_externalFormat, util::type<T>::GL(), pixels ); break;
+            case GL_TEXTURE_3D :
+            case GL_TEXTURE_2D_ARRAY : glTextureSubImage3D( m_identifier, lv, ox, oy, oz, w, h, d, m_externalFormat, util::type<T>::GL(), pixels ); break;
+        }
+    }
+    else
+    {
+        bind();
+        switch(m_type)
+        {
+            case GL_TEXTURE_1D : glTexSubImage1D( m_type, lv, ox, w, m_externalFormat, util::type<T>::GL(), pixels ); break;
+            case GL_TEXTURE_2D : glTexSubImage2D( m_type, lv, ox, oy, w, h, m_externalFormat, util::type<T>::GL(), pixels ); break;
+            case GL_TEXTURE_3D :
+            case GL_TEXTURE_2D_ARRAY : glTexSubImage3D( m_type, lv, ox, oy, oz, w, h, d, m_externalFormat, util::type<T>::GL(), pixels ); break;
+        }
+        unbind();
+    }
+
+    if( m_stride != 0 )
+        glPixelStorei(GL_UNPACK_ROW_LENGTH,0);
+}
+
+
+template <typename T>
+inline void texture<T>::generate_mipmaps( const T *pixels )
+{
+    if( m_levelCount < 2 )
+        return;
+
+    if( m_mipFilter == filter_box && util::can_generate_mipmaps( m_storageFormat ) )
+    {
+        if( state::current().direct_state_access() )
+            glGenerateTextureMipmap( m_identifier );
+        else
+        {
+            bind();
+            glGenerateMipmap( m_type );
+            unbind();
+        }
+        return;
+    }
+
+    unsigned int channels = static_cast<unsigned int>( util::channels( m_externalFormat ) );
+    unsigned int stride = m_stride;
+    unsigned int sourceStride = m_stride;
+
+    // the CPU needs the whole image, after region updates and update_from level 0 is read back
+    if( pixels == 0 )
+    {
+        m_levelZero.resize( std::size_t(m_size[0]) * m_size[1] * m_size[2] * channels );
+        GLsizei bytes = static_cast<GLsizei>( m_levelZero.size() * sizeof(T) );
+
+        glPixelStorei(GL_PACK_ALIGNMENT,1);
+        state::current().bind_buffer( GL_PIXEL_PACK_BUFFER, 0 );
+        if( state::current().direct_state_access() )
+            glGetTextureImage( m_identifier, 0, m_externalFormat, util::type<T>::GL(), bytes, &m_levelZero[0] );
+        else
+        {
+            bind();
+            glGetTexImage( m_type, 0, m_externalFormat, util::type<T>::GL(), &m_levelZero[0] );
+            unbind();
+        }
+
+        pixels = &m_levelZero[0];
+        sourceStride = 0;
+    }
+
+    // the layers of an array are filtered one by one
+    unsigned int layers = is_array() ? m_size[2] : 1;
+    unsigned int depth = is_array() ? 1 : m_size[2];
+    std::size_t layerSize = std::size_t( sourceStride != 0 ? sourceStride : m_size[0] ) * m_size[1] * channels;
+
+    for( unsigned int z=0; z<layers; z++ )
+    {
+        m_mipmaps.build( pixels + z*layerSize, m_size[0], m_size[1], depth, channels, m_levelCount, m_mipFilter, sourceStride );
+
+        m_stride = 0;
+        for( unsigned int l=1; l<m_levelCount; l++ )
+            sub_image( m_mipmaps.level(l), l, 0, 0, z, m_mipmaps.width(l), m_mipmaps.height(l), m_mipmaps.depth(l) );
+        m_stride = stride;
+    }
+}
+
+
+template <typename T>
+inline unsigned int texture<T>::level_depth( unsigned int level ) const
+{
+    return is_array() ? m_size[2] : mip_extent( m_size[2], level );
+}
+
+
+template <typename T>
+inline void texture<T>::parameter( unsigned int name, float value )
+{
+    if( state::current().direct_state_access() )
+        glTextureParameterf( m_identifier, name, value );
+    else
+        glTexParameterf( m_type, name, value );
 }
 
 
@@ -314,10 +697,32 @@ inline unsigned int texture<T>::depth() const
 }
 
 
+template<typename T>
+inline unsigned int texture<T>::levels() const
+{
+    return m_levelCount;
+}
+
+
+template<typename T>
+inline unsigned int texture<T>::stride() const
+{
+    return m_stride;
+}
+
+
+template<typename T>
+inline bool texture<T>::is_array() const
+{
+    return m_type == GL_TEXTURE_2D_ARRAY;
+}
+
+
 template<typename T>
 inline unsigned int texture<T>::internal_format() const
 {
-    return m_internalFormat;
+    // the format of the storage once there is one
+    return m_allocated ? m_storageFormat : m_internalFormat;
 }
 
 
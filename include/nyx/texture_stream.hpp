@@ -0,0 +1,465 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <nyx/util.hpp>
+#include <nyx/state.hpp>
+#include <nyx/resources.hpp>
+#include <nyx/texture.hpp>
+
+namespace nyx
+{
+
+/*
+ * texture_stream.hpp
+ *
+ *      T - defines the type of the pixels (unsigned char, float...)
+ *      slots - number of pixel unpack buffers in the ring
+ *
+ *      Streams frames (camera images, video) into a texture through a ring of
+ *      pixel unpack buffers. A producer, which may run on another thread, gets
+ *      a mapped slot with acquire(), writes one frame of tightly packed pixels
+ *      (rows of the texture stride if set) and hands it over with commit().
+ *      The render thread calls upload() once per frame, which copies the
+ *      newest committed frame from offset 0 of its buffer into the texture.
+ *      The driver copies from GPU visible memory instead of blocking the render
+ *      thread, frames committed in between are dropped.
+ *
+ *      Each uploaded slot is fenced and only returned to the producer after the
+ *      GPU read it. With buffer storage (GL 4.4 / ARB_buffer_storage) the slots
+ *      are mapped persistently, otherwise upload unmaps a slot and maps it again
+ *      once it is free. All GL calls happen on the render thread (the one that
+ *      called configure), acquire blocks until upload recycled a slot, on the
+ *      render thread itself it waits for the GPU instead. Use try_acquire to
+ *      skip a frame rather than wait.
+ *
+ *      The texture needs storage (set_data) before configure and must outlive
+ *      the stream. Only one producer at a time, stop it before destroying the
+ *      stream.
+ */
+
+
+template <typename T>
+class texture_stream
+{
+public:
+    texture_stream();
+    ~texture_stream();
+
+    void configure( texture<T> &target, unsigned int slots=3 );
+
+    T* acquire();
+    T* try_acquire();
+    void commit();
+
+    bool upload();
+
+    std::size_t frame_size() const;
+    bool is_persistent() const;
+
+    unsigned int frames_uploaded() const;
+    unsigned int frames_dropped() const;
+
+protected:
+    T* acquire( bool wait );
+    void recycle( bool wait );
+    void map( unsigned int index );
+    void unmap( unsigned int index );
+    void release();
+
+private:
+    texture_stream( const texture_stream<T> &other );
+    texture_stream<T>& operator=( const texture_stream<T> &other );
+
+protected:
+    enum slot_state { slot_free, slot_writing, slot_ready, slot_in_flight };
+
+    struct slot
+    {
+        unsigned int buffer;
+        T *mapped;
+        GLsync fence;
+        slot_state state;
+        unsigned long frame;
+    };
+
+    texture<T> *m_texture;
+    resources *m_resources;
+    std::vector<slot> m_slots;
+    std::size_t m_frameSize;
+    bool m_persistent;
+    std::thread::id m_renderThread;
+
+    // slot held by the producer, the slots vector size if none
+    unsigned int m_writing;
+    unsigned long m_frame;
+
+    std::mutex m_mutex;
+    std::condition_variable m_available;
+
+    // statistics
+    unsigned int m_uploaded;
+    unsigned int m_dropped;
+};
+
+
+template <typename T>
+inline texture_stream<T>::texture_stream() :
+    m_texture(0),
+    m_resources(0),
+    m_frameSize(0),
+    m_persistent(false),
+    m_writing(0),
+    m_frame(0),
+    m_uploaded(0),
+    m_dropped(0)
+{
+}
+
+
+template <typename T>
+inline texture_stream<T>::~texture_stream()
+{
+    release();
+}
+
+
+template <typename T>
+inline void texture_stream<T>::configure( texture<T> &target, unsigned int slots )
+{
+    if( target.width() == 0 )
+        throw std::runtime_error("nyx::texture_stream::configure: the texture has no storage, call set_data first.");
+
+    if( slots < 2 )
+        throw std::runtime_error("nyx::texture_stream::configure: the ring needs at least two slots.");
+
+    release();
+
+    // one frame with the row length of the texture uploads
+    unsigned int rowLength = target.stride() != 0 ? target.stride() : target.width();
+    m_frameSize = std::size_t(rowLength) * target.height() * target.depth() * util::channels( target.external_format() ) * sizeof(T);
+
+    m_texture = &target;
+    m_resources = &resources::current();
+    m_persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    m_renderThread = std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    m_slots.resize( slots );
+    for( unsigned int i=0; i<slots; i++ )
+    {
+        slot &s = m_slots[i];
+        s.buffer = m_resources->create_buffer();
+        s.mapped = 0;
+        s.fence = 0;
+        s.state = slot_free;
+        s.frame = 0;
+
+        // allocate the storage, persistent storage stays mapped from here on
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        if( state::current().direct_state_access() )
+        {
+            if( m_persistent )
+                glNamedBufferStorage( s.buffer, m_frameSize, 0, flags );
+            else
+                glNamedBufferData( s.buffer, m_frameSize, 0, GL_STREAM_DRAW );
+        }
+        else
+        {
+            state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, s.buffer );
+            if( m_persistent )
+                glBufferStorage( GL_PIXEL_UNPACK_BUFFER, m_frameSize, 0, flags );
+            else
+                glBufferData( GL_PIXEL_UNPACK_BUFFER, m_frameSize, 0, GL_STREAM_DRAW );
+            state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+        }
+
+        map( i );
+    }
+
+    m_writing = slots;
+    m_frame = 0;
+    m_uploaded = 0;
+    m_dropped = 0;
+}
+
+
+template <typename T>
+inline T* texture_stream<T>::acquire()
+{
+    return acquire( true );
+}
+
+
+template <typename T>
+inline T* texture_stream<T>::try_acquire()
+{
+    return acquire( false );
+}
+
+
+template <typename T>
+inline void texture_stream<T>::commit()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    if( m_writing >= m_slots.size() )
+        throw std::runtime_error("nyx::texture_stream::commit: no frame was acquired.");
+
+    m_slots[m_writing].state = slot_ready;
+    m_slots[m_writing].frame = ++m_frame;
+    m_writing = static_cast<unsigned int>( m_slots.size() );
+}
+
+
+template <typename T>
+inline bool texture_stream<T>::upload()
+{
+    recycle( false );
+
+    // take the newest frame, older ones are outdated already
+    unsigned int newest = static_cast<unsigned int>( m_slots.size() );
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        for( unsigned int i=0; i<m_slots.size(); i++ )
+        {
+            if( m_slots[i].state != slot_ready )
+                continue;
+
+            if( newest == m_slots.size() )
+            {
+                newest = i;
+                continue;
+            }
+
+            unsigned int older = i;
+            if( m_slots[i].frame > m_slots[newest].frame )
+                std::swap( older, newest );
+
+            m_slots[older].state = slot_free;
+            m_dropped++;
+        }
+
+        if( newest == m_slots.size() )
+            return false;
+
+        m_slots[newest].state = slot_in_flight;
+        unmap( newest );
+    }
+
+    // dropped slots can be written again
+    m_available.notify_all();
+
+    // the copy is queued with the other commands, the fence tells when it's done
+    slot &s = m_slots[newest];
+    m_texture->update_from( s.buffer, 0 );
+    s.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    m_uploaded++;
+
+    return true;
+}
+
+
+template <typename T>
+inline std::size_t texture_stream<T>::frame_size() const
+{
+    return m_frameSize;
+}
+
+
+template <typename T>
+inline bool texture_stream<T>::is_persistent() const
+{
+    return m_persistent;
+}
+
+
+template <typename T>
+inline unsigned int texture_stream<T>::frames_uploaded() const
+{
+    return m_uploaded;
+}
+
+
+template <typename T>
+inline unsigned int texture_stream<T>::frames_dropped() const
+{
+    return m_dropped;
+}
+
+
+template <typename T>
+inline T* texture_stream<T>::acquire( bool wait )
+{
+    // the render thread has no one to recycle the slots for it
+    if( std::this_thread::get_id() == m_renderThread )
+        recycle( wait );
+
+    std::unique_lock<std::mutex> lock( m_mutex );
+
+    if( m_writing < m_slots.size() )
+        throw std::runtime_error("nyx::texture_stream::acquire: the previous frame was not committed.");
+
+    for(;;)
+    {
+        for( unsigned int i=0; i<m_slots.size(); i++ )
+        {
+            if( m_slots[i].state == slot_free && m_slots[i].mapped != 0 )
+            {
+                m_slots[i].state = slot_writing;
+                m_writing = i;
+                return m_slots[i].mapped;
+            }
+        }
+
+        if( !wait || m_slots.empty() )
+            return 0;
+
+        m_available.wait( lock );
+    }
+}
+
+
+template <typename T>
+inline void texture_stream<T>::recycle( bool wait )
+{
+    bool freed = false;
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        bool available = false;
+        for( unsigned int i=0; i<m_slots.size(); i++ )
+        {
+            slot &s = m_slots[i];
+            if( s.state == slot_in_flight && s.fence != 0 )
+            {
+                // the GPU read the slot, the producer may overwrite it
+                GLenum result = glClientWaitSync( s.fence, 0, 0 );
+                if( result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED )
+                {
+                    glDeleteSync( s.fence );
+                    s.fence = 0;
+                    s.state = slot_free;
+                    freed = true;
+                }
+            }
+            available = available || s.state == slot_free;
+        }
+
+        // nothing to write into, wait for the upload submitted first
+        while( wait && !available )
+        {
+            unsigned int oldest = static_cast<unsigned int>( m_slots.size() );
+            for( unsigned int i=0; i<m_slots.size(); i++ )
+                if( m_slots[i].state == slot_in_flight && ( oldest == m_slots.size() || m_slots[i].frame < m_slots[oldest].frame ) )
+                    oldest = i;
+
+            if( oldest == m_slots.size() )
+                break;
+
+            slot &s = m_slots[oldest];
+            while( glClientWaitSync( s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 ) == GL_TIMEOUT_EXPIRED ) {}
+            glDeleteSync( s.fence );
+            s.fence = 0;
+            s.state = slot_free;
+            available = freed = true;
+        }
+
+        for( unsigned int i=0; i<m_slots.size(); i++ )
+            if( m_slots[i].state == slot_free && m_slots[i].mapped == 0 )
+                map( i );
+    }
+
+    if( freed )
+        m_available.notify_all();
+}
+
+
+template <typename T>
+inline void texture_stream<T>::map( unsigned int index )
+{
+    slot &s = m_slots[index];
+
+    // a free slot is not read by the GPU anymore, no need to synchronize
+    GLbitfield flags = m_persistent ? GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT :
+                                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+
+    if( state::current().direct_state_access() )
+        s.mapped = static_cast<T*>( glMapNamedBufferRange( s.buffer, 0, m_frameSize, flags ) );
+    else
+    {
+        state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, s.buffer );
+        s.mapped = static_cast<T*>( glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, m_frameSize, flags ) );
+        state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+    }
+
+    if( s.mapped == 0 )
+        throw std::runtime_error("nyx::texture_stream::map: unable to map the pixel buffer.");
+}
+
+
+template <typename T>
+inline void texture_stream<T>::unmap( unsigned int index )
+{
+    // persistent mappings stay, the GPU may read them while mapped
+    slot &s = m_slots[index];
+    if( m_persistent || s.mapped == 0 )
+        return;
+
+    if( state::current().direct_state_access() )
+        glUnmapNamedBuffer( s.buffer );
+    else
+    {
+        state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, s.buffer );
+        glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+        state::current().bind_buffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+    }
+    s.mapped = 0;
+}
+
+
+template <typename T>
+inline void texture_stream<T>::release()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    // deleting the buffers also unmaps them
+    for( unsigned int i=0; i<m_slots.size(); i++ )
+    {
+        m_resources->release_sync( m_slots[i].fence );
+        m_resources->release_buffer( m_slots[i].buffer );
+    }
+    m_slots.clear();
+    m_writing = 0;
+    m_texture = 0;
+}
+
+
+} // end namespace nyx
@@ -43,6 +43,16 @@ namespace util
 {
 
 
+/////
+// Half float, the raw bits of an IEEE 754 binary16 value
+///
+
+struct half
+{
+    unsigned short bits;
+};
+
+
 /////
 // Type
 ///
@@ -54,84 +64,102 @@ class type
     ~type(){}
 
 public:
-    // openGL types
-    static inline unsigned int GL();
-    static inline bool is_GL( unsigned int t );
-    static inline bool is_GL_compatible();
+    // openGL types, 0 if T has no GL equivalent
+    static constexpr unsigned int GL();
+    static constexpr bool is_GL( unsigned int t );
+    static constexpr bool is_GL_compatible();
 
     // type checks
-    static inline bool is_signed();
-    static inline bool is_integer();
+    static constexpr bool is_signed();
+    static constexpr bool is_integer();
 
     // type independent values
-    static inline T zero();
-    static inline T one();
+    static constexpr T zero();
+    static constexpr T one();
 };
 
 
-template<> inline unsigned int type<float>::GL(){ return GL_FLOAT; }
-template<> inline unsigned int type<double>::GL(){ return GL_DOUBLE; }
-template<> inline unsigned int type<int>::GL(){ return GL_INT; }
-template<> inline unsigned int type<short>::GL(){ return GL_SHORT; }
-template<> inline unsigned int type<char>::GL(){ return GL_BYTE; }
-template<> inline unsigned int type<unsigned int>::GL(){ return GL_UNSIGNED_INT; }
-template<> inline unsigned int type<unsigned short>::GL(){ return GL_UNSIGNED_SHORT; }
-template<> inline unsigned int type<unsigned char>::GL(){ return GL_UNSIGNED_BYTE; }
+template<typename T> constexpr unsigned int type<T>::GL(){ return 0; }
+template<> constexpr unsigned int type<float>::GL(){ return GL_FLOAT; }
+template<> constexpr unsigned int type<double>::GL(){ return GL_DOUBLE; }
+template<> constexpr unsigned int type<int>::GL(){ return GL_INT; }
+template<> constexpr unsigned int type<short>::GL(){ return GL_SHORT; }
+template<> constexpr unsigned int type<char>::GL(){ return GL_BYTE; }
+template<> constexpr unsigned int type<unsigned int>::GL(){ return GL_UNSIGNED_INT; }
+template<> constexpr unsigned int type<unsigned short>::GL(){ return GL_UNSIGNED_SHORT; }
+template<> constexpr unsigned int type<unsigned char>::GL(){ return GL_UNSIGNED_BYTE; }
+template<> constexpr unsigned int type<half>::GL(){ return GL_HALF_FLOAT; }
+
+template<> constexpr bool type<half>::is_signed(){ return true; }
+template<> constexpr bool type<half>::is_integer(){ return false; }
 
 
 template<typename T>
-inline bool type<T>::is_GL( const unsigned int t )
+constexpr bool type<T>::is_GL( const unsigned int t )
 {
-    switch( t )
-    {
-        case GL_FLOAT : return true;
-        case GL_DOUBLE :  return true;
-        case GL_INT :  return true;
-        case GL_SHORT :  return true;
-        case GL_BYTE :  return true;
-        case GL_UNSIGNED_INT :  return true;
-        case GL_UNSIGNED_SHORT :  return true;
-        case GL_UNSIGNED_BYTE :  return true;
-        default : return false;
-    }
+    return t == GL_FLOAT || t == GL_DOUBLE || t == GL_INT || t == GL_SHORT || t == GL_BYTE ||
+           t == GL_UNSIGNED_INT || t == GL_UNSIGNED_SHORT || t == GL_UNSIGNED_BYTE || t == GL_HALF_FLOAT;
 }
 
 
 template<typename T>
-inline bool type<T>::is_GL_compatible()
+constexpr bool type<T>::is_GL_compatible()
 {
     return type<T>::is_GL( type<T>::GL() );
 }
 
 
 template<typename T>
-inline bool type<T>::is_signed()
+constexpr bool type<T>::is_signed()
 {
     return std::numeric_limits<T>::is_signed;
 }
 
 
 template<typename T>
-inline bool type<T>::is_integer()
+constexpr bool type<T>::is_integer()
 {
     return std::numeric_limits<T>::is_integer;
 }
 
 
 template<typename T>
-inline T type<T>::zero()
+constexpr T type<T>::zero()
 {
     return static_cast<T>(0);
 }
 
 
 template<typename T>
-inline T type<T>::one()
+constexpr T type<T>::one()
 {
-    if( is_integer() )
-        return std::numeric_limits<T>::max();
-    else
-        return static_cast<T>(1);
+    return is_integer() ? std::numeric_limits<T>::max() : static_cast<T>(1);
+}
+
+
+
+/////
+// Size in bytes of a GL data type
+///
+
+inline size_t size_of( unsigned int t )
+{
+    switch( t )
+    {
+        case GL_DOUBLE : return 8;
+        case GL_FLOAT :
+        case GL_INT :
+        case GL_UNSIGNED_INT :
+        case GL_INT_2_10_10_10_REV :
+        case GL_UNSIGNED_INT_2_10_10_10_REV : return 4;
+        case GL_SHORT :
+        case GL_UNSIGNED_SHORT :
+        case GL_HALF_FLOAT : return 2;
+        case GL_BYTE :
+        case GL_UNSIGNED_BYTE : return 1;
+        default :
+            throw std::runtime_error( "nyx::util::size_of: unknown data type." );
+    }
 }
 
 
@@ -172,6 +200,7 @@ inline size_t channels( F format )
         // set 1 channel
         NYX_FORMAT_CHANNELS( GL_COLOR_INDEX,    1 )
         NYX_FORMAT_CHANNELS( GL_RED,            1 )
+        NYX_FORMAT_CHANNELS( GL_RED_INTEGER,    1 )
         NYX_FORMAT_CHANNELS( GL_GREEN,          1 )
         NYX_FORMAT_CHANNELS( GL_BLUE,           1 )
         NYX_FORMAT_CHANNELS_ALL( GL_ALPHA,      1 )
@@ -180,6 +209,8 @@ inline size_t channels( F format )
         NYX_FORMAT_CHANNELS( GL_DEPTH_COMPONENT,1 )
 
         // set 2 channels
+        NYX_FORMAT_CHANNELS( GL_RG,                 2 )
+        NYX_FORMAT_CHANNELS( GL_RG_INTEGER,         2 )
         NYX_FORMAT_CHANNELS( GL_LUMINANCE_ALPHA,    2 )
         NYX_FORMAT_CHANNELS( GL_LUMINANCE4_ALPHA4,  2 )
         NYX_FORMAT_CHANNELS( GL_LUMINANCE8_ALPHA8,  2 )
@@ -189,10 +220,14 @@ inline size_t channels( F format )
         // set 3 channels
         NYX_FORMAT_CHANNELS_ALL( GL_RGB,    3 )
         NYX_FORMAT_CHANNELS( GL_BGR,    3 )
+        NYX_FORMAT_CHANNELS( GL_RGB_INTEGER,    3 )
+        NYX_FORMAT_CHANNELS( GL_BGR_INTEGER,    3 )
 
         // set 4 channels
         NYX_FORMAT_CHANNELS_ALL( GL_RGBA,   4 )
         NYX_FORMAT_CHANNELS( GL_BGRA,   4 )
+        NYX_FORMAT_CHANNELS( GL_RGBA_INTEGER,   4 )
+        NYX_FORMAT_CHANNELS( GL_BGRA_INTEGER,   4 )
 
         // default
         default:
@@ -205,6 +240,152 @@ inline size_t channels( F format )
 #undef NYX_FORMAT_CHANNELS
 
 
+
+/////
+// Sized internal formats
+///
+
+// sized internal format for an unsized one and the GL type of the pixels,
+// sized formats are returned as they are, 0 if there is no sized equivalent.
+// 32 bit integers are normalized by unsized formats, which no sized format
+// does, so they stay unsized. Integer storage has to be asked for with an
+// integer format (GL_RGBA_INTEGER...) and then matches the size of the type.
+inline unsigned int sized_format( unsigned int format, unsigned int type )
+{
+    // columns: 1 to 4 channels
+    static const unsigned int ubyteFormats[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+    static const unsigned int byteFormats[4] = { GL_R8_SNORM, GL_RG8_SNORM, GL_RGB8_SNORM, GL_RGBA8_SNORM };
+    static const unsigned int ushortFormats[4] = { GL_R16, GL_RG16, GL_RGB16, GL_RGBA16 };
+    static const unsigned int shortFormats[4] = { GL_R16_SNORM, GL_RG16_SNORM, GL_RGB16_SNORM, GL_RGBA16_SNORM };
+    static const unsigned int uintFormats[4] = { GL_R32UI, GL_RG32UI, GL_RGB32UI, GL_RGBA32UI };
+    static const unsigned int intFormats[4] = { GL_R32I, GL_RG32I, GL_RGB32I, GL_RGBA32I };
+    static const unsigned int ubyteIntegerFormats[4] = { GL_R8UI, GL_RG8UI, GL_RGB8UI, GL_RGBA8UI };
+    static const unsigned int byteIntegerFormats[4] = { GL_R8I, GL_RG8I, GL_RGB8I, GL_RGBA8I };
+    static const unsigned int ushortIntegerFormats[4] = { GL_R16UI, GL_RG16UI, GL_RGB16UI, GL_RGBA16UI };
+    static const unsigned int shortIntegerFormats[4] = { GL_R16I, GL_RG16I, GL_RGB16I, GL_RGBA16I };
+    static const unsigned int halfFormats[4] = { GL_R16F, GL_RG16F, GL_RGB16F, GL_RGBA16F };
+    static const unsigned int floatFormats[4] = { GL_R32F, GL_RG32F, GL_RGB32F, GL_RGBA32F };
+
+    unsigned int c = 0;
+    bool integer = false;
+    switch( format )
+    {
+        case GL_RED : c = 1; break;
+        case GL_RG : c = 2; break;
+        case GL_RGB : case GL_BGR : c = 3; break;
+        case GL_RGBA : case GL_BGRA : c = 4; break;
+
+        case GL_RED_INTEGER : c = 1; integer = true; break;
+        case GL_RG_INTEGER : c = 2; integer = true; break;
+        case GL_RGB_INTEGER : case GL_BGR_INTEGER : c = 3; integer = true; break;
+        case GL_RGBA_INTEGER : case GL_BGRA_INTEGER : c = 4; integer = true; break;
+
+        case GL_DEPTH_COMPONENT :
+            switch( type )
+            {
+                case GL_UNSIGNED_SHORT : return GL_DEPTH_COMPONENT16;
+                case GL_UNSIGNED_INT : return GL_DEPTH_COMPONENT32;
+                case GL_FLOAT : return GL_DEPTH_COMPONENT32F;
+                default : return GL_DEPTH_COMPONENT24;
+            }
+
+        // legacy formats only exist unsized
+        case GL_COLOR_INDEX :
+        case GL_ALPHA :
+        case GL_LUMINANCE :
+        case GL_LUMINANCE_ALPHA :
+        case GL_INTENSITY :
+        case GL_DEPTH_STENCIL :
+            return 0;
+
+        default :
+            return format;
+    }
+
+    if( integer )
+    {
+        switch( type )
+        {
+            case GL_UNSIGNED_BYTE : return ubyteIntegerFormats[c-1];
+            case GL_BYTE : return byteIntegerFormats[c-1];
+            case GL_UNSIGNED_SHORT : return ushortIntegerFormats[c-1];
+            case GL_SHORT : return shortIntegerFormats[c-1];
+            case GL_UNSIGNED_INT : return uintFormats[c-1];
+            case GL_INT : return intFormats[c-1];
+            default : return 0;
+        }
+    }
+
+    switch( type )
+    {
+        case GL_UNSIGNED_BYTE : return ubyteFormats[c-1];
+        case GL_BYTE : return byteFormats[c-1];
+        case GL_UNSIGNED_SHORT : return ushortFormats[c-1];
+        case GL_SHORT : return shortFormats[c-1];
+        case GL_HALF_FLOAT : return halfFormats[c-1];
+        case GL_FLOAT : return floatFormats[c-1];
+        default : return 0;
+    }
+}
+
+
+// integer textures can't be filtered, they are sampled with GL_NEAREST
+inline bool is_integer_format( unsigned int format )
+{
+    switch( format )
+    {
+        case GL_R8UI : case GL_RG8UI : case GL_RGB8UI : case GL_RGBA8UI :
+        case GL_R8I : case GL_RG8I : case GL_RGB8I : case GL_RGBA8I :
+        case GL_R16UI : case GL_RG16UI : case GL_RGB16UI : case GL_RGBA16UI :
+        case GL_R16I : case GL_RG16I : case GL_RGB16I : case GL_RGBA16I :
+        case GL_R32UI : case GL_RG32UI : case GL_RGB32UI : case GL_RGBA32UI :
+        case GL_R32I : case GL_RG32I : case GL_RGB32I : case GL_RGBA32I :
+        case GL_RGB10_A2UI :
+            return true;
+        default :
+            return false;
+    }
+}
+
+
+// glGenerateMipmap needs a format that is color renderable and filterable,
+// this leaves out integer, depth, snorm and the 16/32 bit RGB formats
+inline bool can_generate_mipmaps( unsigned int format )
+{
+    if( is_integer_format( format ) )
+        return false;
+
+    switch( format )
+    {
+        case GL_DEPTH_COMPONENT : case GL_DEPTH_COMPONENT16 : case GL_DEPTH_COMPONENT24 :
+        case GL_DEPTH_COMPONENT32 : case GL_DEPTH_COMPONENT32F :
+        case GL_DEPTH_STENCIL : case GL_DEPTH24_STENCIL8 : case GL_DEPTH32F_STENCIL8 :
+        case GL_R8_SNORM : case GL_RG8_SNORM : case GL_RGB8_SNORM : case GL_RGBA8_SNORM :
+        case GL_R16_SNORM : case GL_RG16_SNORM : case GL_RGB16_SNORM : case GL_RGBA16_SNORM :
+        case GL_RGB16 : case GL_RGB16F : case GL_RGB32F :
+            return false;
+        default :
+            return true;
+    }
+}
+
+
+// external format of integer textures (GL_R32UI...), which are not normalized
+inline unsigned int integer_format( unsigned int format )
+{
+    switch( format )
+    {
+        case GL_RED : return GL_RED_INTEGER;
+        case GL_RG : return GL_RG_INTEGER;
+        case GL_RGB : return GL_RGB_INTEGER;
+        case GL_BGR : return GL_BGR_INTEGER;
+        case GL_RGBA : return GL_RGBA_INTEGER;
+        case GL_BGRA : return GL_BGRA_INTEGER;
+        default : return format;
+    }
+}
+
+
 //class Context
 //{
 //public:
@@ -36,25 +36,30 @@ namespace nyx
 
 
 template <typename T>
-class vertex_array_buffer : public array_buffer<T>
+class vertex_array_buffer : public array_buffer<T, vertex_array_buffer<T> >
 {
+    typedef array_buffer<T, vertex_array_buffer<T> > base;
+    friend class buffer<T, vertex_array_buffer<T> >;
+
+    static_assert( util::type<T>::is_signed(), "nyx::vertex_array_buffer: vertex buffer does not support unsigned data types." );
+
 public:
     vertex_array_buffer();
 
-    virtual void set_components( unsigned int components );
+    void set_components( unsigned int components );
+
+    void bind() const;
 
-    virtual void bind() const;
+protected:
+    bool is_encoding_supported( unsigned int encoding ) const;
 };
 
 
 template <typename T>
-inline vertex_array_buffer<T>::vertex_array_buffer() : array_buffer<T>::array_buffer()
+inline vertex_array_buffer<T>::vertex_array_buffer() : base()
 {
     vertex_array_buffer<T>::m_state = GL_VERTEX_ARRAY;
-
-    // check if the type is compatible
-    if( !util::type<T>::is_signed() )
-        throw std::runtime_error("nyx::vertex_array_buffer::vertex_array_buffer: vertex buffer does not support unsigned data types.");
+    vertex_array_buffer<T>::m_location = 0;
 }
 
 template <typename T>
@@ -68,11 +73,22 @@ inline void vertex_array_buffer<T>::set_components( unsigned int components )
 }
 
 
+template <typename T>
+inline bool vertex_array_buffer<T>::is_encoding_supported( unsigned int encoding ) const
+{
+    // glVertexPointer has no normalized types
+    return encoding == encode_none || encoding == encode_half;
+}
+
+
 template <typename T>
 inline void vertex_array_buffer<T>::bind() const
 {
-    buffer<T>::bind();
-    glVertexPointer( vertex_array_buffer<T>::m_size, util::type<T>::GL(), 0, 0 );
+    base::bind();
+    if( state::current().generic_attributes() )
+        base::attribute_pointer( false );
+    else
+        glVertexPointer( base::gl_components(), base::gl_type(), 0, reinterpret_cast<const GLvoid*>(base::offset()) );
 }
 
 
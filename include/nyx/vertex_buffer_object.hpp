@@ -21,14 +21,23 @@
 
 #pragma once
 
-#include <nyx/exception.hpp>
+#include <algorithm>
+#include <vector>
+
 #include <nyx/util.hpp>
+#include <nyx/state.hpp>
+#include <nyx/resources.hpp>
+#include <nyx/buffer_arena.hpp>
 
 #include <nyx/vertex_array_buffer.hpp>
 #include <nyx/normal_array_buffer.hpp>
 #include <nyx/color_array_buffer.hpp>
 #include <nyx/texcoord_array_buffer.hpp>
 #include <nyx/element_buffer.hpp>
+#include <nyx/instance_buffer.hpp>
+#include <nyx/mesh_clusters.hpp>
+#include <nyx/mesh_optimizer.hpp>
+#include <nyx/mesh_simplifier.hpp>
 
 namespace nyx
 {
@@ -46,23 +55,69 @@ namespace nyx
  *              (GL_STREAM_DRAW, GL_STREAM_READ, GL_STREAM_COPY)
  *              (GL_STATIC_DRAW, GL_STATIC_READ, GL_STATIC_COPY)
  *              (GL_DYNAMIC_DRAW, GL_DYNAMIC_READ, GL_DYNAMIC_COPY)
+ *
+ *      If vertex array objects are available (GL 3.0 / ARB_vertex_array_object) the
+ *      buffer bindings are recorded once in a VAO on the first draw and only recorded
+ *      again when the layout (buffer names, offsets or sizes) changes. After a draw
+ *      the VAO is only released, see state.hpp.
+ *
+ *      Configured with a buffer_arena the object owns no buffers, its vertices and
+ *      elements are ranges of the arena's shared buffers and it is drawn with a base
+ *      vertex. The arena has to outlive the object. In this mode only the update
+ *      functions taking data upload anything, there is no client buffer to re-read.
+ *
+ *      set_encoding (between configure and init) stores attributes in a compact
+ *      format, e.g. half float positions and 2_10_10_10 normals, see quantize.hpp.
+ *
+ *      With GL_TRIANGLE_STRIP, initStrips uploads a triangle list as primitive restart
+ *      separated strips, sizes of strip and fan primitives are in indices.
+ *
+ *      set_clustering (before initElements, GL_TRIANGLES only) splits the elements into
+ *      clusters of about "trianglesPerCluster" triangles, see mesh_clusters.hpp. The
+ *      elements are reordered into a copy kept by the object and the clusters are bounded
+ *      with the vertices of the last initVertices, which have to be valid at that point.
+ *      Call initElements again after moving the vertices. draw_culled then submits only
+ *      the clusters inside the frustum and, given the eye, facing it with a single
+ *      glMultiDrawElements.
+ *
+ *      set_lod (before initElements, GL_TRIANGLES only) builds a chain of up to "levels"
+ *      simplified element lists, each with about "ratio" times the triangles of the one
+ *      before (see mesh_simplifier.hpp). All levels share the vertices and are stored
+ *      one after the other in the element buffer, level 0 is the original. select_lod
+ *      picks the coarsest level whose error, projected at "distance", stays within
+ *      "threshold" pixels. "projection" is the number of pixels a unit covers at
+ *      distance 1, i.e. viewport height / (2 tan(fovy/2)). Clusters only cover level 0.
+ *
+ *      draw_instanced draws the mesh "instances" times in a single call. Per instance
+ *      data comes from the instance streams added with add_instances (see
+ *      instance_buffer.hpp), which are read through generic attributes by the
+ *      vertex shader. The streams have to outlive the object or be cleared.
  */
 
 
+template <typename Ta, typename Te> class draw_batch;
+
+
 template <typename Ta=float, typename Te=unsigned int>
 class vertex_buffer_object {
+    friend class draw_batch<Ta, Te>;
+
 public:
     vertex_buffer_object();
     virtual ~vertex_buffer_object();
 
     void configure( unsigned int vertexSize, unsigned int colorSize, unsigned int texCoordSize, unsigned int primitiveType, unsigned int usage=GL_STATIC_DRAW );
     void configure( unsigned int primitiveType, unsigned int usage=GL_STATIC_DRAW );
+    void configure( buffer_arena<Ta, Te> &arena, unsigned int primitiveType );
+
+    void set_encoding( unsigned int vertexEncoding, unsigned int normalEncoding, unsigned int colorEncoding, unsigned int texCoordEncoding );
 
     void initVertices( const Ta *vertices, unsigned int count );
     void initNormals( const Ta *vertices);
     void initColors( const Ta *vertices);
     void initTexCoords( const Ta *vertices);
     void initElements( const Te *elements, unsigned int count );
+    void initStrips( const Te *triangles, unsigned int count );
 
     void updateVertices( const Ta *vertices );
     void updateVertices();
@@ -85,6 +140,30 @@ public:
     void draw_vertices( unsigned int offset, unsigned int size ) const;
     void draw_elements( unsigned int offset, unsigned int size ) const;
 
+    void add_instances( const instance_stream &stream );
+    void clear_instances();
+    void draw_instanced( unsigned int instances ) const;
+
+    void set_clustering( unsigned int trianglesPerCluster );
+    unsigned int draw_culled( const float *viewProjection, const float *eye=0 ) const;
+
+    void set_lod( unsigned int levels, float ratio=0.5f );
+    unsigned int lod_levels() const;
+    float lod_error( unsigned int level ) const;
+    unsigned int select_lod( float distance, float projection, float threshold=1.0f ) const;
+    void draw_lod( unsigned int level ) const;
+
+protected:
+    void bind() const;
+    void unbind() const;
+    void bind_buffers() const;
+    void release_ranges();
+    void bind_instances() const;
+    void unbind_instances() const;
+    void init_clusters( const Te *elements, unsigned int count );
+    void init_lods( const Te *elements, unsigned int count );
+    unsigned int primitive_count() const;
+
 protected:
     // array buffers GL_VERTEX_ARRAY, GL_NORMAL_ARRAY, GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY
     vertex_array_buffer<Ta> m_vertices;
@@ -94,18 +173,65 @@ protected:
 
     // element buffer
     element_buffer<Te> m_elements;
+
+    // vertex array object and the layout it was recorded with
+    mutable unsigned int m_vao;
+    mutable std::size_t m_layout[15];
+    mutable resources *m_resources;
+
+    // arena and the ranges allocated in it
+    buffer_arena<Ta, Te> *m_arena;
+    unsigned int m_vertexRange;
+    unsigned int m_elementRange;
+
+    // per instance attribute streams
+    std::vector<const instance_stream*> m_instanceStreams;
+
+    // clusters, the reordered elements and the positions they were built from
+    unsigned int m_clusterSize;
+    mesh_clusters m_clusters;
+    std::vector<Te> m_clustered;
+    const Ta *m_positions;
+
+    // levels of detail, as ranges of primitives of the elements
+    unsigned int m_lodLevels;
+    float m_lodRatio;
+    std::vector<Te> m_lods;
+    std::vector<unsigned int> m_lodFirst;
+    std::vector<unsigned int> m_lodCount;
+    std::vector<float> m_lodError;
+
+    // visible ranges and their multi draw arguments, kept to avoid allocations per frame
+    mutable std::vector< std::pair<unsigned int, unsigned int> > m_ranges;
+    mutable std::vector<GLsizei> m_drawCounts;
+    mutable std::vector<const GLvoid*> m_drawOffsets;
+    mutable std::vector<GLint> m_drawBases;
 };
 
 
 template <typename Ta, typename Te>
-inline vertex_buffer_object<Ta, Te>::vertex_buffer_object()
+inline vertex_buffer_object<Ta, Te>::vertex_buffer_object() :
+    m_vao(0),
+    m_resources(0),
+    m_arena(0),
+    m_vertexRange(buffer_arena<Ta, Te>::none),
+    m_elementRange(buffer_arena<Ta, Te>::none),
+    m_clusterSize(0),
+    m_positions(0),
+    m_lodLevels(0),
+    m_lodRatio(0.5f)
 {
+    std::fill( m_layout, m_layout+15, 0 );
 }
 
 
 template <typename Ta, typename Te>
 inline vertex_buffer_object<Ta, Te>::~vertex_buffer_object()
 {
+    release_ranges();
+
+    if( m_resources != 0 )
+        m_resources->release_vertex_array( m_vao );
 }
 
 
@@ -128,17 +254,58 @@ inline void vertex_buffer_object<Ta, Te>::configure( unsigned int primitiveType,
 }
 
 
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::configure( buffer_arena<Ta, Te> &arena, unsigned int primitiveType )
+{
+    release_ranges();
+    m_arena = &arena;
+
+    // only used for the primitive type
+    m_elements.configure(primitiveType);
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::set_encoding( unsigned int vertexEncoding, unsigned int normalEncoding, unsigned int colorEncoding, unsigned int texCoordEncoding )
+{
+    // the arena owns the buffers
+    if( m_arena != 0 )
+        throw std::runtime_error( "vertex_buffer_object::set_encoding: set the encoding on the arena." );
+
+    m_vertices.set_encoding(vertexEncoding);
+    m_normals.set_encoding(normalEncoding);
+    m_colors.set_encoding(colorEncoding);
+    m_texCoords.set_encoding(texCoordEncoding);
+}
+
+
 template <typename Ta, typename Te>
 inline void vertex_buffer_object<Ta, Te>::initVertices( const Ta *vertices, unsigned int count )
 {
-    m_vertices.init(vertices, count);
+    m_positions = vertices;
+
+    if( m_arena != 0 )
+    {
+        if( m_vertexRange != buffer_arena<Ta, Te>::none )
+            m_arena->free_vertices( m_vertexRange );
+        m_vertexRange = m_arena->allocate_vertices( count );
+        if( m_vertexRange != buffer_arena<Ta, Te>::none )
+            m_arena->update_vertices( m_vertexRange, vertices );
+    }
+    else
+        m_vertices.init(vertices, count);
 }
 
 
 template <typename Ta, typename Te>
 inline void vertex_buffer_object<Ta, Te>::initNormals( const Ta *normals)
 {
-    if( m_vertices.count() > 0 )
+    if( m_arena != 0 )
+    {
+        if( m_vertexRange != buffer_arena<Ta, Te>::none )
+            m_arena->update_normals( m_vertexRange, normals );
+    }
+    else if( m_vertices.count() > 0 )
         m_normals.init(normals, m_vertices.count());
 }
 
@@ -146,7 +313,12 @@ inline void vertex_buffer_object<Ta, Te>::initNormals( const Ta *normals)
 template <typename Ta, typename Te>
 inline void vertex_buffer_object<Ta, Te>::initColors( const Ta *colors)
 {
-    if( m_vertices.count() > 0 )
+    if( m_arena != 0 )
+    {
+        if( m_vertexRange != buffer_arena<Ta, Te>::none )
+            m_arena->update_colors( m_vertexRange, colors );
+    }
+    else if( m_vertices.count() > 0 )
         m_colors.init(colors, m_vertices.count());
 }
 
@@ -154,7 +326,12 @@ inline void vertex_buffer_object<Ta, Te>::initColors( const Ta *colors)
 template <typename Ta, typename Te>
 inline void vertex_buffer_object<Ta, Te>::initTexCoords( const Ta *texCoords)
 {
-    if( m_vertices.count() > 0 )
+    if( m_arena != 0 )
+    {
+        if( m_vertexRange != buffer_arena<Ta, Te>::none )
+            m_arena->update_texcoords( m_vertexRange, texCoords );
+    }
+    else if( m_vertices.count() > 0 )
         m_texCoords.init(texCoords, m_vertices.count());
 }
 
@@ -162,34 +339,128 @@ inline void vertex_buffer_object<Ta, Te>::initTexCoords( const Ta *texCoords)
 template <typename Ta, typename Te>
 inline void vertex_buffer_object<Ta, Te>::initElements( const Te *elements, unsigned int count )
 {
-    m_elements.init(elements, count);
+    // upload the clustered copy and the levels of detail instead
+    const Te *clustered = m_clustered.empty() ? 0 : &m_clustered[0], *lods = m_lods.empty() ? 0 : &m_lods[0];
+    if( m_clusterSize > 0 && elements != 0 && elements != clustered && elements != lods )
+    {
+        init_clusters( elements, count );
+        return;
+    }
+    if( m_lodLevels > 1 && elements != 0 && elements != lods )
+    {
+        init_lods( elements, count );
+        return;
+    }
+
+    // plain elements replace what was derived from earlier ones
+    if( elements != lods )
+    {
+        m_lodFirst.clear();
+        m_lodCount.clear();
+        m_lodError.clear();
+        if( elements != clustered )
+            m_clusters.clear();
+    }
+
+    if( m_arena != 0 )
+    {
+        if( m_elementRange != buffer_arena<Ta, Te>::none )
+            m_arena->free_elements( m_elementRange );
+        m_elementRange = m_arena->allocate_elements( count*m_elements.size() );
+        if( m_elementRange != buffer_arena<Ta, Te>::none )
+            m_arena->update_elements( m_elementRange, elements );
+    }
+    else
+        m_elements.init(elements, count);
 }
 
 
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateVertices( const Ta *vertices){ m_vertices.update(vertices); }
+inline void vertex_buffer_object<Ta, Te>::initStrips( const Te *triangles, unsigned int count )
+{
+    if( m_arena == 0 )
+    {
+        m_elements.init_strips( triangles, count );
+        return;
+    }
+
+    if( m_elements.get_primitive_type() != GL_TRIANGLE_STRIP )
+        throw std::runtime_error( "vertex_buffer_object::initStrips: the object has to be configured for GL_TRIANGLE_STRIP." );
+
+    // the arena keeps no client buffer, the strips are only needed for the upload
+    std::vector<Te> list( triangles, triangles + static_cast<std::size_t>(count)*3 ), strips;
+    util::stripify( list, strips );
+    initElements( strips.empty() ? 0 : &strips[0], static_cast<unsigned int>( strips.size() ) );
+}
+
+
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateVertices(){ m_vertices.update(); }
+inline void vertex_buffer_object<Ta, Te>::updateVertices( const Ta *vertices)
+{
+    if( m_arena != 0 )
+        m_arena->update_vertices( m_vertexRange, vertices );
+    else
+        m_vertices.update(vertices);
+}
 
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateNormals( const Ta *normals){ m_normals.update(normals); }
+inline void vertex_buffer_object<Ta, Te>::updateVertices(){ if( m_arena == 0 ) m_vertices.update(); }
+
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateNormals(){ m_normals.update(); }
+inline void vertex_buffer_object<Ta, Te>::updateNormals( const Ta *normals)
+{
+    if( m_arena != 0 )
+        m_arena->update_normals( m_vertexRange, normals );
+    else
+        m_normals.update(normals);
+}
 
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateColors( const Ta *colors){ m_colors.update(colors); }
+inline void vertex_buffer_object<Ta, Te>::updateNormals(){ if( m_arena == 0 ) m_normals.update(); }
+
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateColors(){ m_colors.update(); }
+inline void vertex_buffer_object<Ta, Te>::updateColors( const Ta *colors)
+{
+    if( m_arena != 0 )
+        m_arena->update_colors( m_vertexRange, colors );
+    else
+        m_colors.update(colors);
+}
 
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateTexCoords( const Ta *texCoords){ m_texCoords.update(texCoords); }
+inline void vertex_buffer_object<Ta, Te>::updateColors(){ if( m_arena == 0 ) m_colors.update(); }
+
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateTexCoords(){ m_texCoords.update(); }
+inline void vertex_buffer_object<Ta, Te>::updateTexCoords( const Ta *texCoords)
+{
+    if( m_arena != 0 )
+        m_arena->update_texcoords( m_vertexRange, texCoords );
+    else
+        m_texCoords.update(texCoords);
+}
 
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateElements( const Te *elements){ m_elements.update(elements); }
+inline void vertex_buffer_object<Ta, Te>::updateTexCoords(){ if( m_arena == 0 ) m_texCoords.update(); }
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::updateElements( const Te *elements)
+{
+    // clusters and levels of detail have to be built again
+    const Te *clustered = m_clustered.empty() ? 0 : &m_clustered[0], *lods = m_lods.empty() ? 0 : &m_lods[0];
+    if( (m_clusterSize > 0 || m_lodLevels > 1) && elements != 0 && elements != clustered && elements != lods )
+    {
+        initElements( elements, primitive_count() );
+        return;
+    }
+
+    if( m_arena != 0 )
+        m_arena->update_elements( m_elementRange, elements );
+    else
+        m_elements.update(elements);
+}
+
 template <typename Ta, typename Te>
-inline void vertex_buffer_object<Ta, Te>::updateElements(){ m_elements.update(); }
+inline void vertex_buffer_object<Ta, Te>::updateElements(){ if( m_arena == 0 ) m_elements.update(); }
 
 template <typename Ta, typename Te>
 inline void vertex_buffer_object<Ta, Te>::update()
@@ -205,8 +476,15 @@ inline void vertex_buffer_object<Ta, Te>::update()
 template <typename Ta, typename Te>
 inline void vertex_buffer_object<Ta, Te>::draw() const
 {
-    if( m_elements.is_valid() )
-        draw_elements( 0, m_elements.count() );
+    if( m_arena != 0 )
+    {
+        if( m_elementRange != buffer_arena<Ta, Te>::none )
+            draw_elements( 0, primitive_count() );
+        else if( m_vertexRange != buffer_arena<Ta, Te>::none )
+            draw_vertices( 0, m_arena->vertex_count( m_vertexRange ) );
+    }
+    else if( m_elements.is_valid() )
+        draw_elements( 0, primitive_count() );
     else
         draw_vertices( 0, m_vertices.count() );
 }
@@ -215,48 +493,290 @@ inline void vertex_buffer_object<Ta, Te>::draw() const
 template <typename Ta, typename Te>
 inline void vertex_buffer_object<Ta, Te>::draw_vertices( unsigned int offset, unsigned int size ) const
 {
-    // vertices
-    if( m_vertices.is_valid() ) m_vertices.bind();
-    else throw std::runtime_error( "vertex_buffer_object::draw_vertices: no vertices." );
+    if( m_arena != 0 )
+    {
+        if( m_vertexRange == buffer_arena<Ta, Te>::none ) throw std::runtime_error( "vertex_buffer_object::draw_vertices: no vertices." );
 
-    if( m_normals.is_valid() ) m_normals.bind();     // normals
-    if( m_colors.is_valid() ) m_colors.bind();       // colors
-    if( m_texCoords.is_valid() ) m_texCoords.bind(); // texture coordinates
+        m_arena->bind();
+        glDrawArrays( m_elements.get_primitive_type(), m_arena->vertex_offset( m_vertexRange ) + offset, size );
+        m_arena->unbind();
+        return;
+    }
 
-    // elements
+    // check the buffers
+    if( !m_vertices.is_valid() ) throw std::runtime_error( "vertex_buffer_object::draw_vertices: no vertices." );
     if( m_elements.is_valid() ) throw std::runtime_error( "vertex_buffer_object::draw_vertices: elements are aleady defined, use \"draw_elements\" instead." );
-    else glDrawArrays( m_elements.get_primitive_type(), offset, size);
 
-    // unbind
-    m_vertices.unbind();
-    m_normals.unbind();
-    m_colors.unbind();
-    m_texCoords.unbind();
-    m_elements.unbind();
+    bind();
+    glDrawArrays( m_elements.get_primitive_type(), offset, size);
+    unbind();
 }
 
 
 template <typename Ta, typename Te>
 inline void vertex_buffer_object<Ta, Te>::draw_elements( unsigned int offset, unsigned int size ) const
 {
-    // vertices
-    if( m_vertices.is_valid() ) m_vertices.bind();
-    else throw std::runtime_error( "vertex_buffer_object::draw_elements: no vertices." );
+    if( m_arena != 0 )
+    {
+        if( m_vertexRange == buffer_arena<Ta, Te>::none ) throw std::runtime_error( "vertex_buffer_object::draw_elements: no vertices." );
+        if( m_elementRange == buffer_arena<Ta, Te>::none ) throw std::runtime_error( "vertex_buffer_object::draw_elements: there are no elements." );
+
+        // offset and size are in primitives, the indices are relative to the vertex range
+        std::size_t first = m_arena->element_offset( m_elementRange ) + offset*m_elements.size();
+        m_arena->bind();
+        m_elements.apply_restart();
+        glDrawElementsBaseVertex( m_elements.get_primitive_type(), size*m_elements.size(), util::type<Te>::GL(),
+                                  reinterpret_cast<const GLvoid*>( first*sizeof(Te) ), m_arena->vertex_offset( m_vertexRange ) );
+        m_arena->unbind();
+        return;
+    }
+
+    // check the buffers
+    if( !m_vertices.is_valid() ) throw std::runtime_error( "vertex_buffer_object::draw_elements: no vertices." );
+    if( !m_elements.is_valid() ) throw std::runtime_error( "vertex_buffer_object::draw_elements: there are no elements." );
 
-    if( m_normals.is_valid() ) m_normals.bind();     // normals
-    if( m_colors.is_valid() ) m_colors.bind();       // colors
-    if( m_texCoords.is_valid() ) m_texCoords.bind(); // texture coordinates
+    // offset and size are in primitives
+    std::size_t first = m_elements.offset() + offset*m_elements.size()*m_elements.index_size();
+
+    bind();
+    m_elements.apply_restart();
+    glDrawElements( m_elements.get_primitive_type(), size*m_elements.size(), m_elements.get_index_type(), reinterpret_cast<const GLvoid*>(first) );
+    unbind();
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::add_instances( const instance_stream &stream )
+{
+    if( std::find( m_instanceStreams.begin(), m_instanceStreams.end(), &stream ) == m_instanceStreams.end() )
+        m_instanceStreams.push_back( &stream );
+}
 
-    // elements
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::clear_instances()
+{
+    m_instanceStreams.clear();
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::draw_instanced( unsigned int instances ) const
+{
+    if( !(GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays) )
+        throw std::runtime_error( "vertex_buffer_object::draw_instanced: instanced arrays are not supported." );
+    if( instances == 0 )
+        return;
+
+    if( m_arena != 0 )
+    {
+        if( m_vertexRange == buffer_arena<Ta, Te>::none ) throw std::runtime_error( "vertex_buffer_object::draw_instanced: no vertices." );
+
+        m_arena->bind();
+        bind_instances();
+        if( m_elementRange != buffer_arena<Ta, Te>::none )
+        {
+            std::size_t first = m_arena->element_offset( m_elementRange );
+            m_elements.apply_restart();
+            glDrawElementsInstancedBaseVertex( m_elements.get_primitive_type(), primitive_count()*m_elements.size(), util::type<Te>::GL(),
+                                               reinterpret_cast<const GLvoid*>( first*sizeof(Te) ), instances, m_arena->vertex_offset( m_vertexRange ) );
+        }
+        else
+            glDrawArraysInstanced( m_elements.get_primitive_type(), m_arena->vertex_offset( m_vertexRange ), m_arena->vertex_count( m_vertexRange ), instances );
+        unbind_instances();
+        m_arena->unbind();
+        return;
+    }
+
+    // check the buffers
+    if( !m_vertices.is_valid() ) throw std::runtime_error( "vertex_buffer_object::draw_instanced: no vertices." );
+
+    bind();
+    bind_instances();
     if( m_elements.is_valid() )
     {
-        m_elements.bind();
-        glDrawElements( m_elements.get_primitive_type(), m_elements.count()*m_elements.size(), util::type<Te>::GL(), 0 ); // TODO: there is still an issue here with the offset
+        m_elements.apply_restart();
+        glDrawElementsInstanced( m_elements.get_primitive_type(), primitive_count()*m_elements.size(), m_elements.get_index_type(),
+                                 reinterpret_cast<const GLvoid*>( m_elements.offset() ), instances );
     }
     else
-        throw std::runtime_error( "vertex_buffer_object::draw_elements: there are no elements." );
+        glDrawArraysInstanced( m_elements.get_primitive_type(), 0, m_vertices.count(), instances );
+    unbind_instances();
+    unbind();
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::set_clustering( unsigned int trianglesPerCluster )
+{
+    if( trianglesPerCluster > 0 && m_elements.get_primitive_type() != GL_TRIANGLES )
+        throw std::runtime_error( "vertex_buffer_object::set_clustering: clusters need GL_TRIANGLES." );
+
+    m_clusterSize = trianglesPerCluster;
+    if( m_clusterSize == 0 )
+        m_clusters.clear();
+}
+
+
+template <typename Ta, typename Te>
+inline unsigned int vertex_buffer_object<Ta, Te>::draw_culled( const float *viewProjection, const float *eye ) const
+{
+    if( m_clusters.size() == 0 )
+    {
+        draw();
+        return 0;
+    }
+
+    m_clusters.cull( viewProjection, eye, m_ranges );
+    if( m_ranges.empty() )
+        return 0;
+
+    // ranges are in triangles
+    std::size_t count = m_ranges.size();
+    m_drawCounts.resize( count );
+    m_drawOffsets.resize( count );
+    unsigned int triangles = 0;
+
+    if( m_arena != 0 )
+    {
+        std::size_t first = m_arena->element_offset( m_elementRange );
+        m_drawBases.assign( count, static_cast<GLint>( m_arena->vertex_offset( m_vertexRange ) ) );
+        for( std::size_t i=0; i<count; i++ )
+        {
+            m_drawCounts[i] = static_cast<GLsizei>( m_ranges[i].second*3 );
+            m_drawOffsets[i] = reinterpret_cast<const GLvoid*>( (first + m_ranges[i].first*3)*sizeof(Te) );
+            triangles += m_ranges[i].second;
+        }
+
+        m_arena->bind();
+        m_elements.apply_restart();
+        glMultiDrawElementsBaseVertex( GL_TRIANGLES, &m_drawCounts[0], util::type<Te>::GL(), &m_drawOffsets[0], static_cast<GLsizei>(count), &m_drawBases[0] );
+        m_arena->unbind();
+        return triangles;
+    }
+
+    for( std::size_t i=0; i<count; i++ )
+    {
+        m_drawCounts[i] = static_cast<GLsizei>( m_ranges[i].second*3 );
+        m_drawOffsets[i] = reinterpret_cast<const GLvoid*>( m_elements.offset() + m_ranges[i].first*3*m_elements.index_size() );
+        triangles += m_ranges[i].second;
+    }
+
+    bind();
+    m_elements.apply_restart();
+    glMultiDrawElements( GL_TRIANGLES, &m_drawCounts[0], m_elements.get_index_type(), &m_drawOffsets[0], static_cast<GLsizei>(count) );
+    unbind();
+    return triangles;
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::set_lod( unsigned int levels, float ratio )
+{
+    if( levels > 1 && m_elements.get_primitive_type() != GL_TRIANGLES )
+        throw std::runtime_error( "vertex_buffer_object::set_lod: levels of detail need GL_TRIANGLES." );
+    if( ratio <= 0.0f || ratio >= 1.0f )
+        throw std::runtime_error( "vertex_buffer_object::set_lod: the ratio has to be between 0 and 1." );
+
+    m_lodLevels = levels;
+    m_lodRatio = ratio;
+}
+
+
+template <typename Ta, typename Te>
+inline unsigned int vertex_buffer_object<Ta, Te>::lod_levels() const
+{
+    return std::max<unsigned int>( static_cast<unsigned int>( m_lodError.size() ), 1 );
+}
+
+
+template <typename Ta, typename Te>
+inline float vertex_buffer_object<Ta, Te>::lod_error( unsigned int level ) const
+{
+    return level < m_lodError.size() ? m_lodError[level] : 0.0f;
+}
+
+
+template <typename Ta, typename Te>
+inline unsigned int vertex_buffer_object<Ta, Te>::select_lod( float distance, float projection, float threshold ) const
+{
+    // the errors grow with the level, take the coarsest one that is still good enough
+    for( std::size_t level=m_lodError.size(); level-- > 1; )
+        if( m_lodError[level]*projection <= threshold*distance )
+            return static_cast<unsigned int>( level );
+
+    return 0;
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::draw_lod( unsigned int level ) const
+{
+    if( m_lodFirst.empty() )
+    {
+        draw();
+        return;
+    }
+
+    level = std::min( level, static_cast<unsigned int>( m_lodFirst.size() )-1 );
+    draw_elements( m_lodFirst[level], m_lodCount[level] );
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::bind() const
+{
+    // upload pending changes, this binds the element buffer so it can't happen while the VAO is bound
+    m_vertices.flush();
+    m_normals.flush();
+    m_colors.flush();
+    m_texCoords.flush();
+    m_elements.flush();
+
+    // without VAOs bind everything on every draw
+    if( !(GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object) )
+    {
+        bind_buffers();
+        return;
+    }
+
+    // the layout the VAO has to reflect
+    std::size_t layout[15] = { m_vertices.id(),  m_vertices.offset(),  m_vertices.size(),
+                               m_normals.id(),   m_normals.offset(),   m_normals.size(),
+                               m_colors.id(),    m_colors.offset(),    m_colors.size(),
+                               m_texCoords.id(), m_texCoords.offset(), m_texCoords.size(),
+                               m_elements.id(),  m_elements.offset(),  m_elements.size() };
+
+    if( m_vao != 0 && std::equal( layout, layout+15, m_layout ) )
+    {
+        state::current().bind_vertex_array( m_vao );
+        return;
+    }
+
+    // (re)record the bindings
+    if( m_vao == 0 )
+    {
+        m_resources = &resources::current();
+        m_vao = m_resources->create_vertex_array();
+    }
+
+    state::current().bind_vertex_array( m_vao );
+    bind_buffers();
+    state::current().bind_buffer( GL_ARRAY_BUFFER, 0 );
+    std::copy( layout, layout+15, m_layout );
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::unbind() const
+{
+    // leave the VAO bound until something else needs the vertex array state
+    if( m_vao != 0 )
+    {
+        state::current().release_vertex_array();
+        return;
+    }
 
-    // unbind
     m_vertices.unbind();
     m_normals.unbind();
     m_colors.unbind();
@@ -265,4 +785,112 @@ inline void vertex_buffer_object<Ta, Te>::draw_elements( unsigned int offset, un
 }
 
 
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::bind_buffers() const
+{
+    // invalid buffers are unbound, so a re-recorded VAO does not keep stale arrays
+    m_vertices.bind();
+    if( m_normals.is_valid() ) m_normals.bind(); else m_normals.unbind();          // normals
+    if( m_colors.is_valid() ) m_colors.bind(); else m_colors.unbind();             // colors
+    if( m_texCoords.is_valid() ) m_texCoords.bind(); else m_texCoords.unbind();    // texture coordinates
+    if( m_elements.is_valid() ) m_elements.bind(); else m_elements.unbind();       // elements
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::bind_instances() const
+{
+    // recorded into the bound VAO and taken out again by unbind_instances
+    for( size_t i=0; i<m_instanceStreams.size(); i++ )
+        m_instanceStreams[i]->bind_instances();
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::unbind_instances() const
+{
+    for( size_t i=0; i<m_instanceStreams.size(); i++ )
+        m_instanceStreams[i]->unbind_instances();
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::init_clusters( const Te *elements, unsigned int count )
+{
+    unsigned int components = m_arena != 0 ? m_arena->vertex_size() : m_vertices.size();
+    if( m_positions == 0 )
+        throw std::runtime_error( "vertex_buffer_object::initElements: clustering needs the vertices first." );
+
+    m_clustered.assign( elements, elements + static_cast<std::size_t>(count)*3 );
+    m_clusters.build( m_clustered, m_positions, components, m_clusterSize );
+    initElements( m_clustered.empty() ? 0 : &m_clustered[0], count );
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::init_lods( const Te *elements, unsigned int count )
+{
+    unsigned int components = m_arena != 0 ? m_arena->vertex_size() : m_vertices.size();
+    unsigned int vertexCount = m_arena != 0 ? ( m_vertexRange != buffer_arena<Ta, Te>::none ? m_arena->vertex_count( m_vertexRange ) : 0 ) : m_vertices.count();
+    if( m_positions == 0 )
+        throw std::runtime_error( "vertex_buffer_object::initElements: levels of detail need the vertices first." );
+
+    std::vector<Te> level( elements, elements + static_cast<std::size_t>(count)*3 );
+    m_lods = level;
+    m_lodFirst.assign( 1, 0 );
+    m_lodCount.assign( 1, count );
+    m_lodError.assign( 1, 0.0f );
+
+    // each level is simplified from the one before, so the errors add up
+    for( unsigned int l=1; l<m_lodLevels; l++ )
+    {
+        std::size_t triangles = level.size()/3;
+        std::vector<Te> next( level );
+        float error = util::simplify( next, m_positions, components, vertexCount, static_cast<std::size_t>( triangles*m_lodRatio ) );
+
+        // stop once the mesh can't be reduced much further
+        if( next.empty() || next.size()/3 > triangles - triangles/10 )
+            break;
+
+        util::optimize_vertex_cache( next, vertexCount );
+        m_lodFirst.push_back( static_cast<unsigned int>( m_lods.size()/3 ) );
+        m_lodCount.push_back( static_cast<unsigned int>( next.size()/3 ) );
+        m_lodError.push_back( m_lodError.back() + error );
+        m_lods.insert( m_lods.end(), next.begin(), next.end() );
+        level.swap( next );
+    }
+
+    initElements( m_lods.empty() ? 0 : &m_lods[0], static_cast<unsigned int>( m_lods.size()/3 ) );
+}
+
+
+template <typename Ta, typename Te>
+inline unsigned int vertex_buffer_object<Ta, Te>::primitive_count() const
+{
+    // the levels of detail follow level 0
+    if( !m_lodCount.empty() )
+        return m_lodCount[0];
+
+    if( m_arena != 0 )
+        return m_elementRange != buffer_arena<Ta, Te>::none ? m_arena->element_count( m_elementRange ) / m_elements.size() : 0;
+
+    return m_elements.count();
+}
+
+
+template <typename Ta, typename Te>
+inline void vertex_buffer_object<Ta, Te>::release_ranges()
+{
+    if( m_arena == 0 )
+        return;
+
+    if( m_vertexRange != buffer_arena<Ta, Te>::none )
+        m_arena->free_vertices( m_vertexRange );
+    if( m_elementRange != buffer_arena<Ta, Te>::none )
+        m_arena->free_elements( m_elementRange );
+
+    m_vertexRange = m_elementRange = buffer_arena<Ta, Te>::none;
+}
+
+
 } // end namespace nyx
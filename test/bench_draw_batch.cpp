@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * bench_draw_batch.cpp
+ *
+ *  Draws many small objects living in one buffer_arena, once object by object
+ *  and once as a single multi draw indirect batch.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <nyx/draw_batch.hpp>
+
+#include <GL/glut.h>
+
+
+static const unsigned int objectCount = 4096;
+static const unsigned int frameCount = 100;
+
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        // create a context
+        glutInit( &argc, argv );
+        glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE );
+        glutCreateWindow( "bench_draw_batch" );
+
+        if( glewInit() != GLEW_OK )
+            throw std::runtime_error( "bench_draw_batch: unable to initialize glew." );
+
+        // a quad per object
+        float normals[12] = { 0,0,1, 0,0,1, 0,0,1, 0,0,1 };
+        float colors[12] = { 1,1,1, 1,1,1, 1,1,1, 1,1,1 };
+        float texCoords[8] = { 0,0, 1,0, 0,1, 1,1 };
+        unsigned int elements[6] = { 0,1,2, 1,3,2 };
+
+        nyx::buffer_arena<float> arena;
+        arena.configure();
+        arena.init( objectCount*4, objectCount*6 );
+
+        std::vector< nyx::vertex_buffer_object<float>* > objects( objectCount );
+        for( unsigned int i=0; i<objectCount; i++ )
+        {
+            float x = -1.0f + 2.0f*(i%64)/64.0f, y = -1.0f + 2.0f*(i/64)/64.0f, s = 1.5f/64.0f;
+            float vertices[12] = { x,y,0, x+s,y,0, x,y+s,0, x+s,y+s,0 };
+
+            objects[i] = new nyx::vertex_buffer_object<float>();
+            objects[i]->configure( arena, GL_TRIANGLES );
+            objects[i]->initVertices( vertices, 4 );
+            objects[i]->initNormals( normals );
+            objects[i]->initColors( colors );
+            objects[i]->initTexCoords( texCoords );
+            objects[i]->initElements( elements, 2 );
+        }
+
+        nyx::draw_batch<float> batch;
+        batch.configure( arena );
+        for( unsigned int i=0; i<objectCount; i++ )
+            batch.add( *objects[i] );
+
+        // object by object
+        glFinish();
+        int start = glutGet( GLUT_ELAPSED_TIME );
+        for( unsigned int f=0; f<frameCount; f++ )
+            for( unsigned int i=0; i<objectCount; i++ )
+                objects[i]->draw();
+        glFinish();
+        double single = (glutGet( GLUT_ELAPSED_TIME ) - start) / 1000.0;
+
+        // one batch
+        start = glutGet( GLUT_ELAPSED_TIME );
+        for( unsigned int f=0; f<frameCount; f++ )
+            batch.draw();
+        glFinish();
+        double batched = (glutGet( GLUT_ELAPSED_TIME ) - start) / 1000.0;
+
+        std::cout << objectCount << " objects, per object: " << single*1000.0/frameCount << " ms/frame, "
+                  << "batched: " << batched*1000.0/frameCount << " ms/frame" << std::endl;
+
+        for( unsigned int i=0; i<objectCount; i++ )
+            delete objects[i];
+    }
+    catch( std::exception& e )
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
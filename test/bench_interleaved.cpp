@@ -0,0 +1,123 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * bench_interleaved.cpp
+ *
+ *  Compares the draw throughput of the separate stream (SoA) vertex_buffer_object
+ *  with the interleaved (AoS) interleaved_buffer_object on a large grid mesh.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <nyx/vertex_buffer_object.hpp>
+#include <nyx/interleaved_buffer_object.hpp>
+
+#include <GL/glut.h>
+
+
+static const unsigned int gridSize = 1024;
+static const unsigned int drawCount = 100;
+
+
+struct mesh
+{
+    std::vector<float> vertices, normals, colors, texCoords;
+    std::vector<unsigned int> elements;
+
+    mesh()
+    {
+        for( unsigned int y=0; y<gridSize; y++ )
+            for( unsigned int x=0; x<gridSize; x++ )
+            {
+                float u = float(x)/gridSize, v = float(y)/gridSize;
+                vertices.push_back( 2.0f*u-1.0f ); vertices.push_back( 2.0f*v-1.0f ); vertices.push_back( 0.0f );
+                normals.push_back( 0.0f ); normals.push_back( 0.0f ); normals.push_back( 1.0f );
+                colors.push_back( u ); colors.push_back( v ); colors.push_back( 0.5f );
+                texCoords.push_back( u ); texCoords.push_back( v );
+            }
+
+        for( unsigned int y=0; y+1<gridSize; y++ )
+            for( unsigned int x=0; x+1<gridSize; x++ )
+            {
+                unsigned int i = y*gridSize + x;
+                elements.push_back( i ); elements.push_back( i+1 ); elements.push_back( i+gridSize );
+                elements.push_back( i+1 ); elements.push_back( i+gridSize+1 ); elements.push_back( i+gridSize );
+            }
+    }
+};
+
+
+template <typename VBO>
+void run( const char *name, VBO &vbo, const mesh &m )
+{
+    vbo.configure( GL_TRIANGLES );
+    vbo.initVertices( &m.vertices[0], gridSize*gridSize );
+    vbo.initNormals( &m.normals[0] );
+    vbo.initColors( &m.colors[0] );
+    vbo.initTexCoords( &m.texCoords[0] );
+    vbo.initElements( &m.elements[0], static_cast<unsigned int>( m.elements.size()/3 ) );
+
+    // warm up
+    vbo.draw();
+    glFinish();
+
+    int start = glutGet( GLUT_ELAPSED_TIME );
+    for( unsigned int i=0; i<drawCount; i++ )
+        vbo.draw();
+    glFinish();
+    double seconds = (glutGet( GLUT_ELAPSED_TIME ) - start) / 1000.0;
+
+    std::cout << name << ": " << seconds*1000.0/drawCount << " ms/draw, "
+              << double(drawCount) * m.elements.size()/3 / seconds / 1.0e6 << " Mtris/s" << std::endl;
+}
+
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        // create a context
+        glutInit( &argc, argv );
+        glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE );
+        glutCreateWindow( "bench_interleaved" );
+
+        if( glewInit() != GLEW_OK )
+            throw std::runtime_error( "bench_interleaved: unable to initialize glew." );
+
+        mesh m;
+
+        nyx::vertex_buffer_object<float> soa;
+        run( "separate (SoA)", soa, m );
+
+        nyx::interleaved_buffer_object<float, nyx::layout< nyx::position<3>, nyx::normal, nyx::color<3>, nyx::texcoord<2> > > aos;
+        run( "interleaved (AoS)", aos, m );
+    }
+    catch( std::exception& e )
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
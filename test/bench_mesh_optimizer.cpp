@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * bench_mesh_optimizer.cpp
+ *
+ *  Reports ACMR and draw time of a grid mesh with shuffled triangles (like a
+ *  scanned mesh) before and after each stage of the mesh optimizer.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <nyx/vertex_buffer_object.hpp>
+#include <nyx/mesh_optimizer.hpp>
+
+#include <GL/glut.h>
+
+
+static const unsigned int gridSize = 512;
+static const unsigned int drawCount = 100;
+
+
+struct mesh
+{
+    std::vector<float> vertices, normals;
+    std::vector<unsigned int> elements;
+
+    mesh()
+    {
+        for( unsigned int y=0; y<gridSize; y++ )
+            for( unsigned int x=0; x<gridSize; x++ )
+            {
+                float u = float(x)/gridSize, v = float(y)/gridSize;
+                vertices.push_back( 2.0f*u-1.0f ); vertices.push_back( 2.0f*v-1.0f ); vertices.push_back( 0.0f );
+                normals.push_back( 0.0f ); normals.push_back( 0.0f ); normals.push_back( 1.0f );
+            }
+
+        for( unsigned int y=0; y+1<gridSize; y++ )
+            for( unsigned int x=0; x+1<gridSize; x++ )
+            {
+                unsigned int i = y*gridSize + x;
+                elements.push_back( i ); elements.push_back( i+1 ); elements.push_back( i+gridSize );
+                elements.push_back( i+1 ); elements.push_back( i+gridSize+1 ); elements.push_back( i+gridSize );
+            }
+
+        // scatter the triangles
+        std::srand( 1 );
+        for( size_t t=elements.size()/3-1; t>0; t-- )
+        {
+            size_t r = static_cast<size_t>( std::rand() ) % (t+1);
+            for( int k=0; k<3; k++ )
+                std::swap( elements[t*3+k], elements[r*3+k] );
+        }
+    }
+};
+
+
+void run( const char *name, const mesh &m )
+{
+    unsigned int vertexCount = static_cast<unsigned int>( m.vertices.size()/3 );
+
+    nyx::vertex_buffer_object<float> vbo;
+    vbo.configure( GL_TRIANGLES );
+    vbo.initVertices( &m.vertices[0], vertexCount );
+    vbo.initNormals( &m.normals[0] );
+    vbo.initElements( &m.elements[0], static_cast<unsigned int>( m.elements.size()/3 ) );
+
+    // warm up
+    vbo.draw();
+    glFinish();
+
+    int start = glutGet( GLUT_ELAPSED_TIME );
+    for( unsigned int i=0; i<drawCount; i++ )
+        vbo.draw();
+    glFinish();
+    double seconds = (glutGet( GLUT_ELAPSED_TIME ) - start) / 1000.0;
+
+    std::cout << name << ": ACMR " << nyx::util::acmr( m.elements, vertexCount ) << ", "
+              << seconds*1000.0/drawCount << " ms/draw" << std::endl;
+}
+
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        // create a context
+        glutInit( &argc, argv );
+        glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH );
+        glutCreateWindow( "bench_mesh_optimizer" );
+
+        if( glewInit() != GLEW_OK )
+            throw std::runtime_error( "bench_mesh_optimizer: unable to initialize glew." );
+
+        glEnable( GL_DEPTH_TEST );
+        glEnable( GL_LIGHTING );
+        glEnable( GL_LIGHT0 );
+
+        mesh m;
+        unsigned int vertexCount = static_cast<unsigned int>( m.vertices.size()/3 );
+        run( "unoptimized", m );
+
+        nyx::util::optimize_vertex_cache( m.elements, vertexCount );
+        run( "vertex cache", m );
+
+        nyx::util::optimize_overdraw( m.elements, m.vertices, 3 );
+        run( "overdraw", m );
+
+        std::vector<unsigned int> remap;
+        vertexCount = nyx::util::optimize_vertex_fetch( m.elements, vertexCount, remap );
+        nyx::util::remap_vertices( m.vertices, 3, remap, vertexCount );
+        nyx::util::remap_vertices( m.normals, 3, remap, vertexCount );
+        run( "vertex fetch", m );
+    }
+    catch( std::exception& e )
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * bench_stream_buffer.cpp
+ *
+ *  Compares the throughput of per frame buffer updates through glBufferData
+ *  (GL_DYNAMIC_DRAW) with the persistent mapped ring (GL_STREAM_DRAW).
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <nyx/vertex_array_buffer.hpp>
+
+#include <GL/glut.h>
+
+
+static const unsigned int vertexCount = 1 << 20;
+static const unsigned int frameCount = 200;
+
+
+double run( const char *name, unsigned int usage, std::vector<float> &vertices )
+{
+    nyx::vertex_array_buffer<float> buffer;
+    buffer.configure( 3, usage );
+    buffer.init( &vertices[0], vertexCount );
+
+    glFinish();
+    int start = glutGet( GLUT_ELAPSED_TIME );
+
+    for( unsigned int frame=0; frame<frameCount; frame++ )
+    {
+        // touch the data like a dynamic mesh would
+        vertices[ (frame*3) % vertices.size() ] += 1.0f;
+
+        buffer.update();
+        buffer.bind();
+        glDrawArrays( GL_POINTS, 0, vertexCount );
+        buffer.unbind();
+        glFlush();
+    }
+
+    glFinish();
+    double seconds = (glutGet( GLUT_ELAPSED_TIME ) - start) / 1000.0;
+    double megabytes = double(frameCount) * vertexCount * 3 * sizeof(float) / (1024.0*1024.0);
+
+    std::cout << name << (buffer.is_streaming() ? " (ring)" : "")
+              << ": " << seconds*1000.0/frameCount << " ms/frame, "
+              << megabytes/seconds << " MB/s" << std::endl;
+
+    return seconds;
+}
+
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        // create a context
+        glutInit( &argc, argv );
+        glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE );
+        glutCreateWindow( "bench_stream_buffer" );
+
+        if( glewInit() != GLEW_OK )
+            throw std::runtime_error( "bench_stream_buffer: unable to initialize glew." );
+
+        std::vector<float> vertices( vertexCount*3, 0.0f );
+
+        run( "GL_DYNAMIC_DRAW", GL_DYNAMIC_DRAW, vertices );
+        run( "GL_STREAM_DRAW", GL_STREAM_DRAW, vertices );
+    }
+    catch( std::exception& e )
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
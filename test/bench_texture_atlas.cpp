@@ -0,0 +1,132 @@
+ ///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * bench_texture_atlas.cpp
+ *
+ *  Uploads many small images, once as a texture each and once packed into a
+ *  texture_atlas, then binds them for every image of a frame as a renderer
+ *  switching materials would. Reports how full the atlas layers are and the
+ *  time spent on uploads and bindings.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+#include <nyx/atlas.hpp>
+
+#include <GL/glut.h>
+
+
+static const unsigned int imageCount = 2048;
+static const unsigned int layerSize = 1024;
+static const unsigned int frameCount = 100;
+
+typedef std::chrono::steady_clock clock_type;
+
+
+static double milliseconds( clock_type::duration d )
+{
+    return std::chrono::duration<double, std::milli>( d ).count();
+}
+
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        // create a context
+        glutInit( &argc, argv );
+        glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE );
+        glutCreateWindow( "bench_texture_atlas" );
+
+        if( glewInit() != GLEW_OK )
+            throw std::runtime_error( "bench_texture_atlas: unable to initialize glew." );
+
+        // icons and decals between 16 and 128 texels
+        std::srand( 1 );
+        std::vector<unsigned int> sizes( imageCount*2 );
+        std::vector< std::vector<unsigned char> > images( imageCount );
+        std::vector<const unsigned char*> pixels( imageCount );
+        for( unsigned int i=0; i<imageCount; i++ )
+        {
+            sizes[i*2] = 16 + std::rand() % 113;
+            sizes[i*2+1] = 16 + std::rand() % 113;
+            images[i].assign( std::size_t(sizes[i*2]) * sizes[i*2+1] * 4, static_cast<unsigned char>(i) );
+            pixels[i] = &images[i][0];
+        }
+
+        // a texture per image
+        glFinish();
+        clock_type::time_point start = clock_type::now();
+        std::vector< nyx::texture<unsigned char>* > textures( imageCount );
+        for( unsigned int i=0; i<imageCount; i++ )
+        {
+            textures[i] = new nyx::texture<unsigned char>();
+            textures[i]->set_data( sizes[i*2], sizes[i*2+1], pixels[i] );
+        }
+        glFinish();
+        double separateUpload = milliseconds( clock_type::now() - start );
+
+        start = clock_type::now();
+        for( unsigned int f=0; f<frameCount; f++ )
+            for( unsigned int i=0; i<imageCount; i++ )
+                textures[i]->bind();
+        glFinish();
+        double separateBind = milliseconds( clock_type::now() - start );
+
+        // enough layers for the worst case, the atlas only fills what it needs
+        glFinish();
+        start = clock_type::now();
+        nyx::texture_atlas<unsigned char> atlas;
+        atlas.configure( layerSize, layerSize, 32 );
+        std::vector<nyx::atlas_packer::placement> placements;
+        std::size_t placed = atlas.add( &pixels[0], &sizes[0], imageCount, placements );
+        glFinish();
+        double atlasUpload = milliseconds( clock_type::now() - start );
+
+        start = clock_type::now();
+        for( unsigned int f=0; f<frameCount; f++ )
+            for( unsigned int i=0; i<imageCount; i++ )
+                atlas.bind();
+        glFinish();
+        double atlasBind = milliseconds( clock_type::now() - start );
+
+        std::cout << "textures: " << imageCount << " objects, upload " << separateUpload << " ms, "
+                  << separateBind/frameCount << " ms/frame binding" << std::endl;
+        std::cout << "texture_atlas: " << placed << " images in " << atlas.packer().layers() << " layers of "
+                  << layerSize << "^2, " << 100.0f*atlas.packer().occupancy() << "% occupied, upload "
+                  << atlasUpload << " ms, " << atlasBind/frameCount << " ms/frame binding" << std::endl;
+
+        for( unsigned int i=0; i<imageCount; i++ )
+            delete textures[i];
+    }
+    catch( std::exception& e )
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
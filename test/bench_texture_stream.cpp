@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * bench_texture_stream.cpp
+ *
+ *  Uploads 4K RGBA frames into a texture, once synchronously with
+ *  texture::update from client memory and once through a texture_stream fed
+ *  by a producer thread. Reports the sustained throughput and the time the
+ *  render thread spends uploading per frame.
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include <nyx/texture_stream.hpp>
+
+#include <GL/glut.h>
+
+
+static const unsigned int width = 3840;
+static const unsigned int height = 2160;
+static const unsigned int frameCount = 200;
+
+typedef std::chrono::steady_clock clock_type;
+
+
+static double milliseconds( clock_type::duration d )
+{
+    return std::chrono::duration<double, std::milli>( d ).count();
+}
+
+
+static void report( const char *name, unsigned int frames, double renderMs, double totalMs )
+{
+    double megabytes = double(frames) * width * height * 4 / (1024.0*1024.0);
+
+    std::cout << name << ": " << renderMs/frameCount << " ms/frame on the render thread, "
+              << megabytes/(totalMs/1000.0) << " MB/s (" << frames << " frames)" << std::endl;
+}
+
+
+// a frame the camera could have delivered
+static void produce( unsigned char *pixels, unsigned int frame )
+{
+    std::memset( pixels, frame & 0xff, std::size_t(width)*height*4 );
+}
+
+
+void run_sync( std::vector<unsigned char> &frame )
+{
+    nyx::texture<unsigned char> tex;
+    tex.set_data( width, height, &frame[0] );
+
+    glFinish();
+    clock_type::time_point start = clock_type::now();
+    clock_type::duration render( 0 );
+
+    for( unsigned int f=0; f<frameCount; f++ )
+    {
+        produce( &frame[0], f );
+
+        clock_type::time_point t = clock_type::now();
+        tex.update( &frame[0] );
+        render += clock_type::now() - t;
+
+        glFlush();
+    }
+
+    glFinish();
+    report( "texture::update", frameCount, milliseconds( render ), milliseconds( clock_type::now() - start ) );
+}
+
+
+void run_stream( unsigned int slots )
+{
+    nyx::texture<unsigned char> tex;
+    tex.set_data( width, height, 0 );
+
+    nyx::texture_stream<unsigned char> stream;
+    stream.configure( tex, slots );
+
+    // the producer writes straight into the mapped slots
+    std::atomic<bool> running( true );
+    std::atomic<bool> finished( false );
+    std::thread producer( [&]()
+    {
+        for( unsigned int f=0; running; f++ )
+        {
+            unsigned char *pixels = stream.acquire();
+            produce( pixels, f );
+            stream.commit();
+        }
+        finished = true;
+    } );
+
+    glFinish();
+    clock_type::time_point start = clock_type::now();
+    clock_type::duration render( 0 );
+
+    // render as fast as the producer delivers
+    while( stream.frames_uploaded() < frameCount )
+    {
+        // polling without a new frame is not counted
+        clock_type::time_point t = clock_type::now();
+        if( stream.upload() )
+        {
+            render += clock_type::now() - t;
+            glFlush();
+        }
+    }
+
+    glFinish();
+    double total = milliseconds( clock_type::now() - start );
+
+    // keep recycling slots until the producer noticed
+    running = false;
+    while( !finished )
+        stream.upload();
+    producer.join();
+
+    report( stream.is_persistent() ? "texture_stream (persistent)" : "texture_stream", frameCount, milliseconds( render ), total );
+}
+
+
+int main( int argc, char **argv )
+{
+    try
+    {
+        // create a context
+        glutInit( &argc, argv );
+        glutInitDisplayMode( GLUT_RGBA | GLUT_DOUBLE );
+        glutCreateWindow( "bench_texture_stream" );
+
+        if( glewInit() != GLEW_OK )
+            throw std::runtime_error( "bench_texture_stream: unable to initialize glew." );
+
+        std::vector<unsigned char> frame( std::size_t(width)*height*4, 0 );
+
+        run_sync( frame );
+        run_stream( 3 );
+    }
+    catch( std::exception& e )
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test.hpp
+ *
+ *  Checks for the tests, a failed check is reported with its line and makes
+ *  the test return 1 for ctest.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace test
+{
+
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+
+inline void check( bool condition, const char *expression, const char *file, int line )
+{
+    if( condition )
+        return;
+
+    std::cout << file << ":" << line << ": check failed: " << expression << std::endl;
+    failures()++;
+}
+
+
+// runs the test functions, exceptions count as failures
+template <typename F>
+inline int run( F tests )
+{
+    try
+    {
+        tests();
+    }
+    catch( std::exception& e )
+    {
+        std::cout << e.what() << std::endl;
+        failures()++;
+    }
+
+    return failures() == 0 ? 0 : 1;
+}
+
+
+// reproducible pseudo random numbers, the same on every platform
+class random
+{
+public:
+    explicit random( std::uint32_t seed=1 ) : m_state( seed ) {}
+
+    std::uint32_t next()
+    {
+        m_state = m_state * 1664525u + 1013904223u;
+        return m_state >> 8;
+    }
+
+    // in [0, n)
+    unsigned int below( unsigned int n )
+    {
+        return static_cast<unsigned int>( next() % n );
+    }
+
+    // in [lo, hi)
+    float uniform( float lo, float hi )
+    {
+        return lo + (hi - lo) * static_cast<float>( next() & 0xFFFFFF ) / 16777216.0f;
+    }
+
+protected:
+    std::uint32_t m_state;
+};
+
+
+// size x size vertices on the unit square, two counter clockwise triangles per cell
+inline void grid( unsigned int size, std::vector<float> &positions, std::vector<unsigned int> &elements )
+{
+    positions.clear();
+    elements.clear();
+    for( unsigned int y=0; y<size; y++ )
+        for( unsigned int x=0; x<size; x++ )
+        {
+            positions.push_back( float(x) / float(size-1) );
+            positions.push_back( float(y) / float(size-1) );
+            positions.push_back( 0.0f );
+        }
+
+    for( unsigned int y=0; y+1<size; y++ )
+        for( unsigned int x=0; x+1<size; x++ )
+        {
+            unsigned int v = y*size + x;
+            unsigned int quad[6] = { v, v+1, v+size+1, v, v+size+1, v+size };
+            elements.insert( elements.end(), quad, quad+6 );
+        }
+}
+
+
+// shuffles the triangles of a list, like the order of a scanned mesh
+template <typename Te>
+inline void shuffle_triangles( std::vector<Te> &elements, random &r )
+{
+    for( std::size_t t=elements.size()/3; t>1; t-- )
+    {
+        std::size_t o = r.below( static_cast<unsigned int>( t ) );
+        for( int k=0; k<3; k++ )
+            std::swap( elements[(t-1)*3+k], elements[o*3+k] );
+    }
+}
+
+
+typedef std::pair< unsigned int, std::pair<unsigned int, unsigned int> > triangle;
+
+// the triangles of a list, each rotated to start at its smallest index so the winding is kept, sorted
+template <typename Te>
+inline std::vector<triangle> triangle_set( const std::vector<Te> &elements )
+{
+    std::vector<triangle> set;
+    for( std::size_t t=0; t+2<elements.size(); t+=3 )
+    {
+        unsigned int a = elements[t], b = elements[t+1], c = elements[t+2];
+        if( b < a && b < c )
+            set.push_back( std::make_pair( b, std::make_pair( c, a ) ) );
+        else if( c < a && c < b )
+            set.push_back( std::make_pair( c, std::make_pair( a, b ) ) );
+        else
+            set.push_back( std::make_pair( a, std::make_pair( b, c ) ) );
+    }
+    std::sort( set.begin(), set.end() );
+    return set;
+}
+
+} // end namespace test
+
+
+#define CHECK( condition ) test::check( (condition), #condition, __FILE__, __LINE__ )
@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test_atlas_packer.cpp
+ *
+ *  Placed images and their padding stay inside their layer and never
+ *  overlap, the transform maps the image onto its texels, and the layer
+ *  limit and oversized images are reported.
+ */
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include <nyx/atlas.hpp>
+
+#include "test.hpp"
+
+
+typedef nyx::atlas_packer::placement placement;
+
+
+static bool consistent( const nyx::atlas_packer &packer, const std::vector<placement> &placements )
+{
+    bool ok = true;
+    unsigned int p = packer.padding();
+    for( std::size_t i=0; i<placements.size(); i++ )
+    {
+        const placement &a = placements[i];
+        if( a.layer == nyx::atlas_packer::none )
+            continue;
+
+        // inside the layer with the padding around it
+        ok = ok && a.layer < packer.layers();
+        ok = ok && a.x >= p && a.y >= p && a.x + a.width + p <= packer.width() && a.y + a.height + p <= packer.height();
+
+        // (0,0) and (1,1) of the image land on its corners
+        ok = ok && std::fabs( a.offset[0]*packer.width() - a.x ) < 1.0e-3f && std::fabs( a.offset[1]*packer.height() - a.y ) < 1.0e-3f;
+        ok = ok && std::fabs( (a.scale[0] + a.offset[0])*packer.width() - (a.x + a.width) ) < 1.0e-3f;
+        ok = ok && std::fabs( (a.scale[1] + a.offset[1])*packer.height() - (a.y + a.height) ) < 1.0e-3f;
+
+        // the padded rectangles don't overlap
+        for( std::size_t j=0; j<i; j++ )
+        {
+            const placement &b = placements[j];
+            if( b.layer != a.layer )
+                continue;
+            bool apart = a.x + a.width + p <= b.x - p || b.x + b.width + p <= a.x - p ||
+                         a.y + a.height + p <= b.y - p || b.y + b.height + p <= a.y - p;
+            ok = ok && apart;
+        }
+    }
+    return ok;
+}
+
+
+static void test_insert()
+{
+    test::random random( 53 );
+    nyx::atlas_packer packer;
+    packer.reset( 256, 128, 2 );
+
+    std::vector<placement> placements;
+    for( int i=0; i<300; i++ )
+    {
+        placement p;
+        CHECK( packer.insert( 1 + random.below( 60 ), 1 + random.below( 40 ), p ) );
+        placements.push_back( p );
+    }
+    CHECK( consistent( packer, placements ) );
+    CHECK( packer.layers() > 1 );
+    CHECK( packer.occupancy() > 0.5f && packer.occupancy() <= 1.0f );
+
+    // an image (with its padding) larger than a layer can never be placed
+    placement p;
+    bool thrown = false;
+    try
+    {
+        packer.insert( 253, 10, p );
+    }
+    catch( std::runtime_error& )
+    {
+        thrown = true;
+    }
+    CHECK( thrown );
+    CHECK( packer.insert( 252, 124, p ) && p.x == 2 && p.y == 2 );
+}
+
+
+static void test_pack()
+{
+    test::random random( 59 );
+    std::vector<unsigned int> sizes;
+    for( int i=0; i<400; i++ )
+    {
+        sizes.push_back( 1 + random.below( 48 ) );
+        sizes.push_back( 1 + random.below( 48 ) );
+    }
+
+    // limited to two layers, what doesn't fit is reported as none
+    nyx::atlas_packer packer;
+    packer.reset( 256, 256, 1, 2 );
+    std::vector<placement> placements;
+    std::size_t placed = packer.pack( &sizes[0], sizes.size()/2, placements );
+    CHECK( placements.size() == sizes.size()/2 );
+    CHECK( consistent( packer, placements ) );
+    CHECK( packer.layers() == 2 );
+
+    std::size_t count = 0;
+    bool sized = true;
+    for( std::size_t i=0; i<placements.size(); i++ )
+    {
+        count += placements[i].layer != nyx::atlas_packer::none ? 1 : 0;
+        sized = sized && placements[i].width == sizes[i*2] && placements[i].height == sizes[i*2+1];
+    }
+    CHECK( placed == count );
+    CHECK( placed > 0 && placed < placements.size() );
+    CHECK( sized );
+    CHECK( packer.occupancy() > 0.8f );
+
+    placement p;
+    CHECK( !packer.insert( 200, 200, p ) && p.layer == nyx::atlas_packer::none );
+
+    // equal tiles fill a layer exactly
+    packer.reset( 256, 256, 0 );
+    std::vector<unsigned int> tiles( 2*16, 64 );
+    CHECK( packer.pack( &tiles[0], 16, placements ) == 16 );
+    CHECK( consistent( packer, placements ) );
+    CHECK( packer.layers() == 1 && packer.occupancy() == 1.0f );
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_insert();
+        test_pack();
+    } );
+}
@@ -0,0 +1,160 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+
+/*
+ * test_dirty_ranges.cpp
+ *
+ *  Marked ranges are clamped to the buffer, merge coalesces adjacent,
+ *  overlapping and nearby ranges in any order of marking, and the covered
+ *  elements plus the saved ones add up to the buffer.
+ */
+
+#include <vector>
+
+#include <nyx/dirty_ranges.hpp>
+
+#include "test.hpp"
+
+
+static bool equals( const nyx::dirty_ranges &dirty, const unsigned int *expected, std::size_t count )
+{
+    if( dirty.size() != count )
+        return false;
+
+    for( std::size_t i=0; i<count; i++ )
+        if( dirty[i].first != expected[2*i] || dirty[i].second != expected[2*i+1] )
+            return false;
+    return true;
+}
+
+
+static void test_merge()
+{
+    nyx::dirty_ranges dirty;
+    CHECK( dirty.merge( 4 ) == 0 );
+    CHECK( dirty.empty() );
+
+    // adjacent ranges become one even without a merge distance
+    dirty.mark( 0, 4, 100 );
+    dirty.mark( 4, 2, 100 );
+    const unsigned int adjacent[] = { 0, 6 };
+    CHECK( dirty.merge( 0 ) == 6 );
+    CHECK( equals( dirty, adjacent, 1 ) );
+    dirty.clear();
+
+    // overlapping and contained ranges, marked out of order
+    dirty.mark( 20, 10, 100 );
+    dirty.mark( 10, 15, 100 );
+    dirty.mark( 12, 2, 100 );
+    const unsigned int overlapping[] = { 10, 30 };
+    CHECK( dirty.merge( 0 ) == 20 );
+    CHECK( equals( dirty, overlapping, 1 ) );
+    dirty.clear();
+
+    // a gap up to the distance is uploaded along, a larger one is not
+    dirty.mark( 50, 5, 100 );
+    dirty.mark( 30, 5, 100 );
+    dirty.mark( 0, 5, 100 );
+    dirty.mark( 38, 2, 100 );
+    const unsigned int nearby[] = { 0, 5, 30, 40, 50, 55 };
+    CHECK( dirty.merge( 3 ) == 20 );
+    CHECK( equals( dirty, nearby, 3 ) );
+
+    // merging again is stable, a larger distance joins the rest
+    CHECK( dirty.merge( 3 ) == 20 );
+    CHECK( equals( dirty, nearby, 3 ) );
+    const unsigned int joined[] = { 0, 55 };
+    CHECK( dirty.merge( 25 ) == 55 );
+    CHECK( equals( dirty, joined, 1 ) );
+    dirty.clear();
+
+    // clamped to the buffer, empty ranges and ranges behind it are dropped
+    dirty.mark( 90, 20, 100 );
+    dirty.mark( 100, 1, 100 );
+    dirty.mark( 5, 0, 100 );
+    dirty.mark( 95, 0xFFFFFFFFu, 100 );
+    const unsigned int clamped[] = { 90, 100 };
+    CHECK( dirty.size() == 2 );
+    CHECK( dirty.merge( 0 ) == 10 );
+    CHECK( equals( dirty, clamped, 1 ) );
+}
+
+
+static void test_random()
+{
+    test::random random( 11 );
+    const unsigned int count = 4096;
+
+    for( int round=0; round<200; round++ )
+    {
+        nyx::dirty_ranges dirty;
+        std::vector<bool> marked( count, false );
+
+        unsigned int ranges = 1 + random.below( 40 );
+        for( unsigned int r=0; r<ranges; r++ )
+        {
+            unsigned int offset = random.below( count + 16 );
+            unsigned int length = random.below( 64 );
+            dirty.mark( offset, length, count );
+            for( unsigned int i=offset; i<offset+length && i<count; i++ )
+                marked[i] = true;
+        }
+
+        unsigned int distance = random.below( 32 );
+        unsigned int covered = dirty.merge( distance );
+
+        // sorted, disjoint and further apart than the distance
+        unsigned int sum = 0;
+        std::vector<bool> uploaded( count, false );
+        for( std::size_t i=0; i<dirty.size(); i++ )
+        {
+            CHECK( dirty[i].first < dirty[i].second && dirty[i].second <= count );
+            if( i > 0 )
+                CHECK( dirty[i].first > dirty[i-1].second + distance );
+            for( unsigned int e=dirty[i].first; e<dirty[i].second; e++ )
+                uploaded[e] = true;
+            sum += dirty[i].second - dirty[i].first;
+        }
+        CHECK( covered == sum );
+
+        // every marked element goes up, the merged ranges start and end on marked ones
+        unsigned int saved = 0;
+        for( unsigned int e=0; e<count; e++ )
+        {
+            CHECK( !marked[e] || uploaded[e] );
+            saved += uploaded[e] ? 0 : 1;
+        }
+        for( std::size_t i=0; i<dirty.size(); i++ )
+            CHECK( marked[dirty[i].first] && marked[dirty[i].second-1] );
+        CHECK( covered + saved == count );
+    }
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_merge();
+        test_random();
+    } );
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test_index_narrowing.cpp
+ *
+ *  max_index finds the largest index, optionally ignoring the primitive
+ *  restart index, and narrow keeps every index that fits the narrower type
+ *  while the restart index stays the restart index.
+ */
+
+#include <vector>
+
+#include <nyx/quantize.hpp>
+
+#include "test.hpp"
+
+
+static void test_max_index()
+{
+    const unsigned int restart = 0xFFFFFFFFu;
+    test::random random( 13 );
+
+    // lengths around the SIMD width, the largest index anywhere
+    for( unsigned int n=1; n<40; n++ )
+    {
+        std::vector<unsigned int> indices( n );
+        for( unsigned int i=0; i<n; i++ )
+            indices[i] = random.below( 1000 );
+        unsigned int largest = 1000 + random.below( 1u << 24 ) * 200u;
+        indices[ random.below( n ) ] = largest;
+
+        CHECK( nyx::util::max_index( &indices[0], n ) == largest );
+        CHECK( nyx::util::max_index<unsigned int>( &indices[0], n ) == largest );
+
+        // restart indices count with restart off only
+        indices[ random.below( n ) ] = restart;
+        unsigned int withoutRestart = 0;
+        for( unsigned int i=0; i<n; i++ )
+            withoutRestart = indices[i] != restart && indices[i] > withoutRestart ? indices[i] : withoutRestart;
+
+        CHECK( nyx::util::max_index( &indices[0], n ) == restart );
+        CHECK( nyx::util::max_index( &indices[0], n, true ) == withoutRestart );
+        CHECK( nyx::util::max_index<unsigned int>( &indices[0], n, true ) == withoutRestart );
+    }
+
+    std::vector<unsigned short> shorts( 9, 0xFFFF );
+    shorts[4] = 300;
+    CHECK( nyx::util::max_index( &shorts[0], shorts.size() ) == 0xFFFF );
+    CHECK( nyx::util::max_index( &shorts[0], shorts.size(), true ) == 300 );
+
+    std::vector<unsigned int> restarts( 5, restart );
+    CHECK( nyx::util::max_index( &restarts[0], restarts.size(), true ) == 0 );
+}
+
+
+static void test_narrow()
+{
+    test::random random( 17 );
+    for( unsigned int n=1; n<70; n++ )
+    {
+        std::vector<unsigned int> indices( n );
+        for( unsigned int i=0; i<n; i++ )
+        {
+            switch( random.below( 5 ) )
+            {
+                case 0 : indices[i] = 0xFFFFFFFFu; break;
+                case 1 : indices[i] = 0x80000000u + random.below( 1000 ); break;
+                case 2 : indices[i] = random.below( 200000 ); break;
+                default : indices[i] = random.below( 256 ); break;
+            }
+        }
+
+        std::vector<unsigned short> shorts( n ), shortsScalar( n );
+        nyx::util::narrow( &indices[0], &shorts[0], n );
+        nyx::util::narrow<unsigned int, unsigned short>( &indices[0], &shortsScalar[0], n );
+        CHECK( shorts == shortsScalar );
+
+        std::vector<unsigned char> bytes( n ), bytesScalar( n );
+        nyx::util::narrow( &indices[0], &bytes[0], n );
+        nyx::util::narrow<unsigned int, unsigned char>( &indices[0], &bytesScalar[0], n );
+        CHECK( bytes == bytesScalar );
+
+        // indices that fit are kept, larger ones (and the restart index) saturate to the restart index
+        bool kept = true;
+        for( unsigned int i=0; i<n; i++ )
+        {
+            kept = kept && shorts[i] == ( indices[i] < 0xFFFFu ? indices[i] : 0xFFFFu );
+            kept = kept && bytes[i] == ( indices[i] < 0xFFu ? indices[i] : 0xFFu );
+        }
+        CHECK( kept );
+    }
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_max_index();
+        test_narrow();
+    } );
+}
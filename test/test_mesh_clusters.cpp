@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test_mesh_clusters.cpp
+ *
+ *  build keeps the triangles and makes the clusters contiguous, cull never
+ *  drops a triangle inside the frustum and facing the eye, and drops the
+ *  clusters that are outside or face away.
+ */
+
+#include <vector>
+
+#include <nyx/mesh_clusters.hpp>
+
+#include "test.hpp"
+
+
+static const unsigned int gridSize = 64;
+static const float identity[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+
+
+static unsigned int visible_triangles( const std::vector< std::pair<unsigned int, unsigned int> > &ranges )
+{
+    unsigned int count = 0;
+    for( std::size_t r=0; r<ranges.size(); r++ )
+        count += ranges[r].second;
+    return count;
+}
+
+
+static bool is_visible( const std::vector< std::pair<unsigned int, unsigned int> > &ranges, unsigned int triangle )
+{
+    for( std::size_t r=0; r<ranges.size(); r++ )
+        if( triangle >= ranges[r].first && triangle < ranges[r].first + ranges[r].second )
+            return true;
+    return false;
+}
+
+
+static void test_build()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( gridSize, positions, elements );
+    test::random random( 37 );
+    test::shuffle_triangles( elements, random );
+    std::vector<test::triangle> original = test::triangle_set( elements );
+    unsigned int triangleCount = static_cast<unsigned int>( elements.size()/3 );
+
+    nyx::mesh_clusters clusters;
+    clusters.build( elements, &positions[0], 3, 128 );
+    CHECK( test::triangle_set( elements ) == original );
+    CHECK( clusters.size() >= triangleCount/128 );
+    CHECK( clusters.size() <= triangleCount/16 );
+
+    // everything is visible, and the ranges merge into one
+    std::vector< std::pair<unsigned int, unsigned int> > ranges;
+    clusters.cull( identity, 0, ranges );
+    CHECK( ranges.size() == 1 && ranges[0].first == 0 && ranges[0].second == triangleCount );
+
+    // positions with 4 components and 16 bit indices
+    std::vector<float> homogeneous;
+    for( std::size_t v=0; v<positions.size(); v+=3 )
+    {
+        homogeneous.insert( homogeneous.end(), positions.begin()+v, positions.begin()+v+3 );
+        homogeneous.push_back( 1.0f );
+    }
+    std::vector<unsigned short> shorts( elements.begin(), elements.end() );
+    clusters.build( shorts, &homogeneous[0], 4, 64 );
+    CHECK( test::triangle_set( shorts ) == original );
+    CHECK( clusters.size() >= triangleCount/64 );
+
+    clusters.clear();
+    CHECK( clusters.size() == 0 );
+    clusters.cull( identity, 0, ranges );
+    CHECK( ranges.empty() );
+}
+
+
+static void test_frustum()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( gridSize, positions, elements );
+
+    // the grid covers x from 0.5 to 1.5, the part beyond x = 1 is outside the unit cube
+    for( std::size_t v=0; v<positions.size(); v+=3 )
+        positions[v] += 0.5f;
+
+    nyx::mesh_clusters clusters;
+    clusters.build( elements, &positions[0], 3, 64 );
+
+    std::vector< std::pair<unsigned int, unsigned int> > ranges;
+    clusters.cull( identity, 0, ranges );
+
+    unsigned int triangleCount = static_cast<unsigned int>( elements.size()/3 );
+    bool conservative = true;
+    for( unsigned int t=0; t<triangleCount; t++ )
+    {
+        bool inside = true;
+        for( int k=0; k<3; k++ )
+            inside = inside && positions[ elements[t*3+k]*3 ] <= 1.0f;
+        conservative = conservative && ( !inside || is_visible( ranges, t ) );
+    }
+    CHECK( conservative );
+    CHECK( visible_triangles( ranges ) < triangleCount*3/4 );
+    CHECK( visible_triangles( ranges ) >= triangleCount/2 );
+
+    // moved out of the frustum completely
+    for( std::size_t v=0; v<positions.size(); v+=3 )
+        positions[v] += 2.0f;
+    clusters.build( elements, &positions[0], 3, 64 );
+    clusters.cull( identity, 0, ranges );
+    CHECK( ranges.empty() );
+}
+
+
+static void test_backface()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( gridSize, positions, elements );
+    unsigned int triangleCount = static_cast<unsigned int>( elements.size()/3 );
+
+    nyx::mesh_clusters clusters;
+    clusters.build( elements, &positions[0], 3, 64 );
+
+    // the counter clockwise grid faces +z
+    std::vector< std::pair<unsigned int, unsigned int> > ranges;
+    float front[3] = { 0.5f, 0.5f, 0.5f }, back[3] = { 0.5f, 0.5f, -0.5f };
+    clusters.cull( identity, front, ranges );
+    CHECK( visible_triangles( ranges ) == triangleCount );
+    clusters.cull( identity, back, ranges );
+    CHECK( ranges.empty() );
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_build();
+        test_frustum();
+        test_backface();
+    } );
+}
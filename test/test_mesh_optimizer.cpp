@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test_mesh_optimizer.cpp
+ *
+ *  The optimizers only reorder: every stage keeps the set of triangles with
+ *  their winding, the cache stage lowers the ACMR of a shuffled grid and the
+ *  overdraw stage keeps it within its threshold. The vertex fetch remap
+ *  keeps the triangles on the same positions.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <nyx/mesh_optimizer.hpp>
+
+#include "test.hpp"
+
+
+static const unsigned int gridSize = 48;
+
+
+static void test_vertex_cache()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( gridSize, positions, elements );
+    test::random random( 19 );
+    test::shuffle_triangles( elements, random );
+
+    unsigned int vertexCount = gridSize*gridSize;
+    std::vector<test::triangle> original = test::triangle_set( elements );
+    float before = nyx::util::acmr( elements, vertexCount );
+
+    nyx::util::optimize_vertex_cache( elements, vertexCount );
+    float after = nyx::util::acmr( elements, vertexCount );
+    CHECK( test::triangle_set( elements ) == original );
+    CHECK( before > 2.5f );
+    CHECK( after < 0.8f );
+
+    // the same for 16 bit indices and a smaller cache
+    std::vector<unsigned short> shorts( elements.begin(), elements.end() );
+    test::shuffle_triangles( shorts, random );
+    nyx::util::optimize_vertex_cache( shorts, vertexCount, 8 );
+    CHECK( test::triangle_set( shorts ) == original );
+    CHECK( nyx::util::acmr( shorts, vertexCount, 8 ) < 1.1f );
+
+    // nothing to do for empty lists
+    std::vector<unsigned int> empty;
+    nyx::util::optimize_vertex_cache( empty, 0 );
+    CHECK( empty.empty() );
+}
+
+
+static void test_overdraw()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( gridSize, positions, elements );
+
+    // a bumpy surface, so the clusters face different ways
+    for( std::size_t v=0; v<positions.size(); v+=3 )
+        positions[v+2] = 0.2f * std::sin( 9.0f*positions[v] ) * std::cos( 7.0f*positions[v+1] );
+
+    test::random random( 23 );
+    test::shuffle_triangles( elements, random );
+    std::vector<test::triangle> original = test::triangle_set( elements );
+
+    unsigned int vertexCount = gridSize*gridSize;
+    nyx::util::optimize_vertex_cache( elements, vertexCount );
+    float cached = nyx::util::acmr( elements, vertexCount );
+
+    nyx::util::optimize_overdraw( elements, positions, 3 );
+    CHECK( test::triangle_set( elements ) == original );
+    CHECK( nyx::util::acmr( elements, vertexCount ) <= cached * 1.05f + 0.02f );
+}
+
+
+static void test_vertex_fetch()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( gridSize, positions, elements );
+
+    // the last row isn't referenced any more
+    elements.resize( elements.size() - (gridSize-1)*6 );
+    test::random random( 29 );
+    test::shuffle_triangles( elements, random );
+
+    std::vector<unsigned int> before = elements;
+    std::vector<unsigned int> remap;
+    unsigned int used = nyx::util::optimize_vertex_fetch( elements, gridSize*gridSize, remap );
+    CHECK( used == gridSize*(gridSize-1) );
+
+    std::vector<float> remapped = positions;
+    nyx::util::remap_vertices( remapped, 3, remap, used );
+    CHECK( remapped.size() == std::size_t(used)*3 );
+
+    // first use order, and every corner still has its position
+    bool same = true;
+    unsigned int next = 0;
+    for( std::size_t i=0; i<elements.size(); i++ )
+    {
+        same = same && elements[i] <= next;
+        next = elements[i] == next ? next+1 : next;
+        for( int k=0; k<3; k++ )
+            same = same && remapped[ elements[i]*3+k ] == positions[ before[i]*3+k ];
+    }
+    CHECK( same );
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_vertex_cache();
+        test_overdraw();
+        test_vertex_fetch();
+    } );
+}
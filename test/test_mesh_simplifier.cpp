@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test_mesh_simplifier.cpp
+ *
+ *  simplify reaches the target on a flat grid without flipping triangles or
+ *  moving the border, only ever refers to the original vertices, and stops
+ *  at the error limit on a curved one. Triangles without area, like at the
+ *  pole of a sphere, don't count as flipped.
+ */
+
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include <nyx/mesh_simplifier.hpp>
+
+#include "test.hpp"
+
+
+static const unsigned int gridSize = 33;
+
+
+// z of the normal of every triangle, twice its area in the xy plane
+static void projected_areas( const std::vector<unsigned int> &elements, const std::vector<float> &positions, float &total, float &smallest )
+{
+    total = 0.0f;
+    smallest = FLT_MAX;
+    for( std::size_t t=0; t<elements.size(); t+=3 )
+    {
+        const float *a = &positions[ elements[t]*3 ], *b = &positions[ elements[t+1]*3 ], *c = &positions[ elements[t+2]*3 ];
+        float area = (b[0]-a[0])*(c[1]-a[1]) - (b[1]-a[1])*(c[0]-a[0]);
+        total += 0.5f*area;
+        smallest = std::min( smallest, area );
+    }
+}
+
+
+static bool valid( const std::vector<unsigned int> &elements, unsigned int vertexCount )
+{
+    bool ok = elements.size() % 3 == 0;
+    for( std::size_t t=0; t<elements.size(); t+=3 )
+    {
+        ok = ok && elements[t] < vertexCount && elements[t+1] < vertexCount && elements[t+2] < vertexCount;
+        ok = ok && elements[t] != elements[t+1] && elements[t+1] != elements[t+2] && elements[t+2] != elements[t];
+    }
+    return ok;
+}
+
+
+static void test_flat()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( gridSize, positions, elements );
+    unsigned int vertexCount = gridSize*gridSize;
+    std::size_t triangleCount = elements.size()/3;
+
+    // a plane simplifies without error, the border keeps the square covered once
+    std::size_t target = triangleCount/8;
+    float error = nyx::util::simplify( elements, &positions[0], 3, vertexCount, target );
+    CHECK( valid( elements, vertexCount ) );
+    CHECK( elements.size()/3 <= target );
+    CHECK( elements.size()/3 >= 2 );
+    CHECK( error < 1.0e-3f );
+
+    float area, smallest;
+    projected_areas( elements, positions, area, smallest );
+    CHECK( std::fabs( area - 1.0f ) < 1.0e-4f );
+    CHECK( smallest > 0.0f );
+
+    // nothing to do at or below the target
+    std::vector<unsigned int> before = elements;
+    CHECK( nyx::util::simplify( elements, &positions[0], 3, vertexCount, elements.size()/3 ) == 0.0f );
+    CHECK( elements == before );
+}
+
+
+static void test_degenerate()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( gridSize, positions, elements );
+
+    // squeeze the grid into a triangle, the first row becomes one point
+    for( std::size_t v=0; v<positions.size(); v+=3 )
+        positions[v] = 0.5f + (positions[v] - 0.5f) * positions[v+1];
+
+    unsigned int vertexCount = gridSize*gridSize;
+    float error = nyx::util::simplify( elements, &positions[0], 3, vertexCount, 8 );
+    CHECK( valid( elements, vertexCount ) );
+    CHECK( elements.size()/3 <= 8 );
+    CHECK( error < 1.0e-3f );
+
+    float area, smallest;
+    projected_areas( elements, positions, area, smallest );
+    CHECK( std::fabs( area - 0.5f ) < 1.0e-4f );
+    CHECK( smallest >= 0.0f );
+}
+
+
+static void test_curved()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( gridSize, positions, elements );
+    for( std::size_t v=0; v<positions.size(); v+=3 )
+        positions[v+2] = 0.25f * std::sin( 6.0f*positions[v] ) * std::sin( 5.0f*positions[v+1] );
+
+    unsigned int vertexCount = gridSize*gridSize;
+    std::size_t triangleCount = elements.size()/3;
+
+    // the error limit stops it before the target, the coarser the limit the fewer triangles
+    std::vector<unsigned int> fine = elements, coarse = elements;
+    float fineError = nyx::util::simplify( fine, &positions[0], 3, vertexCount, 8, 0.002f );
+    float coarseError = nyx::util::simplify( coarse, &positions[0], 3, vertexCount, 8, 0.02f );
+    CHECK( valid( fine, vertexCount ) && valid( coarse, vertexCount ) );
+    CHECK( fineError <= 0.002f && coarseError <= 0.02f );
+    CHECK( fine.size()/3 < triangleCount );
+    CHECK( coarse.size() < fine.size() );
+    CHECK( coarse.size()/3 > 8 );
+
+    // seen from above nothing folds over
+    float area, smallest;
+    projected_areas( coarse, positions, area, smallest );
+    CHECK( std::fabs( area - 1.0f ) < 1.0e-3f );
+    CHECK( smallest > 0.0f );
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_flat();
+        test_degenerate();
+        test_curved();
+    } );
+}
@@ -0,0 +1,237 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test_mipmap.cpp
+ *
+ *  Box levels match a plain reference of the box (3 taps along an odd axis
+ *  at the edge), the SSE2 rows match the scalar ones, and threads, row
+ *  strides and the Kaiser filter don't change what they shouldn't.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <nyx/mipmap.hpp>
+
+#include "test.hpp"
+
+
+// the source texels of destination texel i along an axis of "size" texels
+static std::vector<unsigned int> reference_taps( unsigned int i, unsigned int size )
+{
+    std::vector<unsigned int> taps( 1, std::min( 2*i, size-1 ) );
+    if( size > 1 )
+        taps.push_back( 2*i+1 );
+    if( size > 1 && size % 2 == 1 && i == size/2 - 1 )
+        taps.push_back( 2*i+2 );
+    return taps;
+}
+
+
+static std::vector<float> reference_level( const std::vector<float> &source, unsigned int width, unsigned int height, unsigned int depth, unsigned int channels )
+{
+    unsigned int w = nyx::mip_extent( width, 1 ), h = nyx::mip_extent( height, 1 ), d = nyx::mip_extent( depth, 1 );
+    std::vector<float> level( std::size_t(w)*h*d*channels );
+    for( unsigned int z=0; z<d; z++ )
+        for( unsigned int y=0; y<h; y++ )
+            for( unsigned int x=0; x<w; x++ )
+            {
+                std::vector<unsigned int> xs = reference_taps( x, width ), ys = reference_taps( y, height ), zs = reference_taps( z, depth );
+                for( unsigned int c=0; c<channels; c++ )
+                {
+                    double sum = 0.0;
+                    for( std::size_t k=0; k<zs.size(); k++ )
+                        for( std::size_t j=0; j<ys.size(); j++ )
+                            for( std::size_t i=0; i<xs.size(); i++ )
+                                sum += source[ ((std::size_t(zs[k])*height + ys[j])*width + xs[i])*channels + c ];
+                    level[ ((std::size_t(z)*h + y)*w + x)*channels + c ] = static_cast<float>( sum / double( xs.size()*ys.size()*zs.size() ) );
+                }
+            }
+    return level;
+}
+
+
+static bool close( const float *a, const float *b, std::size_t n, float tolerance )
+{
+    for( std::size_t i=0; i<n; i++ )
+        if( std::fabs( a[i] - b[i] ) > tolerance * ( 1.0f + std::fabs( b[i] ) ) )
+            return false;
+    return true;
+}
+
+
+static void test_extents()
+{
+    CHECK( nyx::mip_levels( 1 ) == 1 );
+    CHECK( nyx::mip_levels( 256, 256 ) == 9 );
+    CHECK( nyx::mip_levels( 5, 300, 2 ) == 9 );
+    CHECK( nyx::mip_extent( 5, 1 ) == 2 );
+    CHECK( nyx::mip_extent( 5, 3 ) == 1 );
+}
+
+
+static void test_box()
+{
+    test::random random( 41 );
+    const unsigned int sizes[][4] = { { 16, 16, 1, 4 }, { 37, 21, 1, 1 }, { 5, 3, 1, 3 }, { 1, 9, 1, 2 }, { 11, 6, 7, 1 }, { 9, 1, 3, 4 } };
+    for( std::size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); s++ )
+    {
+        unsigned int width = sizes[s][0], height = sizes[s][1], depth = sizes[s][2], channels = sizes[s][3];
+        std::vector<float> pixels( std::size_t(width)*height*depth*channels );
+        for( std::size_t i=0; i<pixels.size(); i++ )
+            pixels[i] = random.uniform( 0.0f, 1.0f );
+
+        nyx::mip_chain<float> chain;
+        chain.build( &pixels[0], width, height, depth, channels );
+        CHECK( chain.levels() == nyx::mip_levels( width, height, depth ) );
+
+        // every level from the reference of the one above
+        std::vector<float> expected = pixels;
+        bool same = true;
+        for( unsigned int l=1; l<chain.levels(); l++ )
+        {
+            expected = reference_level( expected, chain.width(l-1), chain.height(l-1), chain.depth(l-1), channels );
+            same = same && expected.size() == std::size_t( chain.width(l) )*chain.height(l)*chain.depth(l)*channels;
+            same = same && close( chain.level(l), &expected[0], expected.size(), 1.0e-5f );
+        }
+        CHECK( same );
+    }
+
+    // bytes round to nearest, like the float reference
+    std::vector<unsigned char> bytes( 13*7*4 );
+    for( std::size_t i=0; i<bytes.size(); i++ )
+        bytes[i] = static_cast<unsigned char>( random.below( 256 ) );
+    std::vector<float> floats( bytes.begin(), bytes.end() );
+
+    nyx::mip_chain<unsigned char> chain;
+    chain.build( &bytes[0], 13, 7, 1, 4, 2 );
+    std::vector<float> expected = reference_level( floats, 13, 7, 1, 4 );
+    bool rounded = chain.levels() == 2;
+    for( std::size_t i=0; i<expected.size(); i++ )
+        rounded = rounded && chain.level(1)[i] == static_cast<unsigned char>( std::floor( expected[i] + 0.5f ) );
+    CHECK( rounded );
+}
+
+
+static void test_sse_rows()
+{
+    // the overloads take the SSE2 path where there is one, the templates are scalar
+    test::random random( 43 );
+    bool bytesSame = true, floatsSame = true;
+    for( unsigned int width=1; width<70; width++ )
+        for( unsigned int channels=1; channels<=4; channels++ )
+        {
+            unsigned int dstWidth = nyx::mip_extent( width, 1 );
+            std::vector<unsigned char> b0( width*channels ), b1( width*channels ), b2( width*channels );
+            std::vector<float> f0( width*channels ), f1( width*channels ), f2( width*channels );
+            for( std::size_t i=0; i<b0.size(); i++ )
+            {
+                b0[i] = static_cast<unsigned char>( random.below( 256 ) ); f0[i] = random.uniform( -10.0f, 10.0f );
+                b1[i] = static_cast<unsigned char>( random.below( 256 ) ); f1[i] = random.uniform( -10.0f, 10.0f );
+                b2[i] = static_cast<unsigned char>( random.below( 256 ) ); f2[i] = random.uniform( -10.0f, 10.0f );
+            }
+
+            // 2 rows, and 3 for a folded last row
+            for( unsigned int count=2; count<=3; count++ )
+            {
+                const unsigned char *byteRows[3] = { &b0[0], &b1[0], &b2[0] };
+                std::vector<unsigned char> fast( dstWidth*channels ), scalar( dstWidth*channels );
+                nyx::util::box_row( byteRows, count, width, channels, &fast[0], dstWidth );
+                nyx::util::box_row<unsigned char>( byteRows, count, width, channels, &scalar[0], dstWidth );
+                bytesSame = bytesSame && fast == scalar;
+
+                const float *floatRows[3] = { &f0[0], &f1[0], &f2[0] };
+                std::vector<float> fastFloats( dstWidth*channels ), scalarFloats( dstWidth*channels );
+                nyx::util::box_row( floatRows, count, width, channels, &fastFloats[0], dstWidth );
+                nyx::util::box_row<float>( floatRows, count, width, channels, &scalarFloats[0], dstWidth );
+                floatsSame = floatsSame && close( &fastFloats[0], &scalarFloats[0], fastFloats.size(), 1.0e-6f );
+            }
+        }
+    CHECK( bytesSame );
+    CHECK( floatsSame );
+}
+
+
+static void test_options()
+{
+    // large enough to be split across the threads
+    test::random random( 47 );
+    unsigned int width = 611, height = 301, stride = 640;
+    std::vector<unsigned short> padded( std::size_t(stride)*height*2 ), tight( std::size_t(width)*height*2 );
+    for( unsigned int y=0; y<height; y++ )
+        for( unsigned int x=0; x<stride*2; x++ )
+        {
+            padded[ y*stride*2 + x ] = static_cast<unsigned short>( random.below( 65536 ) );
+            if( x < width*2 )
+                tight[ y*width*2 + x ] = padded[ y*stride*2 + x ];
+        }
+
+    for( int f=0; f<2; f++ )
+    {
+        nyx::mip_filter filter = f == 0 ? nyx::filter_box : nyx::filter_kaiser;
+        nyx::mip_chain<unsigned short> reference, threaded, strided;
+        reference.build( &tight[0], width, height, 1, 2, 0, filter, 0, 1 );
+        threaded.build( &tight[0], width, height, 1, 2, 0, filter, 0, 4 );
+        strided.build( &padded[0], width, height, 1, 2, 0, filter, stride, 1 );
+
+        bool same = reference.levels() == threaded.levels() && reference.levels() == strided.levels();
+        for( unsigned int l=1; l<reference.levels() && same; l++ )
+        {
+            std::size_t n = std::size_t( reference.width(l) )*reference.height(l)*2;
+            same = std::equal( reference.level(l), reference.level(l)+n, threaded.level(l) ) &&
+                   std::equal( reference.level(l), reference.level(l)+n, strided.level(l) );
+        }
+        CHECK( same );
+    }
+
+    // a constant stays constant, the Kaiser weights sum to one
+    std::vector<float> constant( 33*17*3, 0.7f );
+    nyx::mip_chain<float> kaiser;
+    kaiser.build( &constant[0], 33, 17, 1, 1, 0, nyx::filter_kaiser );
+    bool flat = true;
+    for( unsigned int l=1; l<kaiser.levels(); l++ )
+        for( std::size_t i=0; i<std::size_t( kaiser.width(l) )*kaiser.height(l); i++ )
+            flat = flat && std::fabs( kaiser.level(l)[i] - 0.7f ) < 1.0e-5f;
+    CHECK( flat );
+
+    // the Kaiser filter overshoots at hard edges, integers saturate
+    std::vector<unsigned char> edge( 32*32 );
+    for( std::size_t i=0; i<edge.size(); i++ )
+        edge[i] = (i%32) < 16 ? 0 : 255;
+    nyx::mip_chain<unsigned char> saturated;
+    saturated.build( &edge[0], 32, 32, 1, 1, 2, nyx::filter_kaiser );
+    CHECK( saturated.level(1)[0] == 0 && saturated.level(1)[15] == 255 );
+    CHECK( nyx::util::mip_store<unsigned char>( 300.0f ) == 255 && nyx::util::mip_store<unsigned char>( -4.0f ) == 0 );
+    CHECK( nyx::util::mip_store<short>( -2.5f ) == -2 && nyx::util::mip_store<short>( 2.5f ) == 3 );
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_extents();
+        test_box();
+        test_sse_rows();
+        test_options();
+    } );
+}
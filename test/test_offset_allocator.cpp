@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test_offset_allocator.cpp
+ *
+ *  Allocations stay inside the capacity and never overlap, free neighbours
+ *  coalesce, and defragment packs the allocations to the front as reported.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <nyx/offset_allocator.hpp>
+
+#include "test.hpp"
+
+
+struct allocation
+{
+    unsigned int handle;
+    unsigned int offset;
+    unsigned int size;
+};
+
+
+static void check_layout( const nyx::offset_allocator &allocator, const std::vector<allocation> &live )
+{
+    std::vector< std::pair<unsigned int, unsigned int> > ranges;
+    unsigned int used = 0;
+    for( std::size_t i=0; i<live.size(); i++ )
+    {
+        CHECK( allocator.offset( live[i].handle ) == live[i].offset );
+        CHECK( allocator.size( live[i].handle ) == live[i].size );
+        CHECK( live[i].offset + live[i].size <= allocator.capacity() );
+        ranges.push_back( std::make_pair( live[i].offset, live[i].size ) );
+        used += live[i].size;
+    }
+
+    std::sort( ranges.begin(), ranges.end() );
+    for( std::size_t i=1; i<ranges.size(); i++ )
+        CHECK( ranges[i-1].first + ranges[i-1].second <= ranges[i].first );
+    CHECK( allocator.used() == used );
+}
+
+
+static void test_basics()
+{
+    nyx::offset_allocator allocator;
+    allocator.reset( 100 );
+    CHECK( allocator.capacity() == 100 );
+    CHECK( allocator.used() == 0 );
+
+    CHECK( allocator.allocate( 0 ) == nyx::offset_allocator::none );
+    CHECK( allocator.allocate( 101 ) == nyx::offset_allocator::none );
+
+    // the whole capacity in one piece, then nothing is left
+    unsigned int all = allocator.allocate( 100 );
+    CHECK( all != nyx::offset_allocator::none );
+    CHECK( allocator.offset( all ) == 0 );
+    CHECK( allocator.allocate( 1 ) == nyx::offset_allocator::none );
+    allocator.free( all );
+    CHECK( allocator.used() == 0 );
+
+    // freeing the middle of three allocations and then its neighbours coalesces back to one range
+    unsigned int a = allocator.allocate( 30 ), b = allocator.allocate( 30 ), c = allocator.allocate( 40 );
+    CHECK( a != nyx::offset_allocator::none && b != nyx::offset_allocator::none && c != nyx::offset_allocator::none );
+    allocator.free( b );
+    CHECK( allocator.allocate( 31 ) == nyx::offset_allocator::none );
+    allocator.free( a );
+    allocator.free( c );
+    allocator.free( c );
+    CHECK( allocator.used() == 0 );
+    all = allocator.allocate( 100 );
+    CHECK( all != nyx::offset_allocator::none && allocator.offset( all ) == 0 );
+
+    // growing adds room at the end
+    allocator.grow( 150 );
+    CHECK( allocator.capacity() == 150 );
+    unsigned int d = allocator.allocate( 50 );
+    CHECK( d != nyx::offset_allocator::none && allocator.offset( d ) == 100 );
+}
+
+
+static void test_random()
+{
+    test::random random( 7 );
+    nyx::offset_allocator allocator;
+    allocator.reset( 1 << 16 );
+
+    std::vector<allocation> live;
+    for( int step=0; step<20000; step++ )
+    {
+        if( live.empty() || random.below( 3 ) != 0 )
+        {
+            allocation a;
+            a.size = 1 + random.below( random.below( 4 ) == 0 ? 4096 : 64 );
+            a.handle = allocator.allocate( a.size );
+            if( a.handle == nyx::offset_allocator::none )
+            {
+                // a failure is only allowed when the free space is too small or fragmented
+                CHECK( allocator.capacity() - allocator.used() < a.size || live.size() > 1 );
+                continue;
+            }
+            a.offset = allocator.offset( a.handle );
+            live.push_back( a );
+        }
+        else
+        {
+            std::size_t i = random.below( static_cast<unsigned int>( live.size() ) );
+            allocator.free( live[i].handle );
+            live[i] = live.back();
+            live.pop_back();
+        }
+
+        if( step % 1000 == 0 )
+            check_layout( allocator, live );
+    }
+    check_layout( allocator, live );
+
+    // defragment moves everything to the front, as reported, and leaves one free range at the end
+    std::vector<nyx::offset_allocator::relocation> moves;
+    allocator.defragment( moves );
+    for( std::size_t m=0; m<moves.size(); m++ )
+        for( std::size_t i=0; i<live.size(); i++ )
+            if( live[i].handle == moves[m].handle )
+            {
+                CHECK( live[i].offset == moves[m].from );
+                CHECK( live[i].size == moves[m].size );
+                live[i].offset = moves[m].to;
+            }
+
+    check_layout( allocator, live );
+    unsigned int end = 0;
+    for( std::size_t i=0; i<live.size(); i++ )
+        end = std::max( end, live[i].offset + live[i].size );
+    CHECK( end == allocator.used() );
+    CHECK( allocator.capacity() == (1u << 16) );
+
+    unsigned int rest = allocator.allocate( allocator.capacity() - allocator.used() );
+    CHECK( rest != nyx::offset_allocator::none && allocator.offset( rest ) == end );
+
+    for( std::size_t i=0; i<live.size(); i++ )
+        allocator.free( live[i].handle );
+    allocator.free( rest );
+    CHECK( allocator.used() == 0 );
+    CHECK( allocator.allocate( allocator.capacity() ) != nyx::offset_allocator::none );
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_basics();
+        test_random();
+    } );
+}
@@ -0,0 +1,218 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test_quantize.cpp
+ *
+ *  Encoded attributes decode to within half a step of the source, and the
+ *  SIMD encoders give the same results as the scalar ones.
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <nyx/quantize.hpp>
+
+#include "test.hpp"
+
+
+// the value of a finite half
+static float half_value( unsigned short h )
+{
+    int exponent = (h >> 10) & 0x1F, mantissa = h & 0x3FF;
+    float v = exponent == 0 ? std::ldexp( float(mantissa), -24 ) : std::ldexp( float(mantissa | 0x400), exponent - 25 );
+    return (h & 0x8000) ? -v : v;
+}
+
+
+static void test_half()
+{
+    // every finite half survives the round trip through float
+    bool exact = true;
+    for( unsigned int h=0; h<0x10000; h++ )
+    {
+        unsigned short bits = static_cast<unsigned short>( h );
+        if( (bits & 0x7C00) == 0x7C00 )
+            continue;
+        exact = exact && nyx::util::float_to_half( half_value( bits ) ) == bits;
+        exact = exact && nyx::util::half_to_float( bits ) == half_value( bits );
+    }
+    CHECK( exact );
+    CHECK( nyx::util::half_to_float( 0x7C00 ) > 65504.0f && nyx::util::half_to_float( 0xFC00 ) < -65504.0f );
+
+    // round to nearest even, overflow to infinity, underflow to zero
+    CHECK( nyx::util::float_to_half( 1.0f ) == 0x3C00 );
+    CHECK( nyx::util::float_to_half( 1.0f + std::ldexp( 1.0f, -11 ) ) == 0x3C00 );
+    CHECK( nyx::util::float_to_half( 1.0f + 3.0f*std::ldexp( 1.0f, -11 ) ) == 0x3C02 );
+    CHECK( nyx::util::float_to_half( -2.0f ) == 0xC000 );
+    CHECK( nyx::util::float_to_half( 65504.0f ) == 0x7BFF );
+    CHECK( nyx::util::float_to_half( 1.0e6f ) == 0x7C00 );
+    CHECK( nyx::util::float_to_half( 1.0e-9f ) == 0x0000 );
+    CHECK( nyx::util::float_to_half( std::ldexp( 1.0f, -24 ) ) == 0x0001 );
+
+    test::random random( 3 );
+    std::vector<float> source( 1003 );
+    for( std::size_t i=0; i<source.size(); i++ )
+        source[i] = random.uniform( -1000.0f, 1000.0f ) * ( i%7 == 0 ? 1.0e-6f : 1.0f );
+
+    std::vector<unsigned short> fast( source.size() ), scalar( source.size() );
+    nyx::util::encode_half( &source[0], &fast[0], source.size() );
+    nyx::util::encode_half<float>( &source[0], &scalar[0], source.size() );
+    CHECK( fast == scalar );
+
+    // normals are within half an ulp, 2^-11 relative
+    bool close = true;
+    for( std::size_t i=0; i<source.size(); i++ )
+    {
+        float error = std::fabs( half_value( scalar[i] ) - source[i] );
+        close = close && ( error <= std::fabs( source[i] ) * std::ldexp( 1.0f, -11 ) || error <= std::ldexp( 1.0f, -25 ) );
+    }
+    CHECK( close );
+}
+
+
+static void test_normalized()
+{
+    test::random random( 5 );
+    std::vector<float> source( 1001 );
+    for( std::size_t i=0; i<source.size(); i++ )
+        source[i] = random.uniform( -1.25f, 1.25f );
+
+    std::vector<unsigned short> unorm( source.size() ), unormScalar( source.size() );
+    nyx::util::encode_unorm16( &source[0], &unorm[0], source.size() );
+    nyx::util::encode_unorm16<float>( &source[0], &unormScalar[0], source.size() );
+    CHECK( unorm == unormScalar );
+
+    std::vector<short> snorm( source.size() ), snormScalar( source.size() );
+    nyx::util::encode_snorm16( &source[0], &snorm[0], source.size() );
+    nyx::util::encode_snorm16<float>( &source[0], &snormScalar[0], source.size() );
+    CHECK( snorm == snormScalar );
+
+    // decoded like GL, out of range values are clamped
+    bool close = true;
+    for( std::size_t i=0; i<source.size(); i++ )
+    {
+        float u = std::min( std::max( source[i], 0.0f ), 1.0f );
+        float s = std::min( std::max( source[i], -1.0f ), 1.0f );
+        close = close && std::fabs( unorm[i] / 65535.0f - u ) <= 0.5f/65535.0f + 1.0e-6f;
+        close = close && std::fabs( std::max( snorm[i] / 32767.0f, -1.0f ) - s ) <= 0.5f/32767.0f + 1.0e-6f;
+    }
+    CHECK( close );
+}
+
+
+static float signed_bits( unsigned int v, unsigned int shift, unsigned int bits )
+{
+    int x = static_cast<int>( (v >> shift) & ((1u << bits) - 1) );
+    if( x >= (1 << (bits-1)) )
+        x -= 1 << bits;
+    return static_cast<float>( x );
+}
+
+
+static void test_2_10_10_10()
+{
+    test::random random( 9 );
+    std::vector<float> source( 4*500 );
+    for( std::size_t i=0; i<source.size(); i++ )
+        source[i] = i%4 == 3 ? float( int( random.below( 3 ) ) - 1 ) : random.uniform( -1.0f, 1.0f );
+
+    std::vector<unsigned int> packed( 500 );
+    nyx::util::encode_2_10_10_10( &source[0], &packed[0], packed.size(), 4 );
+
+    bool close = true;
+    for( std::size_t i=0; i<packed.size(); i++ )
+    {
+        for( unsigned int c=0; c<3; c++ )
+            close = close && std::fabs( std::max( signed_bits( packed[i], 10*c, 10 ) / 511.0f, -1.0f ) - source[i*4+c] ) <= 0.5f/511.0f + 1.0e-6f;
+        close = close && signed_bits( packed[i], 30, 2 ) == source[i*4+3];
+    }
+    CHECK( close );
+
+    // three components leave w at 0
+    float normal[3] = { 0.0f, -1.0f, 1.0f };
+    unsigned int n;
+    nyx::util::encode_2_10_10_10( normal, &n, 1, 3 );
+    CHECK( signed_bits( n, 0, 10 ) == 0.0f && signed_bits( n, 10, 10 ) == -511.0f && signed_bits( n, 20, 10 ) == 511.0f && (n >> 30) == 0 );
+}
+
+
+// the decoder of octahedral_glsl
+static void octahedral_decode( short x, short y, float *n )
+{
+    float e[2] = { std::max( x / 32767.0f, -1.0f ), std::max( y / 32767.0f, -1.0f ) };
+    n[0] = e[0];
+    n[1] = e[1];
+    n[2] = 1.0f - std::fabs( e[0] ) - std::fabs( e[1] );
+    float t = std::max( -n[2], 0.0f );
+    n[0] += n[0] >= 0.0f ? -t : t;
+    n[1] += n[1] >= 0.0f ? -t : t;
+    float length = std::sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+    for( int i=0; i<3; i++ )
+        n[i] /= length;
+}
+
+
+static void test_octahedral()
+{
+    test::random random( 11 );
+    std::vector<float> normals;
+    for( int i=0; i<2000; i++ )
+    {
+        float v[3] = { random.uniform( -1.0f, 1.0f ), random.uniform( -1.0f, 1.0f ), random.uniform( -1.0f, 1.0f ) };
+        float length = std::sqrt( v[0]*v[0] + v[1]*v[1] + v[2]*v[2] );
+        if( length < 1.0e-3f )
+            continue;
+        normals.insert( normals.end(), v, v+3 );
+        for( int k=0; k<3; k++ )
+            normals[normals.size()-3+k] /= length;
+    }
+
+    // the axes and the folded edges of the lower half
+    const float axes[] = { 1,0,0, -1,0,0, 0,1,0, 0,-1,0, 0,0,1, 0,0,-1 };
+    normals.insert( normals.end(), axes, axes+18 );
+
+    std::size_t count = normals.size()/3;
+    std::vector<short> encoded( count*2 );
+    nyx::util::encode_octahedral( &normals[0], &encoded[0], count );
+
+    // 16 bit octahedral normals are within a few thousandths of a degree
+    float worst = 1.0f;
+    for( std::size_t i=0; i<count; i++ )
+    {
+        float n[3];
+        octahedral_decode( encoded[i*2], encoded[i*2+1], n );
+        worst = std::min( worst, n[0]*normals[i*3] + n[1]*normals[i*3+1] + n[2]*normals[i*3+2] );
+    }
+    CHECK( worst >= std::cos( 1.0e-3f ) );
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_half();
+        test_normalized();
+        test_2_10_10_10();
+        test_octahedral();
+    } );
+}
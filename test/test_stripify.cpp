@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                            //
+// This file is part of nyx, a lightweight C++ template library for OpenGL    //
+//                                                                            //
+// Copyright (C) 2010, 2011 Alexandru Duliu                                   //
+//                                                                            //
+// nyx is free software; you can redistribute it and/or                       //
+// modify it under the terms of the GNU Lesser General Public                 //
+// License as published by the Free Software Foundation; either               //
+// version 3 of the License, or (at your option) any later version.           //
+//                                                                            //
+// nyx is distributed in the hope that it will be useful, but WITHOUT ANY     //
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS  //
+// FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License or the //
+// GNU General Public License for more details.                               //
+//                                                                            //
+// You should have received a copy of the GNU Lesser General Public           //
+// License along with nyx. If not, see <http://www.gnu.org/licenses/>.        //
+//                                                                            //
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * test_stripify.cpp
+ *
+ *  Strips decoded the way GL walks GL_TRIANGLE_STRIP with primitive restart
+ *  give back the triangles of the list with their winding, degenerate ones
+ *  dropped, and a regular grid needs far fewer indices than the list.
+ */
+
+#include <vector>
+
+#include <nyx/mesh_optimizer.hpp>
+
+#include "test.hpp"
+
+
+// the triangles of restart separated strips, odd triangles swap their first two corners
+template <typename Te>
+static std::vector<Te> unstrip( const std::vector<Te> &strips )
+{
+    const Te restart = static_cast<Te>( ~static_cast<Te>(0) );
+    std::vector<Te> triangles;
+
+    std::size_t begin = 0;
+    while( begin < strips.size() )
+    {
+        std::size_t end = begin;
+        while( end < strips.size() && strips[end] != restart )
+            end++;
+
+        for( std::size_t i=begin; i+2<end; i++ )
+        {
+            bool odd = (i-begin) % 2 == 1;
+            Te a = strips[ odd ? i+1 : i ], b = strips[ odd ? i : i+1 ], c = strips[i+2];
+            if( a == b || b == c || c == a )
+                continue;
+            triangles.push_back( a );
+            triangles.push_back( b );
+            triangles.push_back( c );
+        }
+        begin = end+1;
+    }
+    return triangles;
+}
+
+
+static void test_grid()
+{
+    std::vector<float> positions;
+    std::vector<unsigned int> elements;
+    test::grid( 32, positions, elements );
+
+    std::vector<unsigned int> strips;
+    nyx::util::stripify( elements, strips );
+    CHECK( test::triangle_set( unstrip( strips ) ) == test::triangle_set( elements ) );
+    CHECK( strips.size() < elements.size()*2/3 );
+    CHECK( strips.back() != 0xFFFFFFFFu );
+
+    // a shuffled order still gives the same triangles
+    test::random random( 31 );
+    test::shuffle_triangles( elements, random );
+    nyx::util::stripify( elements, strips );
+    CHECK( test::triangle_set( unstrip( strips ) ) == test::triangle_set( elements ) );
+
+    // 16 bit strips restart at 0xFFFF
+    std::vector<unsigned short> shorts( elements.begin(), elements.end() ), shortStrips;
+    nyx::util::stripify( shorts, shortStrips );
+    CHECK( test::triangle_set( unstrip( shortStrips ) ) == test::triangle_set( shorts ) );
+}
+
+
+static void test_irregular()
+{
+    // a fan of three triangles on one edge (not manifold), a flipped neighbour and a degenerate triangle
+    unsigned int list[] = { 0,1,2,  1,0,3,  0,1,4,  2,1,5,  5,1,2,  6,6,7,  2,5,7 };
+    std::vector<unsigned int> elements( list, list + sizeof(list)/sizeof(list[0]) );
+
+    std::vector<unsigned int> strips;
+    nyx::util::stripify( elements, strips );
+
+    std::vector<unsigned int> expected;
+    for( std::size_t t=0; t<elements.size(); t+=3 )
+        if( elements[t] != elements[t+1] && elements[t+1] != elements[t+2] && elements[t+2] != elements[t] )
+            expected.insert( expected.end(), elements.begin()+t, elements.begin()+t+3 );
+    CHECK( test::triangle_set( unstrip( strips ) ) == test::triangle_set( expected ) );
+
+    std::vector<unsigned int> empty;
+    nyx::util::stripify( empty, strips );
+    CHECK( strips.empty() );
+}
+
+
+int main()
+{
+    return test::run( []()
+    {
+        test_grid();
+        test_irregular();
+    } );
+}